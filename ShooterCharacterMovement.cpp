@@ -1,1104 +1,2533 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#include "ShooterCharacterMovement.h"
-#include "Kismet/KismetSystemLibrary.h"
-#include "GameFramework/PlayerController.h"
-#include "GameFramework/Character.h"
-#include "GameFramework/MovementComponent.h"
-#include "GameFramework/PhysicsVolume.h"
-#include "Kismet/KismetMathLibrary.h"
-#include <DrawDebugHelpers.h>
-#include "Camera/CameraComponent.h"
-#include <Components/CapsuleComponent.h>
-#include "ShooterMovementReplication.h"
-
-
-int32 CVar_WallRun_ShowAll = 0;
-static FAutoConsoleVariableRef CVarWallRunShowForces(TEXT("WallRun.ShowAll"), CVar_WallRun_ShowAll,
-	TEXT("Show all forces and events during WallRun movement"), ECVF_Default);
-
-int32 CVar_WallRun_ShowCharacterCapsule = 0;
-static FAutoConsoleVariableRef CVarWallRunShowCharacterCapsule(TEXT("WallRun.ShowCharacterCapsule"), CVar_WallRun_ShowCharacterCapsule,
-	TEXT("Show ghost of character capsule during WallRunning"), ECVF_Default);
-
-int32 CVar_WallRun_ShowJumps = 0;
-static FAutoConsoleVariableRef CVarWallRunShowJumps(TEXT("WallRun.ShowJumps"), CVar_WallRun_ShowJumps,
-	TEXT("Show [red] direction of WallRun jumps, [green] last touched point, [blue] character capsule"), ECVF_Default);
-
-int32 CVar_WallRun_ShowRunForwardVector = 0;
-static FAutoConsoleVariableRef CVarWallRunShowForwardVector(TEXT("WallRun.ShowRunForwardVector"), CVar_WallRun_ShowRunForwardVector,
-	TEXT("Show the forward direction of Wall Run (expected to be parallel with the wall)"), ECVF_Default);
-
-int32 CVar_WallRun_ShowWallNormal = 0;
-static FAutoConsoleVariableRef CVarWallRunWallNormal(TEXT("WallRun.ShowWallNormal"), CVar_WallRun_ShowWallNormal,
-	TEXT("Show the normal vector of wall face character is currently running on"), ECVF_Default);
-
-int32 CVar_WallRun_ShowGravity = 0;
-static FAutoConsoleVariableRef CVarWallRunShowGravity(TEXT("WallRun.ShowGravity"), CVar_WallRun_ShowGravity,
-	TEXT("Show the amount of gravity applied during Wall Run"), ECVF_Default);
-
-int32 CVar_WallRun_ShowWallPush = 0;
-static FAutoConsoleVariableRef CVarWallRunWallPushVelocity(TEXT("WallRun.ShowWallPush"), CVar_WallRun_ShowWallPush,
-	TEXT("Show the velocity and direction applied for character to stick to a wall"), ECVF_Default);
-
-int32 CVar_WallRun_ShowAcceleration = 0;
-static FAutoConsoleVariableRef CVarWallRunWallAcceleration(TEXT("WallRun.ShowAcceleration"), CVar_WallRun_ShowAcceleration,
-	TEXT("Show direction of acceleration applied to this character. It is expected to be parallel with the wall if character is moving forward"), ECVF_Default);
-
-int32 CVar_WallRun_ShowState = 0;
-static FAutoConsoleVariableRef CVarWallRunWallState(TEXT("WallRun.ShowState"), CVar_WallRun_ShowState,
-	TEXT("Shows character capsule coloured differently for each state. Start [green], Mid [yellow], End [red]"), ECVF_Default);
-
-//----------------------------------------------------------------------//
-// UPawnMovementComponent
-//----------------------------------------------------------------------//
-UShooterCharacterMovement::UShooterCharacterMovement(const FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer)
-{
-	WallRunForwardJump = FWallRunJumpSettings(1600.0f, 600.0f);
-	WallRunSideJump = FWallRunJumpSettings(700.0f, 900.0f);
-
-	SetNetworkMoveDataContainer(NetworkMoveDataContainer);
-}
-FNetworkPredictionData_Client* UShooterCharacterMovement::GetPredictionData_Client() const
-{
-	if (ClientPredictionData == nullptr)
-	{
-		// Return our custom client prediction class instead
-		UShooterCharacterMovement* MutableThis = const_cast<UShooterCharacterMovement*>(this);
-		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_ShooterCharacter(*this);
-	}
-
-	return ClientPredictionData;
-}
-
-void UShooterCharacterMovement::BeginPlay()
-{
-	Super::BeginPlay();
-}
-
-void UShooterCharacterMovement::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
-{
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-
-	// Handle camera tilting
-	if (bShouldTiltCamera)
-	{
-		if ((bIsCloseToWallToTiltCamera || IsWallRunning()) && (IsFalling() || IsWallRunning())) {
-			if (IsWallRunning()) {
-				CameraTiltSide = WallRunSide;
-			}
-
-			if (CameraTiltSide == EWallRunSide::Left) {
-				CurrentCameraTiltAlpha = FMath::Max(CurrentCameraTiltAlpha - ((1.0f / CameraTiltSpeed) * DeltaTime), -1.0f);
-			}
-			else {
-				CurrentCameraTiltAlpha = FMath::Min(CurrentCameraTiltAlpha + ((1.0f / CameraTiltSpeed) * DeltaTime), 1.0f);
-			}
-		}
-		else {
-			// No longer wallrunning, tilt back to no-tilt
-			if (CurrentCameraTiltAlpha > 0) {
-				CurrentCameraTiltAlpha = FMath::Max(CurrentCameraTiltAlpha - ((1.0f / CameraTiltSpeed) * DeltaTime), 0.0f);
-			}
-			else if (CurrentCameraTiltAlpha < 0) {
-				CurrentCameraTiltAlpha = FMath::Min(CurrentCameraTiltAlpha + ((1.0f / CameraTiltSpeed) * DeltaTime), 0.0f);
-			}
-		}
-	}
-}
-
-void UShooterCharacterMovement::MoveAutonomous(float ClientTimeStamp, float DeltaTime,
-	uint8 CompressedFlags, const FVector& NewAccel)
-{
-	FShooterCharacterNetworkMoveData* Move = static_cast<FShooterCharacterNetworkMoveData*>(GetCurrentNetworkMoveData());
-	if (Move != nullptr)
-	{
-		bWallrunWantsToUnstick = Move->bWantsToUnstick;
-	}
-
-	Super::MoveAutonomous(
-		ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
-}
-
-
-
-void UShooterCharacterMovement::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
-{
-	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
-
-	// TODO: Move this logic to pre-tick or something, since this is effecting the next frame
-	APawn* Pawn = GetPawnOwner();
-	if (Pawn == nullptr) {
-		return;
-	}
-
-
-	// Update wallrunning state
-	if (IsFalling() || IsWallRunning())
-	{
-		if (!IsWallRunning()) {
-			// Not wallrunning and falling only
-			// Trace line for nearby walls
-			FVector WallNormal;
-			FVector ImpactPoint;
-			if (CanStartWallRunSide(EWallRunSide::Left, WallNormal, ImpactPoint)) {
-				StartWallRunning(EWallRunSide::Left, WallNormal, ImpactPoint);
-			}
-			else if (CanStartWallRunSide(EWallRunSide::Right, WallNormal, ImpactPoint)) {
-				StartWallRunning(EWallRunSide::Right, WallNormal, ImpactPoint);
-			}
-
-		}
-		else if (IsWallRunningSide(EWallRunSide::Left)) {
-			// Already wallrunning Left
-			// If we are no longer running at wall
-			// If we are still running, this will update the wall normal
-			if (TraceNearbyForWalls(EWallRunSide::Left, true, WallRunWallNormal, WallRunTraceImpactPoint) == false) {
-				StopWallRunning();
-			}
-		}
-		else {
-			// Already wallrunning right
-			// If we are no longer running at wall
-			// If we are still running, this will update the wall normal
-			if (TraceNearbyForWalls(EWallRunSide::Right, true, WallRunWallNormal, WallRunTraceImpactPoint) == false) {
-				StopWallRunning();
-			}
-		}
-	}
-	
-
-	// Wallrunnign Update state
-	if (IsWallRunning() && WallRunState == EWallRunState::Start && Velocity.Z <= WallRunMidZVelocityThreshold)
-	{
-		WallRunState = EWallRunState::Mid;
-		// Set timer for duration of "Mid" section of WallRun
-		if (!bIsWallRunInfinite) {
-			bIsWallRunDurationTimerStarted = true;
-		}
-	}
-
-	
-	// Update WallRun Timers
-	
-	// If in end state, gradually increase gravity until desired gravity is reached
-	if (IsWallRunning() && WallRunState == EWallRunState::End)
-	{
-		if (CurrentWallRunEndGravity < WallRunGravityEndState)
-		{
-			CurrentWallRunEndGravity = FMath::Min(WallRunGravityEndState, CurrentWallRunEndGravity + ((1.0f / WallRunGravityEndStateApplySpeed) * DeltaSeconds));
-		}
-	}
-
-	// Unstick Timer
-	if (bWallrunWantsToUnstick)
-	{
-		WantsToUnstickTimeRemaining = FMath::Max(0.0f, WantsToUnstickTimeRemaining - DeltaSeconds);
-		if (WantsToUnstickTimeRemaining <= 0.0f)
-		{
-			UnstickFromWall_Internal();
-		}
-	}
-	else {
-		WantsToUnstickTimeRemaining = UnstickFromWallTimeThreshold;
-	}
-
-	// WallRun Cooldowns
-	if (WallRunCooldownLeftTimeRemaining > 0.0f)
-	{
-		WallRunCooldownLeftTimeRemaining = FMath::Max(0.0f, WallRunCooldownLeftTimeRemaining - DeltaSeconds);
-	}
-
-	if (WallRunCooldownRightTimeRemaining > 0.0f)
-	{
-		WallRunCooldownRightTimeRemaining = FMath::Max(0.0f, WallRunCooldownRightTimeRemaining - DeltaSeconds);
-	}
-	// Wallrun duration timer
-	if (bIsWallRunDurationTimerStarted && IsWallRunning() && WallRunTimeRemaining > 0.0f)
-	{
-		WallRunTimeRemaining = FMath::Max(0.0f, WallRunTimeRemaining - DeltaSeconds);
-		if (WallRunTimeRemaining <= 0.0f && WallRunState != EWallRunState::End)
-		{
-			TransitionWallRunToEndState();
-		}
-	}
-}
-
-void UShooterCharacterMovement::UpdateCharacterStateAfterMovement(float DeltaSeconds)
-{
-	Super::UpdateCharacterStateAfterMovement(DeltaSeconds);
-}
-
-bool UShooterCharacterMovement::DoJump(bool bReplayingMoves)
-{
-	// Implementation taken from CharacterMovementComponent::DoJump but added chase for wallrunning
-	if(CharacterOwner){
-		if (IsWallRunning()) 
-		{
-			DoWallRunJump(bReplayingMoves);
-		}
-		else if(CharacterOwner->CanJump()) // Default jump
-		{
-			// Don't jump if we can't move up/down.
-			if (!bConstrainToPlane || FMath::Abs(PlaneConstraintNormal.Z) != 1.f)
-			{
-				Velocity.Z = FMath::Max(Velocity.Z, JumpZVelocity);
-				SetMovementMode(MOVE_Falling);
-				return true;
-			}
-		}
-	}
-
-	return false;
-}
-
-void UShooterCharacterMovement::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
-{
-	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
-
-
-}
-
-void UShooterCharacterMovement::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
-{
-	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
-}
-
-
-void UShooterCharacterMovement::PhysCustom(float deltaTime, int32 Iterations)
-{
-	switch (CustomMovementMode)
-	{
-	case ECustomMovementMode::CMOVE_WallRunning:
-	{
-		PhysWallRunning(deltaTime, Iterations);
-		break;
-	}
-	}
-
-	// Not sure if this is needed
-	Super::PhysCustom(deltaTime, Iterations);
-}
-
-
-float UShooterCharacterMovement::GetMaxSpeed() const
-{
-	switch (MovementMode)
-	{
-	case MOVE_Walking:
-	case MOVE_NavWalking:
-	{
-		if (IsCrouching())
-		{
-			return MaxWalkSpeedCrouched;
-		}
-		else
-		{
-
-			return RunSpeed;
-		}
-	}
-	case MOVE_Falling:
-		return MaxWalkSpeed;
-	case MOVE_Swimming:
-		return MaxSwimSpeed;
-	case MOVE_Flying:
-		return MaxFlySpeed;
-	case MOVE_Custom:
-		switch (CustomMovementMode)
-		{
-		case CMOVE_WallRunning:
-		{
-			return WallRunSpeed;
-		}
-		default:
-			return MaxCustomMovementSpeed;
-		}
-
-	case MOVE_None:
-	default:
-		return 0.f;
-	}
-}
-
-float UShooterCharacterMovement::GetMaxAcceleration() const
-{
-	if (MovementMode == MOVE_Custom)
-	{
-		switch (CustomMovementMode)
-		{
-		case CMOVE_WallRunning:
-		{
-			return WallRunAcceleration;
-		}
-		default:
-			return Super::GetMaxAcceleration();
-		}
-	}
-
-	return Super::GetMaxAcceleration();
-}
-
-float UShooterCharacterMovement::GetMaxBrakingDeceleration() const
-{
-	if (MovementMode == MOVE_Custom)
-	{
-		switch (CustomMovementMode)
-		{
-		case CMOVE_WallRunning:
-		{
-			return BrakingDecelerationWallRunning;
-		}
-		default:
-			return Super::GetMaxBrakingDeceleration();
-		}
-	}
-
-	return Super::GetMaxBrakingDeceleration();
-}
-
-void UShooterCharacterMovement::ProcessLanded(const FHitResult& Hit, float remainingTime, int32 Iterations)
-{
-
-	// If we landed while wall running, make sure we stop wall running
-	if (IsWallRunning())
-	{
-		StopWallRunning();
-	}
-
-
-	Super::ProcessLanded(Hit, remainingTime, Iterations);
-}
-
-void UShooterCharacterMovement::UpdateFromCompressedFlags(uint8 Flags)
-{
-	Super::UpdateFromCompressedFlags(Flags);
-
-	// Read the values from the compressed flags
-	// bWallrunWantsToUnstick = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
-}
-
-
-
-#pragma region WallRun
-void UShooterCharacterMovement::DoWallRunJump(bool bReplayingMoves)
-{
-	// We calculate a deviation angle from the wallrun direction
-			// And base the jump direction, velocity (horizontal and vertical) based on that angle
-			// More acute angle results in faster jump (but not as much Z) and vise-versa
-	FVector PawnForwardVector = GetPawnOwner()->GetActorForwardVector();
-
-	// This is -180 to 180 angle compared to wallrun direction
-	float AimAngle = FMath::UnwindDegrees(UKismetMathLibrary::DegAtan2(PawnForwardVector.X, PawnForwardVector.Y) - UKismetMathLibrary::DegAtan2(Velocity.X, Velocity.Y));
-
-	bool bIsFacingIntoWall = false;
-	if ((WallRunSide == EWallRunSide::Left && AimAngle < 0.0f) ||
-		(WallRunSide == EWallRunSide::Right && AimAngle > 0.0f))
-	{
-		bIsFacingIntoWall = true;
-	}
-
-	AimAngle = FMath::Abs(AimAngle);
-
-	// From 15 (min angle) to 90 (max angle) 
-	AimAngle = FMath::Clamp(AimAngle, MinimumWallrunJumpAngle, MaximumWallrunJumpAngle);
-	// 0 to 1 from Min Angle to Max Angle
-	float AimAngleLerpAlpha = (AimAngle - MinimumWallrunJumpAngle) / MaximumWallrunJumpAngle;
-
-	// Calculate Jump Velocity based on angle
-	float NewZVelocity = FMath::Lerp(WallRunForwardJump.UpVelocity, WallRunSideJump.UpVelocity, AimAngleLerpAlpha);
-	float NewXYVelocity = FMath::Lerp(WallRunForwardJump.ForwardVelocity, WallRunSideJump.ForwardVelocity, AimAngleLerpAlpha);
-
-	// Set Z velocity
-	Velocity.Z = FMath::Max(Velocity.Z, NewZVelocity);
-
-	// Current velocity (the wallrun direction) * New velocity 
-	// This results in correct magnitude but it is in direction of wall run, we rotate it later
-	FVector2D HorizontalVelocity = FVector2D(Velocity.X, Velocity.Y).GetSafeNormal() * NewXYVelocity;
-	Velocity.X = HorizontalVelocity.X;
-	Velocity.Y = HorizontalVelocity.Y;
-
-	// Rotate jump direction
-	if (WallRunSide == EWallRunSide::Left) {
-		Velocity = UKismetMathLibrary::RotateAngleAxis(Velocity, AimAngle, FVector(0.0f, 0.0f, 1.0f));
-	}
-	else {
-		Velocity = UKismetMathLibrary::RotateAngleAxis(Velocity, -AimAngle, FVector(0.0f, 0.0f, 1.0f));
-	}
-
-#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-	// Debug Jump Arrow
-	if (CVar_WallRun_ShowAll || CVar_WallRun_ShowJumps)
-	{
-		FVector PawnLoc = GetPawnOwner()->GetActorLocation();
-
-		// Draw where was the last "contact" point
-		DrawDebugPoint(GetWorld(), WallRunTraceImpactPoint, 10.0f, FColor::Green, false, 20.0f);
-		// Draw the direction and velocity of jump
-		DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + Velocity.GetSafeNormal() * 200.0f, 60.f, FColor::Red, false, 20.0f, 0, 2.f);
-
-		// Draw character capsule (If owned by character which as capsule)
-		if (ACharacter* Character = Cast<ACharacter>(GetPawnOwner())) {
-			UCapsuleComponent* CharacterCapsule = Character->GetCapsuleComponent();
-			if (CharacterCapsule) {
-				FVector CapsuleLoc = CharacterCapsule->GetComponentLocation();
-				float HalfHeight = CharacterCapsule->GetScaledCapsuleHalfHeight();
-				float Radius = CharacterCapsule->GetScaledCapsuleRadius();
-				FRotator Rotation = CharacterCapsule->GetComponentRotation();
-
-				DrawDebugCapsule(GetWorld(), CapsuleLoc, HalfHeight, Radius, Rotation.Quaternion(), FColor::Blue, false, 20.0f, 0, 0.5f);
-			}
-		}
-	}
-#endif
-	//UE_LOG(LogTemp, Log, TEXT("WallRun Jump - Player Look Angle: %f, Velocity Lerp: %f, New XY Magniture: %f"), AimAngle, AimAngleLerpAlpha, NewXYVelocity);
-	StopWallRunning();
-}
-
-
-void UShooterCharacterMovement::StartWallRunning(EWallRunSide Side, FVector InWallNormal, FVector InWallRunTraceImpactPoint)
-{
-	// Clean up
-	WallRunState = EWallRunState::Start;
-	bWallrunWantsToUnstick = false;
-	WantsToUnstickTimeRemaining = 0.0f;
-	bIsWallRunDurationTimerStarted = false;
-
-	WallRunTimeRemaining = WallRunDuration;
-	WallRunSide = Side;
-	WallRunWallNormal = InWallNormal;
-	WallRunTraceImpactPoint = InWallRunTraceImpactPoint;
-	
-	Velocity.Z = FMath::Max(Velocity.Z, WallRunStartZVelocity);
-
-	SetMovementMode(EMovementMode::MOVE_Custom, ECustomMovementMode::CMOVE_WallRunning);
-}
-
-void UShooterCharacterMovement::StopWallRunning()
-{
-	StartWallRunCooldown(WallRunSide);
-	SetMovementMode(EMovementMode::MOVE_Falling);
-}
-
-bool UShooterCharacterMovement::CanStartWallRunSide(EWallRunSide Side, FVector& OutWallNormal, FVector& OutImpactPoint)
-{
-	FVector TestedWallNormal;
-	bool bSuccess = IsWallRunOnCooldown(Side) == false && TraceNearbyForWalls(Side, false, TestedWallNormal, OutImpactPoint);
-	if (bSuccess) 
-	{
-		// Check if we are rotated in acceptable angle (Prevents starting wallrun when player back faces wall)
-		FVector PawnForwardVector = GetPawnOwner()->GetActorForwardVector();
-		FVector RunDirection = GetWallRunForwardDirection(Side, TestedWallNormal);
-		// This is -180 to 180 angle compared to wallrun direction
-		float AimAngle = FMath::UnwindDegrees(UKismetMathLibrary::DegAtan2(PawnForwardVector.X, PawnForwardVector.Y) - UKismetMathLibrary::DegAtan2(RunDirection.X, RunDirection.Y));
-		if (FMath::Abs(AimAngle) > WallRunStartMaxAngle)
-		{
-			return false;
-		}
-
-
-		// Check if player is not moving backwards
-		if(bPreventWallRunIfMovingBackwards) {
-			float FacingForwardDot = FVector::DotProduct(Velocity.GetSafeNormal(), PawnForwardVector.GetSafeNormal());
-			bool bIsFacingForward = FacingForwardDot > 0.0f;
-			if (bIsFacingForward == false) {
-				return false;
-			}
-		}
-
-		// Add additional wallsliding checks here
-
-		// All tests passed
-		OutWallNormal = TestedWallNormal;
-		return true;
-	}
-
-
-	return false;
-}
-
-
-bool UShooterCharacterMovement::TraceNearbyForWalls(EWallRunSide Side, bool bFallbackToFeetLevel, FVector& OutNormal, FVector& OutImpactPoint)
-{
-	// Create a TArray of target angles to raycast (Without TArray would be cleaner, but this is ready if we need to manually add some odd angles)
-	float TargetAngle = 180.0f / NumberOfRaysPerSide + 1;
-	
-	TArray<float> Angles;
-	for (int32 i = 1; i < NumberOfRaysPerSide; i++)
-	{
-		Angles.Add(TargetAngle * i);
-	}
-
-
-	AShooterCharacter* Pawn = Cast<AShooterCharacter>(GetPawnOwner());
-	if (Pawn == nullptr) {
-		return false;
-	}
-
-	FCollisionQueryParams Params;
-	Params.AddIgnoredActor(Pawn);
-
-	float Direction = Side == EWallRunSide::Left ? -1.0f : 1.0f;
-	float Distance = FMath::Max(WallDetectDistance, CameraTiltWallDistance);
-
-	FVector PawnLoc = Pawn->GetActorLocation();
-	FVector EndLocPreRotate = Pawn->GetActorForwardVector() * Distance;
-
-	bool bFoundCameraTilt = false;
-
-	for (int32 i = 0; i < Angles.Num(); i++)
-	{	
-		float Angle = Angles[i];
-		FHitResult HitResult;
-		FVector EndLoc = UKismetMathLibrary::RotateAngleAxis(EndLocPreRotate, Angle * Direction, FVector(0.0f, 0.0f, 1.0f)) + PawnLoc;
-		//UKismetSystemLibrary::LineTraceSingle(this, StartLoc, EndLoc, UEngineTypes::ConvertToTraceType(ECC_Visibility), false, TArray<AActor*>(), EDrawDebugTrace::ForDuration, HitResult, true, Side == EWallRunSide::Left ? FLinearColor::Red : FLinearColor::Green);
-		UKismetSystemLibrary::LineTraceSingle(this, PawnLoc + FVector(0.0f, 0.0f, FirstTraceTopOffset), EndLoc + FVector(0.0f, 0.0f, FirstTraceTopOffset), UEngineTypes::ConvertToTraceType(ECC_Visibility), false, TArray<AActor*>(), EDrawDebugTrace::None, HitResult, true);
-
-
-		if (bFallbackToFeetLevel && HitResult.bBlockingHit == false)
-		{
-			UKismetSystemLibrary::LineTraceSingle(this, PawnLoc + FVector(0.0f, 0.0f, FallbackTraceTopOffset), EndLoc + FVector(0.0f, 0.0f, FallbackTraceTopOffset), UEngineTypes::ConvertToTraceType(ECC_Visibility), false, TArray<AActor*>(), EDrawDebugTrace::None, HitResult, true);
-		}
-		
-		// Handle Camera Tilt
-		// Do we care about camera tilt and is player velocity heading to that hit/wall?
-		if (!bFoundCameraTilt && bShouldTiltCamera && HitResult.bBlockingHit && HitResult.Distance <= CameraTiltWallDistance && Pawn->IsFirstPerson())
-		{
-			float t = 0.0f;
-			FVector IntersectionPoint;
-			bool bIntersepts = UKismetMathLibrary::LinePlaneIntersection_OriginNormal(PawnLoc, PawnLoc + (Velocity * FVector(1.0f, 1.0f, 0.0f)).GetSafeNormal() * 700.0f, HitResult.Location, HitResult.Normal, t, IntersectionPoint);
-			if (bIntersepts)
-			{
-				bIsCloseToWallToTiltCamera = true;
-				CameraTiltSide = Side;
-				bFoundCameraTilt = true;
-			}
-		}
-
-		// If we pre-tilting camera is no longer required
-		if (bShouldTiltCamera && !bFoundCameraTilt && bIsCloseToWallToTiltCamera && CameraTiltSide == Side)
-		{
-			bIsCloseToWallToTiltCamera = false;
-		}
-		
-		// Handle Wallrunning 
-		if (HitResult.bBlockingHit && HitResult.Distance <= WallDetectDistance)
-		{
-			// Priorities forward walls
-			OutImpactPoint = HitResult.Location;
-			OutNormal = (HitResult.Normal * FVector(1.0f, 1.0f, 0.0f)).GetSafeNormal();
-			return true;
-		}
-		
-	}
-
-	return false;
-}
-
-
-void UShooterCharacterMovement::UnstickFromWallPressed()
-{
-	if (IsWallRunning() && !bWallrunWantsToUnstick)
-	{
-		WantsToUnstickTimeRemaining = UnstickFromWallTimeThreshold;
-		bWallrunWantsToUnstick = true;
-	}
-}
-
-void UShooterCharacterMovement::UnstickFromWall_Internal()
-{
-	if (IsWallRunning())
-	{
-		Velocity += WallRunWallNormal.GetSafeNormal() * WallRunUnstickVelocity;
-		StopWallRunning();
-	}
-}
-
-void UShooterCharacterMovement::ResetUnstickFromWall()
-{
-	WantsToUnstickTimeRemaining = UnstickFromWallTimeThreshold;
-	bWallrunWantsToUnstick = false;
-}
-
-float UShooterCharacterMovement::GetWallRunGravityScale()
-{
-	// Moving up, return specific value
-	if (Velocity.Z > WallRunMidZVelocityThreshold) {
-		return WallRunGravityScaleUp;
-	}
-
-	
-	float NewGravityScale = 0.0f;
-
-	// Moving down, start with the default
-	if (WallRunState == EWallRunState::Mid)
-	{
-		NewGravityScale = FMath::Max(NewGravityScale, WallRunGravityMidState);
-	}
-	else if (WallRunState == EWallRunState::End)
-	{
-		NewGravityScale = WallRunGravityEndState;
-	}
-
-	// Should we increase gravity if moving slowly?
-	if (bScaleWallRunGravityWithSpeed) 
-	{
-		float CurrentSpeed = Velocity.Size2D();
-		if (CurrentSpeed < WallRunSpeed * ScaleWallRunGravityStart)
-		{
-			float Alpha = CurrentSpeed / (WallRunSpeed * ScaleWallRunGravityStart);
-			Alpha = FMath::Clamp(Alpha, 0.0f, 1.0f);
-			NewGravityScale = FMath::Max(NewGravityScale, FMath::Lerp(WallRunGravityScaleSlow, WallRunGravityMidState, Alpha));
-		}
-	}
-
-	return NewGravityScale;
-}
-
-bool UShooterCharacterMovement::IsWallRunning()
-{
-	return MovementMode == MOVE_Custom && CustomMovementMode == ECustomMovementMode::CMOVE_WallRunning && UpdatedComponent;
-}
-
-bool UShooterCharacterMovement::IsWallRunningSide(EWallRunSide Side)
-{
-	return IsWallRunning() && WallRunSide == Side;
-}
-
-void UShooterCharacterMovement::StartWallRunCooldown(EWallRunSide Side) 
-{
-	UWorld* world = GetWorld();
-	if (world)
-	{
-		if (Side == EWallRunSide::Left) {
-			WallRunCooldownLeftTimeRemaining = WallRunCooldown;
-		}
-		else {
-			WallRunCooldownRightTimeRemaining = WallRunCooldown;
-		}
-	}
-}
-
-bool UShooterCharacterMovement::IsWallRunOnCooldown(EWallRunSide Side) 
-{
-	if (Side == EWallRunSide::Left) {
-		return WallRunCooldownLeftTimeRemaining > 0.0f;
-	}
-	return WallRunCooldownRightTimeRemaining > 0.0f;
-}
-
-void UShooterCharacterMovement::OnComponentDestroyed(bool bDestroyingHierarchy)
-{
-	Super::OnComponentDestroyed(bDestroyingHierarchy);
-}
-
-float UShooterCharacterMovement::GetCurrentCameraTilt()
-{
-	return CurrentCameraTiltAlpha* CameraMaxTilt * -1.0f;
-}
-
-FVector UShooterCharacterMovement::GetWallRunForwardDirection()
-{
-	float WallDirection = WallRunSide == EWallRunSide::Left ? -1.0f : 1.0f;
-	return UKismetMathLibrary::RotateAngleAxis(WallRunWallNormal, 90.0f * WallDirection, FVector::UpVector);
-}
-
-FVector UShooterCharacterMovement::GetWallRunForwardDirection(EWallRunSide Side, FVector WallNormal)
-{
-	float WallDirection = Side == EWallRunSide::Left ? -1.0f : 1.0f;
-	return UKismetMathLibrary::RotateAngleAxis(WallNormal, 90.0f * WallDirection, FVector::UpVector);
-}
-
-FVector UShooterCharacterMovement::GetWallRunLateralAcceleration(float deltaTime)
-{
-	return FVector(Acceleration.X, Acceleration.Y, 0.f);
-}
-
-void UShooterCharacterMovement::TransitionWallRunToEndState()
-{
-	if (WallRunState != EWallRunState::End) {
-		CurrentWallRunEndGravity = WallRunGravityMidState;
-		WallRunState = EWallRunState::End;
-	}
-}
-
-void UShooterCharacterMovement::PhysWallRunning(float deltaTime, int32 Iterations)
-{
-	// PhysFalling code, but adjusted for wallrunning
-
-	if (deltaTime < MIN_TICK_TIME)
-	{
-		return;
-	}
-
-	
-	// Acceleration is replicated
-
-	FVector WallRunAccelerationLocal = GetWallRunLateralAcceleration(deltaTime);
-
-	WallRunAccelerationLocal.Z = 0.f;
-	const bool bHasLimitedAirControl = ShouldLimitAirControl(deltaTime, WallRunAccelerationLocal);
-
-
-	float remainingTime = deltaTime;
-	while ((remainingTime >= MIN_TICK_TIME) && (Iterations < MaxSimulationIterations))
-	{
-		Iterations++;
-		float timeTick = GetSimulationTimeStep(remainingTime, Iterations);
-		remainingTime -= timeTick;
-
-		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
-		const FQuat PawnRotation = UpdatedComponent->GetComponentQuat();
-		bJustTeleported = false;
-
-		RestorePreAdditiveRootMotionVelocity();
-
-		const FVector OldVelocity = Velocity;
-		// Apply input
-		const float MaxDecel = GetMaxBrakingDeceleration();
-		
-		if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
-		{
-			// Compute Velocity
-			{
-				// Acceleration = WallRunAcceleration for CalcVelocity(), but we restore it after using it.
-				TGuardValue<FVector> RestoreAcceleration(Acceleration, WallRunAccelerationLocal);
-				Velocity.Z = 0.f;
-				CalcVelocity(timeTick, /*WallRunLateralFriction*/ 0.0f, false, MaxDecel);
-				Velocity.Z = OldVelocity.Z;
-			}
-		}
-		
-		
-
-		// Apply push to a side where the wall is (stick to the wall)
-		FVector PushToStickToWall = WallRunWallNormal * WallRunPushVelocity * timeTick * -1.0f;;
-		Velocity += PushToStickToWall;
-
-		// Compute current gravity
-		const FVector Gravity(0.f, 0.f, GetGravityZ() * GetWallRunGravityScale());
-		float GravityTime = timeTick;
-
-		
-
-#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-		// Purely debug options in this section
-		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowCharacterCapsule || CVar_WallRun_ShowState)
-		{
-			// Draw character capsule (If owned by character which as capsule)
-			if (ACharacter* Character = Cast<ACharacter>(GetPawnOwner())) {
-				UCapsuleComponent* CharacterCapsule = Character->GetCapsuleComponent();
-				if (CharacterCapsule) {
-					FVector CapsuleLoc = CharacterCapsule->GetComponentLocation();
-					float HalfHeight = CharacterCapsule->GetScaledCapsuleHalfHeight();
-					float Radius = CharacterCapsule->GetScaledCapsuleRadius();
-					FRotator Rotation = CharacterCapsule->GetComponentRotation();
-
-					FColor color = FColor::Blue;
-					if (CVar_WallRun_ShowState)
-					{
-						if (WallRunState == EWallRunState::Start)
-						{
-							color = FColor::Green;
-						}
-						else if (WallRunState == EWallRunState::Mid)
-						{
-							color = FColor::Yellow;
-						}
-						else
-						{
-							color = FColor::Red;
-						}
-					}
-
-					DrawDebugCapsule(GetWorld(), CapsuleLoc, HalfHeight, Radius, Rotation.Quaternion(), color, false, 20.0f, 0, 0.5f);
-				}
-			}
-		}
-		
-		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowRunForwardVector)
-		{
-			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
-			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + GetWallRunForwardDirection().GetSafeNormal() * 300.0f, 80.f, FColor::Blue, false, 0, 0, 2.f);
-		}
-
-		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowGravity)
-		{
-			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
-			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + (Gravity / 4.0f), 80.f, FColor::Red, false, 20.0f, 0, 1.f);
-		}
-
-		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowWallPush)
-		{
-			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
-			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + PushToStickToWall.GetSafeNormal() * 100.0f, 80.f, FColor::Cyan, false, 20.0f, 0, 1.f);
-		}
-
-		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowWallNormal)
-		{
-			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
-			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + WallRunWallNormal.GetSafeNormal() * 100.0f, 80.f, FColor::Yellow, false, 20.0f, 0, 1.f);
-		}
-
-		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowAcceleration)
-		{
-			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
-			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + Acceleration.GetSafeNormal() * 100.0f, 80.f, FColor::Orange, false, 20.0f, 0, 1.f);
-		}
-#endif
-
-		// If jump is providing force, gravity may be affected.
-		bool bEndingJumpForce = false;
-		if (CharacterOwner->JumpForceTimeRemaining > 0.0f)
-		{
-			// Consume some of the force time. Only the remaining time (if any) is affected by gravity when bApplyGravityWhileJumping=false.
-			const float JumpForceTime = FMath::Min(CharacterOwner->JumpForceTimeRemaining, timeTick);
-			GravityTime = bApplyGravityWhileJumping ? timeTick : FMath::Max(0.0f, timeTick - JumpForceTime);
-
-			// Update Character state
-			CharacterOwner->JumpForceTimeRemaining -= JumpForceTime;
-			if (CharacterOwner->JumpForceTimeRemaining <= 0.0f)
-			{
-				CharacterOwner->ResetJumpState();
-				bEndingJumpForce = true;
-			}
-		}
-
-		// Apply gravity
-		Velocity = NewFallVelocity(Velocity, Gravity, GravityTime);
-
-		// See if we need to sub-step to exactly reach the apex. This is important for avoiding "cutting off the top" of the trajectory as framerate varies.
-		if (OldVelocity.Z > 0.f && Velocity.Z <= 0.f && NumJumpApexAttempts < MaxJumpApexAttemptsPerSimulation)
-		{
-			const FVector DerivedAccel = (Velocity - OldVelocity) / timeTick;
-			if (!FMath::IsNearlyZero(DerivedAccel.Z))
-			{
-				const float TimeToApex = -OldVelocity.Z / DerivedAccel.Z;
-
-				// The time-to-apex calculation should be precise, and we want to avoid adding a substep when we are basically already at the apex from the previous iteration's work.
-				const float ApexTimeMinimum = 0.0001f;
-				if (TimeToApex >= ApexTimeMinimum && TimeToApex < timeTick)
-				{
-					const FVector ApexVelocity = OldVelocity + DerivedAccel * TimeToApex;
-					Velocity = ApexVelocity;
-					Velocity.Z = 0.f; // Should be nearly zero anyway, but this makes apex notifications consistent.
-
-					// We only want to move the amount of time it takes to reach the apex, and refund the unused time for next iteration.
-					remainingTime += (timeTick - TimeToApex);
-					timeTick = TimeToApex;
-					Iterations--;
-					NumJumpApexAttempts++;
-				}
-			}
-		}
-
-		ApplyRootMotionToVelocity(timeTick);
-
-		// Compute change in position (using midpoint integration method).
-		FVector Adjusted = 0.5f * (OldVelocity + Velocity) * timeTick;
-
-		// Special handling if ending the jump force where we didn't apply gravity during the jump.
-		if (bEndingJumpForce && !bApplyGravityWhileJumping)
-		{
-			// We had a portion of the time at constant speed then a portion with acceleration due to gravity.
-			// Account for that here with a more correct change in position.
-			const float NonGravityTime = FMath::Max(0.f, timeTick - GravityTime);
-			Adjusted = (OldVelocity * NonGravityTime) + (0.5f * (OldVelocity + Velocity) * GravityTime);
-		}
-
-		// Move
-		FHitResult Hit(1.f);
-		SafeMoveUpdatedComponent(Adjusted, PawnRotation, true, Hit);
-
-		if (!HasValidData())
-		{
-			return;
-		}
-
-		float LastMoveTimeSlice = timeTick;
-		float subTimeTickRemaining = timeTick * (1.f - Hit.Time);
-
-		if (IsSwimming()) //just entered water
-		{
-			remainingTime += subTimeTickRemaining;
-			StartSwimming(OldLocation, OldVelocity, timeTick, remainingTime, Iterations);
-			return;
-		}
-		else if (Hit.bBlockingHit)
-		{
-			if (IsValidLandingSpot(UpdatedComponent->GetComponentLocation(), Hit))
-			{
-				remainingTime += subTimeTickRemaining;
-				ProcessLanded(Hit, remainingTime, Iterations);
-				return;
-			}
-			else
-			{
-				// Compute impact deflection based on final velocity, not integration step.
-				// This allows us to compute a new velocity from the deflected vector, and ensures the full gravity effect is included in the slide result.
-				Adjusted = Velocity * timeTick;
-
-				// See if we can convert a normally invalid landing spot (based on the hit result) to a usable one.
-				if (!Hit.bStartPenetrating && ShouldCheckForValidLandingSpot(timeTick, Adjusted, Hit))
-				{
-					const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
-					FFindFloorResult FloorResult;
-					FindFloor(PawnLocation, FloorResult, false);
-					if (FloorResult.IsWalkableFloor() && IsValidLandingSpot(PawnLocation, FloorResult.HitResult))
-					{
-						remainingTime += subTimeTickRemaining;
-						ProcessLanded(FloorResult.HitResult, remainingTime, Iterations);
-						return;
-					}
-				}
-
-				HandleImpact(Hit, LastMoveTimeSlice, Adjusted);
-
-				// If we've changed physics mode, abort.
-				if (!HasValidData() || !IsWallRunning())
-				{
-					return;
-				}
-
-				// Limit air control based on what we hit.
-				// We moved to the impact point using air control, but may want to deflect from there based on a limited air control acceleration.
-				FVector VelocityNoAirControl = OldVelocity;
-				FVector AirControlAccel = Acceleration;
-				if (bHasLimitedAirControl)
-				{
-					// Compute VelocityNoAirControl
-					{
-						// Find velocity *without* acceleration.
-						TGuardValue<FVector> RestoreAcceleration(Acceleration, FVector::ZeroVector);
-						TGuardValue<FVector> RestoreVelocity(Velocity, OldVelocity);
-						Velocity.Z = 0.f;
-						CalcVelocity(timeTick, 0.0f, false, MaxDecel);
-						VelocityNoAirControl = FVector(Velocity.X, Velocity.Y, OldVelocity.Z);
-						VelocityNoAirControl = NewFallVelocity(VelocityNoAirControl, Gravity, GravityTime);
-					}
-
-					const bool bCheckLandingSpot = false; // we already checked above.
-					AirControlAccel = (Velocity - VelocityNoAirControl) / timeTick;
-					const FVector AirControlDeltaV = LimitAirControl(LastMoveTimeSlice, AirControlAccel, Hit, bCheckLandingSpot) * LastMoveTimeSlice;
-					Adjusted = (VelocityNoAirControl + AirControlDeltaV) * LastMoveTimeSlice;
-				}
-
-				const FVector OldHitNormal = Hit.Normal;
-				const FVector OldHitImpactNormal = Hit.ImpactNormal;
-				FVector Delta = ComputeSlideVector(Adjusted, 1.f - Hit.Time, OldHitNormal, Hit);
-
-				// Compute velocity after deflection (only gravity component for RootMotion)
-				if (subTimeTickRemaining > KINDA_SMALL_NUMBER && !bJustTeleported)
-				{
-					const FVector NewVelocity = (Delta / subTimeTickRemaining);
-					Velocity = HasAnimRootMotion() || CurrentRootMotion.HasOverrideVelocityWithIgnoreZAccumulate() ? FVector(Velocity.X, Velocity.Y, NewVelocity.Z) : NewVelocity;
-				}
-
-				if (subTimeTickRemaining > KINDA_SMALL_NUMBER && (Delta | Adjusted) > 0.f)
-				{
-					// Move in deflected direction.
-					SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
-
-					if (Hit.bBlockingHit)
-					{
-						// hit second wall
-						LastMoveTimeSlice = subTimeTickRemaining;
-						subTimeTickRemaining = subTimeTickRemaining * (1.f - Hit.Time);
-
-						if (IsValidLandingSpot(UpdatedComponent->GetComponentLocation(), Hit))
-						{
-							remainingTime += subTimeTickRemaining;
-							ProcessLanded(Hit, remainingTime, Iterations);
-							return;
-						}
-
-						HandleImpact(Hit, LastMoveTimeSlice, Delta);
-
-						// If we've changed physics mode, abort.
-						if (!HasValidData() || !IsWallRunning())
-						{
-							return;
-						}
-
-						// Act as if there was no air control on the last move when computing new deflection.
-						if (bHasLimitedAirControl && Hit.Normal.Z > 0.001f)
-						{
-							const FVector LastMoveNoAirControl = VelocityNoAirControl * LastMoveTimeSlice;
-							Delta = ComputeSlideVector(LastMoveNoAirControl, 1.f, OldHitNormal, Hit);
-						}
-
-						FVector PreTwoWallDelta = Delta;
-						TwoWallAdjust(Delta, Hit, OldHitNormal);
-
-						// Limit air control, but allow a slide along the second wall.
-						if (bHasLimitedAirControl)
-						{
-							const bool bCheckLandingSpot = false; // we already checked above.
-							const FVector AirControlDeltaV = LimitAirControl(subTimeTickRemaining, AirControlAccel, Hit, bCheckLandingSpot) * subTimeTickRemaining;
-
-							// Only allow if not back in to first wall
-							if (FVector::DotProduct(AirControlDeltaV, OldHitNormal) > 0.f)
-							{
-								Delta += (AirControlDeltaV * subTimeTickRemaining);
-							}
-						}
-
-						// Compute velocity after deflection (only gravity component for RootMotion)
-						if (subTimeTickRemaining > KINDA_SMALL_NUMBER && !bJustTeleported)
-						{
-							const FVector NewVelocity = (Delta / subTimeTickRemaining);
-							Velocity = HasAnimRootMotion() || CurrentRootMotion.HasOverrideVelocityWithIgnoreZAccumulate() ? FVector(Velocity.X, Velocity.Y, NewVelocity.Z) : NewVelocity;
-						}
-
-						// bDitch=true means that pawn is straddling two slopes, neither of which he can stand on
-						bool bDitch = ((OldHitImpactNormal.Z > 0.f) && (Hit.ImpactNormal.Z > 0.f) && (FMath::Abs(Delta.Z) <= KINDA_SMALL_NUMBER) && ((Hit.ImpactNormal | OldHitImpactNormal) < 0.f));
-						SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
-						if (Hit.Time == 0.f)
-						{
-							// if we are stuck then try to side step
-							FVector SideDelta = (OldHitNormal + Hit.ImpactNormal).GetSafeNormal2D();
-							if (SideDelta.IsNearlyZero())
-							{
-								SideDelta = FVector(OldHitNormal.Y, -OldHitNormal.X, 0).GetSafeNormal();
-							}
-							SafeMoveUpdatedComponent(SideDelta, PawnRotation, true, Hit);
-						}
-
-						if (bDitch || IsValidLandingSpot(UpdatedComponent->GetComponentLocation(), Hit) || Hit.Time == 0.f)
-						{
-							remainingTime = 0.f;
-							ProcessLanded(Hit, remainingTime, Iterations);
-							return;
-						}
-						else if (GetPerchRadiusThreshold() > 0.f && Hit.Time == 1.f && OldHitImpactNormal.Z >= GetWalkableFloorZ())
-						{
-							// We might be in a virtual 'ditch' within our perch radius. This is rare.
-							const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
-							const float ZMovedDist = FMath::Abs(PawnLocation.Z - OldLocation.Z);
-							const float MovedDist2DSq = (PawnLocation - OldLocation).SizeSquared2D();
-							if (ZMovedDist <= 0.2f * timeTick && MovedDist2DSq <= 4.f * timeTick)
-							{
-								Velocity.X += 0.25f * GetMaxSpeed() * (RandomStream.FRand() - 0.5f);
-								Velocity.Y += 0.25f * GetMaxSpeed() * (RandomStream.FRand() - 0.5f);
-								Velocity.Z = FMath::Max<float>(JumpZVelocity * 0.25f, 1.f);
-								Delta = Velocity * timeTick;
-								SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
-							}
-						}
-					}
-				}
-			}
-		}
-
-		if (Velocity.SizeSquared2D() <= KINDA_SMALL_NUMBER * 10.f)
-		{
-			Velocity.X = 0.f;
-			Velocity.Y = 0.f;
-		}
-
-		
-	}
-
-}
-#pragma endregion
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "ShooterCharacterMovement.h"
+#include "Kismet/KismetSystemLibrary.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/MovementComponent.h"
+#include "GameFramework/PhysicsVolume.h"
+#include "Kismet/KismetMathLibrary.h"
+#include <DrawDebugHelpers.h>
+#include "Camera/CameraComponent.h"
+#include <Components/CapsuleComponent.h>
+#include "ShooterMovementReplication.h"
+#include "WallQueryBackend.h"
+#include "WallRunSurfaceIndex.h"
+#include "EngineUtils.h"
+#include "Engine/Engine.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "GameFramework/PlayerState.h"
+#include "Components/InputComponent.h"
+#include "Net/UnrealNetwork.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Wall Detection"), STAT_WallRunDetection, STATGROUP_WallRun);
+DECLARE_CYCLE_STAT(TEXT("State Update"), STAT_WallRunStateUpdate, STATGROUP_WallRun);
+DECLARE_CYCLE_STAT(TEXT("PhysWallRunning"), STAT_WallRunPhys, STATGROUP_WallRun);
+DECLARE_CYCLE_STAT(TEXT("Server Move Packet"), STAT_WallRunServerMove, STATGROUP_WallRun);
+DECLARE_CYCLE_STAT(TEXT("Client Replay"), STAT_WallRunReplay, STATGROUP_WallRun);
+DECLARE_CYCLE_STAT(TEXT("Trajectory Prediction"), STAT_WallRunPrediction, STATGROUP_WallRun);
+DEFINE_STAT(STAT_WallRunDetectionCalls);
+DEFINE_STAT(STAT_WallRunRaysCast);
+DEFINE_STAT(STAT_WallRunFallbackRaysCast);
+DEFINE_STAT(STAT_WallRunSubsteps);
+DEFINE_STAT(STAT_WallRunStarts);
+DEFINE_STAT(STAT_WallRunStops);
+DEFINE_STAT(STAT_WallRunChains);
+DEFINE_STAT(STAT_WallRunSurfaceLookups);
+DEFINE_STAT(STAT_WallRunPredictions);
+DEFINE_STAT(STAT_WallRunRewoundTraces);
+DEFINE_STAT(STAT_WallRunJumps);
+DEFINE_STAT(STAT_WallRunCombinedMoves);
+DEFINE_STAT(STAT_WallRunReplayedMoves);
+
+CSV_DEFINE_CATEGORY(WallRun, true);
+
+#if WALLRUN_DEBUG
+int32 CVar_WallRun_ShowAll = 0;
+static FAutoConsoleVariableRef CVarWallRunShowForces(TEXT("WallRun.ShowAll"), CVar_WallRun_ShowAll,
+	TEXT("Show all forces and events during WallRun movement"), ECVF_Default);
+
+int32 CVar_WallRun_ShowCharacterCapsule = 0;
+static FAutoConsoleVariableRef CVarWallRunShowCharacterCapsule(TEXT("WallRun.ShowCharacterCapsule"), CVar_WallRun_ShowCharacterCapsule,
+	TEXT("Show ghost of character capsule during WallRunning"), ECVF_Default);
+
+int32 CVar_WallRun_ShowJumps = 0;
+static FAutoConsoleVariableRef CVarWallRunShowJumps(TEXT("WallRun.ShowJumps"), CVar_WallRun_ShowJumps,
+	TEXT("Show [red] direction of WallRun jumps, [green] last touched point, [blue] character capsule"), ECVF_Default);
+
+int32 CVar_WallRun_ShowRunForwardVector = 0;
+static FAutoConsoleVariableRef CVarWallRunShowForwardVector(TEXT("WallRun.ShowRunForwardVector"), CVar_WallRun_ShowRunForwardVector,
+	TEXT("Show the forward direction of Wall Run (expected to be parallel with the wall)"), ECVF_Default);
+
+int32 CVar_WallRun_ShowWallNormal = 0;
+static FAutoConsoleVariableRef CVarWallRunWallNormal(TEXT("WallRun.ShowWallNormal"), CVar_WallRun_ShowWallNormal,
+	TEXT("Show the normal vector of wall face character is currently running on"), ECVF_Default);
+
+int32 CVar_WallRun_ShowGravity = 0;
+static FAutoConsoleVariableRef CVarWallRunShowGravity(TEXT("WallRun.ShowGravity"), CVar_WallRun_ShowGravity,
+	TEXT("Show the amount of gravity applied during Wall Run"), ECVF_Default);
+
+int32 CVar_WallRun_ShowWallPush = 0;
+static FAutoConsoleVariableRef CVarWallRunWallPushVelocity(TEXT("WallRun.ShowWallPush"), CVar_WallRun_ShowWallPush,
+	TEXT("Show the velocity and direction applied for character to stick to a wall"), ECVF_Default);
+
+int32 CVar_WallRun_ShowAcceleration = 0;
+static FAutoConsoleVariableRef CVarWallRunWallAcceleration(TEXT("WallRun.ShowAcceleration"), CVar_WallRun_ShowAcceleration,
+	TEXT("Show direction of acceleration applied to this character. It is expected to be parallel with the wall if character is moving forward"), ECVF_Default);
+
+int32 CVar_WallRun_ShowState = 0;
+static FAutoConsoleVariableRef CVarWallRunWallState(TEXT("WallRun.ShowState"), CVar_WallRun_ShowState,
+	TEXT("Shows character capsule coloured differently for each state. Start [green], Mid [yellow], End [red]"), ECVF_Default);
+
+int32 CVar_WallRun_ShowNormalJitter = 0;
+static FAutoConsoleVariableRef CVarWallRunShowNormalJitter(TEXT("WallRun.ShowNormalJitter"), CVar_WallRun_ShowNormalJitter,
+	TEXT("Shows how much the wall normal jumps between updates and the ratio of combined saved moves while wallrunning"), ECVF_Default);
+#endif
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+/** Casts detection fans around every wallrunning character with ECC_Visibility and with its configured channel / object types, logs the cost of both */
+static void CompareWallTraceFilters(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	const int32 NumFans = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+	FRandomStream Random(1234);
+
+	for (TObjectIterator<UShooterCharacterMovement> It; It; ++It)
+	{
+		UShooterCharacterMovement* MovementComp = *It;
+		APawn* Pawn = MovementComp->GetPawnOwner();
+		if (MovementComp->GetWorld() != World || Pawn == nullptr)
+		{
+			continue;
+		}
+
+		const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(WallRunTrace), false, Pawn);
+		const FWallQueryBackend_Physics VisibilityBackend(World, QueryParams, ECC_Visibility);
+		FWallQueryBackend_Physics FilteredBackend(World, QueryParams, MovementComp->WallRunTraceChannel);
+		if (MovementComp->WallRunObjectTypes.Num() > 0)
+		{
+			FilteredBackend.ObjectQueryParams = FCollisionObjectQueryParams(MovementComp->WallRunObjectTypes);
+		}
+
+		// Full fans (both sides, both levels) from points around the pawn
+		TArray<FVector> Starts;
+		TArray<FVector> Ends;
+		for (int32 Fan = 0; Fan < NumFans; Fan++)
+		{
+			const FVector Origin = Pawn->GetActorLocation() + Random.VRand() * FVector(1000.0f, 1000.0f, 100.0f);
+			const float Yaw = Random.FRandRange(0.0f, 360.0f);
+			for (int32 Ray = 0; Ray < MovementComp->NumberOfRaysPerSide * 2; Ray++)
+			{
+				const FVector Direction = FRotator(0.0f, Yaw + Ray * (360.0f / (MovementComp->NumberOfRaysPerSide * 2)), 0.0f).Vector();
+				for (float TopOffset : { MovementComp->FirstTraceTopOffset, MovementComp->FallbackTraceTopOffset })
+				{
+					Starts.Add(Origin + FVector(0.0f, 0.0f, TopOffset));
+					Ends.Add(Starts.Last() + Direction * MovementComp->WallDetectDistance);
+				}
+			}
+		}
+
+		auto RunQueries = [&Starts, &Ends](const IWallQueryBackend& Backend, int32& OutNumHits)
+		{
+			OutNumHits = 0;
+			FWallQueryHit Hit;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < Starts.Num(); i++)
+			{
+				OutNumHits += Backend.Raycast(Starts[i], Ends[i], Hit) ? 1 : 0;
+			}
+			return FPlatformTime::Seconds() - StartTime;
+		};
+
+		int32 NumVisibilityHits = 0;
+		int32 NumFilteredHits = 0;
+		const double VisibilityTime = RunQueries(VisibilityBackend, NumVisibilityHits);
+		const double FilteredTime = RunQueries(FilteredBackend, NumFilteredHits);
+
+		UE_LOG(LogTemp, Log, TEXT("WallRun.CompareTraceFilters - %s on %s, %d rays. Visibility: %.3f us/ray (%d hits), Wallrun filter: %.3f us/ray (%d hits)"),
+			*Pawn->GetName(), *World->GetMapName(), Starts.Num(), VisibilityTime * 1000000.0 / Starts.Num(), NumVisibilityHits, FilteredTime * 1000000.0 / Starts.Num(), NumFilteredHits);
+	}
+}
+
+static FAutoConsoleCommand CmdWallRunCompareTraceFilters(TEXT("WallRun.CompareTraceFilters"),
+	TEXT("Compares wall detection trace cost on Visibility against WallRunTraceChannel / WallRunObjectTypes around every character. Usage: WallRun.CompareTraceFilters [NumFans]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&CompareWallTraceFilters));
+#endif
+
+//----------------------------------------------------------------------//
+// UPawnMovementComponent
+//----------------------------------------------------------------------//
+UShooterCharacterMovement::UShooterCharacterMovement(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	WallRunForwardJump = FWallRunJumpSettings(1600.0f, 600.0f);
+	WallRunSideJump = FWallRunJumpSettings(700.0f, 900.0f);
+
+	SetNetworkMoveDataContainer(NetworkMoveDataContainer);
+	SetMoveResponseDataContainer(MoveResponseDataContainer);
+
+	SelectWallRunVariant();
+}
+FNetworkPredictionData_Client* UShooterCharacterMovement::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		// Return our custom client prediction class instead
+		UShooterCharacterMovement* MutableThis = const_cast<UShooterCharacterMovement*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_ShooterCharacter(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UShooterCharacterMovement::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Options are final by now (defaults, blueprint and instance overrides)
+	SelectWallRunVariant();
+
+	if (bUseBakedWallIndex)
+	{
+		for (TActorIterator<AWallRunSurfaceIndex> It(GetWorld()); It; ++It)
+		{
+			if (It->HasData())
+			{
+				BakedWallIndex = *It;
+				break;
+			}
+		}
+	}
+
+	if (bLagCompensateWallDetection && GetOwnerRole() == ROLE_Authority)
+	{
+		WallGeometryHistory = AWallGeometryHistory::GetOrCreate(GetWorld());
+	}
+}
+
+void UShooterCharacterMovement::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// Simulated proxies don't run wallrun timers, keep the replicated duration timer going for PredictWallRunTrajectory
+	if (GetOwnerRole() == ROLE_SimulatedProxy && bIsWallRunDurationTimerStarted && IsWallRunning())
+	{
+		WallRunTimeRemaining = FMath::Max(0.0f, WallRunTimeRemaining - DeltaTime);
+	}
+
+#if !WALLRUN_HEADLESS
+	// Handle camera tilting
+	if (bShouldTiltCamera)
+	{
+		// Pre-tilt towards walls we are about to run on, only the local player sees it
+		if (CharacterOwner && CharacterOwner->IsLocallyControlled())
+		{
+			CameraTiltQueryTimeRemaining -= DeltaTime;
+			if (CameraTiltQueryTimeRemaining <= 0.0f)
+			{
+				CameraTiltQueryTimeRemaining = CameraTiltQueryRate > 0.0f ? 1.0f / CameraTiltQueryRate : 0.0f;
+				UpdateCameraTiltProximity();
+			}
+		}
+
+		if ((bIsCloseToWallToTiltCamera || IsWallRunning()) && (IsFalling() || IsWallRunning())) {
+			if (IsWallRunning()) {
+				CameraTiltSide = WallRunSide;
+			}
+
+			if (CameraTiltSide == EWallRunSide::Left) {
+				CurrentCameraTiltAlpha = FMath::Max(CurrentCameraTiltAlpha - ((1.0f / CameraTiltSpeed) * DeltaTime), -1.0f);
+			}
+			else {
+				CurrentCameraTiltAlpha = FMath::Min(CurrentCameraTiltAlpha + ((1.0f / CameraTiltSpeed) * DeltaTime), 1.0f);
+			}
+		}
+		else {
+			// No longer wallrunning, tilt back to no-tilt
+			if (CurrentCameraTiltAlpha > 0) {
+				CurrentCameraTiltAlpha = FMath::Max(CurrentCameraTiltAlpha - ((1.0f / CameraTiltSpeed) * DeltaTime), 0.0f);
+			}
+			else if (CurrentCameraTiltAlpha < 0) {
+				CurrentCameraTiltAlpha = FMath::Min(CurrentCameraTiltAlpha + ((1.0f / CameraTiltSpeed) * DeltaTime), 0.0f);
+			}
+		}
+	}
+#endif
+
+#if WALLRUN_DEBUG
+	if (CVar_WallRun_ShowNormalJitter && GEngine && CharacterOwner && CharacterOwner->IsLocallyControlled())
+	{
+		const float CombineRatio = NumWallRunSavedMoves > 0 ? (float)NumWallRunCombinedMoves / NumWallRunSavedMoves : 0.0f;
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow,
+			FString::Printf(TEXT("Wall normal jitter: %.3f deg, combined moves: %.1f%% (%u / %u)"), WallNormalJitter, CombineRatio * 100.0f, NumWallRunCombinedMoves, NumWallRunSavedMoves));
+	}
+#endif
+}
+
+void UShooterCharacterMovement::MoveAutonomous(float ClientTimeStamp, float DeltaTime,
+	uint8 CompressedFlags, const FVector& NewAccel)
+{
+	FShooterCharacterNetworkMoveData* Move = static_cast<FShooterCharacterNetworkMoveData*>(GetCurrentNetworkMoveData());
+	if (Move != nullptr)
+	{
+		bWallrunWantsToUnstick = Move->bWantsToUnstick;
+		WallRunJumpInputOffset = Move->WallRunJumpInputOffset;
+		WallRunUnstickInputOffset = Move->WallRunUnstickInputOffset;
+
+		if (bVerifyClientWallClaims)
+		{
+			ServerWallClaim = (EWallRunWallClaim)Move->WallClaim;
+			ServerWallClaimImpactPoint = Move->WallClaimImpactPoint;
+		}
+
+		if (ActiveMoveCapture.IsValid() && UpdatedComponent)
+		{
+			FShooterCapturedMove& CapturedMove = ActiveMoveCapture->Moves.AddDefaulted_GetRef();
+			CapturedMove.ClientTimeStamp = ClientTimeStamp;
+			CapturedMove.DeltaTime = DeltaTime;
+			CapturedMove.CompressedFlags = CompressedFlags;
+			CapturedMove.Acceleration = NewAccel;
+			CapturedMove.Rotation = UpdatedComponent->GetComponentRotation();
+			CapturedMove.bWantsToUnstick = Move->bWantsToUnstick;
+			CapturedMove.WallClaim = Move->WallClaim;
+			CapturedMove.WallClaimImpactPoint = Move->WallClaimImpactPoint;
+			CapturedMove.WallRunJumpInputOffset = Move->WallRunJumpInputOffset;
+			CapturedMove.WallRunUnstickInputOffset = Move->WallRunUnstickInputOffset;
+		}
+	}
+
+	// Walls as they were when the client made this move
+	const AWallGeometryHistory* History = WallGeometryHistory.Get();
+	if (bRewindWallQueries && History)
+	{
+		BatchedTraceContext.RewoundBackend = FWallQueryBackend_Rewound(BatchedTraceContext.PhysicsBackend, *History, ClientTimeStamp + ClientToServerTimeOffset, CharacterOwner);
+		BatchedTraceContext.BackendOverride = BatchedTraceContext.RewoundBackend.HasRewoundComponents() ? &BatchedTraceContext.RewoundBackend : nullptr;
+	}
+
+	Super::MoveAutonomous(
+		ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
+
+	// Claim and input offsets are only valid for the move they came with
+	ServerWallClaim = EWallRunWallClaim::None;
+	WallRunJumpInputOffset = 0;
+	WallRunUnstickInputOffset = 0;
+}
+
+void UShooterCharacterMovement::StartMoveCapture()
+{
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	ActiveMoveCapture = MakeShared<FShooterMoveCapture>();
+	ActiveMoveCapture->MapName = GetWorld()->GetMapName();
+	ActiveMoveCapture->StartLocation = UpdatedComponent->GetComponentLocation();
+	ActiveMoveCapture->StartRotation = UpdatedComponent->GetComponentRotation();
+	ActiveMoveCapture->StartVelocity = Velocity;
+	ActiveMoveCapture->StartMovementMode = MovementMode;
+	ActiveMoveCapture->StartCustomMovementMode = CustomMovementMode;
+	ActiveMoveCapture->StartJumpCurrentCount = CharacterOwner->JumpCurrentCount;
+	ActiveMoveCapture->StartWallRun = FWallRunStateSnapshot::Capture(*this);
+	ActiveMoveCapture->bStartWantsToUnstick = bWallrunWantsToUnstick;
+}
+
+TSharedPtr<FShooterMoveCapture> UShooterCharacterMovement::StopMoveCapture()
+{
+	TSharedPtr<FShooterMoveCapture> Capture = ActiveMoveCapture;
+	if (Capture.IsValid())
+	{
+		Capture->FinalStateHash = GetMovementStateHash();
+	}
+	ActiveMoveCapture.Reset();
+	return Capture;
+}
+
+FShooterMoveReplayResult UShooterCharacterMovement::ReplayMoveCapture(const FShooterMoveCapture& Capture)
+{
+	FShooterMoveReplayResult Result;
+	if (!HasValidData())
+	{
+		return Result;
+	}
+
+	// Replayed moves go through MoveAutonomous and would end up in the capture
+	if (ActiveMoveCapture.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UShooterCharacterMovement::ReplayMoveCapture - %s is being captured, stop the capture before replaying with it"), *GetNameSafe(CharacterOwner));
+		return Result;
+	}
+
+	// Same starting point as the captured character
+	UpdatedComponent->SetWorldLocationAndRotation(Capture.StartLocation, Capture.StartRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	Velocity = Capture.StartVelocity;
+
+	// Mode change may end a wallrun and reset its timers, the captured wallrun state goes on top
+	SetMovementMode((EMovementMode)Capture.StartMovementMode, Capture.StartCustomMovementMode);
+	Capture.StartWallRun.Restore(*this);
+	bWallrunWantsToUnstick = Capture.bStartWantsToUnstick;
+	CharacterOwner->JumpCurrentCount = Capture.StartJumpCurrentCount;
+	bWallRunJumpDeferred = false;
+	ServerWallClaim = EWallRunWallClaim::None;
+	WallRunJumpInputOffset = 0;
+	WallRunUnstickInputOffset = 0;
+
+	// Count rays going to the backend detection would normally use
+	const TSharedPtr<IWallQueryBackend> PreviousBackendOverride = WallQueryBackendOverride;
+	WallQueryBackendOverride.Reset();
+	FWallRunTraceContext DefaultTraceContext;
+	InitWallRunTraceContext(DefaultTraceContext);
+	TSharedRef<FWallQueryBackend_Counting> CountingBackend = MakeShared<FWallQueryBackend_Counting>(DefaultTraceContext.GetBackend());
+	WallQueryBackendOverride = CountingBackend;
+
+	FShooterCharacterNetworkMoveData MoveData;
+	FCharacterNetworkMoveData* PreviousMoveData = GetCurrentNetworkMoveData();
+	SetCurrentNetworkMoveData(&MoveData);
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (const FShooterCapturedMove& CapturedMove : Capture.Moves)
+	{
+		MoveData.TimeStamp = CapturedMove.ClientTimeStamp;
+		MoveData.Acceleration = CapturedMove.Acceleration;
+		MoveData.CompressedMoveFlags = CapturedMove.CompressedFlags;
+		MoveData.bWantsToUnstick = CapturedMove.bWantsToUnstick;
+		MoveData.WallClaim = CapturedMove.WallClaim;
+		MoveData.WallClaimImpactPoint = CapturedMove.WallClaimImpactPoint;
+		MoveData.WallRunJumpInputOffset = CapturedMove.WallRunJumpInputOffset;
+		MoveData.WallRunUnstickInputOffset = CapturedMove.WallRunUnstickInputOffset;
+
+		// Server applies client rotation before the move
+		UpdatedComponent->SetWorldRotation(CapturedMove.Rotation);
+		MoveAutonomous(CapturedMove.ClientTimeStamp, CapturedMove.DeltaTime, CapturedMove.CompressedFlags, CapturedMove.Acceleration);
+	}
+	Result.CpuTime = FPlatformTime::Seconds() - StartTime;
+
+	SetCurrentNetworkMoveData(PreviousMoveData);
+	WallQueryBackendOverride = PreviousBackendOverride;
+
+	Result.NumMoves = Capture.Moves.Num();
+	Result.NumRaysCast = CountingBackend->NumRaysCast;
+	Result.FinalStateHash = GetMovementStateHash();
+	Result.bMatchesCapture = Result.FinalStateHash == Capture.FinalStateHash;
+	return Result;
+}
+
+uint32 UShooterCharacterMovement::GetMovementStateHash() const
+{
+	uint32 Hash = 0;
+	auto HashValue = [&Hash](const auto& Value)
+	{
+		Hash = FCrc::MemCrc32(&Value, sizeof(Value), Hash);
+	};
+
+	if (UpdatedComponent)
+	{
+		HashValue(UpdatedComponent->GetComponentLocation());
+		HashValue(UpdatedComponent->GetComponentRotation());
+	}
+	HashValue(Velocity);
+	HashValue(MovementMode);
+	HashValue(CustomMovementMode);
+	HashValue(WallRunSide);
+	HashValue(WallRunState);
+	HashValue(CurrentWallRunSurface);
+	HashValue(WallRunWallNormal);
+	HashValue(WallRunTimeRemaining);
+	HashValue(WallRunCooldownLeftTimeRemaining);
+	HashValue(WallRunCooldownRightTimeRemaining);
+	HashValue(WantsToUnstickTimeRemaining);
+	HashValue(CurrentWallRunEndGravity);
+	HashValue(bIsWallRunDurationTimerStarted);
+	HashValue(WallRunTimerTickRemainder);
+	const bool bWantsToUnstick = bWallrunWantsToUnstick;
+	HashValue(bWantsToUnstick);
+	return Hash;
+}
+
+bool UShooterCharacterMovement::CanDelaySendingMove(const FSavedMovePtr& NewMove)
+{
+	// Wallrun transitions (start, jump, state or side change) go out right away
+	const FSavedMove_ShooterCharacter* ShooterMove = static_cast<const FSavedMove_ShooterCharacter*>(NewMove.Get());
+	if (ShooterMove && ShooterMove->bWallRunTransition)
+	{
+		return false;
+	}
+
+	return Super::CanDelaySendingMove(NewMove);
+}
+
+float UShooterCharacterMovement::GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const
+{
+	float NetSendDeltaTime = Super::GetClientNetSendDeltaTime(PC, ClientData, NewMove);
+
+	// Steady wallrun is very predictable, wait a bit longer so more moves get combined
+	const FSavedMove_ShooterCharacter* ShooterMove = static_cast<const FSavedMove_ShooterCharacter*>(NewMove.Get());
+	if (ShooterMove && ShooterMove->bWallRunSteady)
+	{
+		NetSendDeltaTime *= WallRunSteadyNetSendIntervalScale;
+	}
+
+	return NetSendDeltaTime;
+}
+
+
+
+void UShooterCharacterMovement::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	// TODO: Move this logic to pre-tick or something, since this is effecting the next frame
+	APawn* Pawn = GetPawnOwner();
+	if (Pawn == nullptr) {
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_WallRunStateUpdate);
+	CSV_SCOPED_TIMING_STAT(WallRun, StateUpdate);
+	(this->*WallRunStateUpdateFunc)(DeltaSeconds);
+}
+
+template<bool bInfinite, bool bPreventMovingBackwards>
+void UShooterCharacterMovement::UpdateWallRunState(float DeltaSeconds)
+{
+	// Update wallrunning state
+#if WALLRUN_DEBUG
+	const FVector PreviousWallNormal = WallRunWallNormal;
+	const bool bWasWallRunning = IsWallRunning();
+#endif
+	if (IsFalling() || IsWallRunning())
+	{
+		if (!IsWallRunning()) {
+			// Not wallrunning and falling only
+			// Trace line for nearby walls
+			FVector WallNormal;
+			FVector ImpactPoint;
+			if (CanStartWallRunSideImpl<bPreventMovingBackwards>(EWallRunSide::Left, WallNormal, ImpactPoint)) {
+				StartWallRunning(EWallRunSide::Left, WallNormal, ImpactPoint);
+			}
+			else if (CanStartWallRunSideImpl<bPreventMovingBackwards>(EWallRunSide::Right, WallNormal, ImpactPoint)) {
+				StartWallRunning(EWallRunSide::Right, WallNormal, ImpactPoint);
+			}
+
+		}
+		else if (IsWallRunningSide(EWallRunSide::Left)) {
+			// Already wallrunning Left
+			// If we are no longer running at wall
+			// If we are still running, this will update the wall normal
+			if (TraceNearbyForWalls(EWallRunSide::Left, true, WallRunWallNormal, WallRunTraceImpactPoint)) {
+				UpdateWallRunBase();
+			}
+			else if (!bAllowWallRunChaining || !TryChainWallRun<bPreventMovingBackwards>(EWallRunSide::Left)) {
+				StopWallRunning();
+			}
+		}
+		else {
+			// Already wallrunning right
+			// If we are no longer running at wall
+			// If we are still running, this will update the wall normal
+			if (TraceNearbyForWalls(EWallRunSide::Right, true, WallRunWallNormal, WallRunTraceImpactPoint)) {
+				UpdateWallRunBase();
+			}
+			else if (!bAllowWallRunChaining || !TryChainWallRun<bPreventMovingBackwards>(EWallRunSide::Right)) {
+				StopWallRunning();
+			}
+		}
+	}
+	
+
+#if WALLRUN_DEBUG
+	// How much the normal moved since last update, averaged over ~10 updates
+	if (bWasWallRunning && IsWallRunning())
+	{
+		const float NormalDelta = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(FVector::DotProduct(PreviousWallNormal, WallRunWallNormal), -1.0f, 1.0f)));
+		WallNormalJitter = FMath::Lerp(WallNormalJitter, NormalDelta, 0.1f);
+	}
+#endif
+
+	// Remember what detection found, client sends it to the server along with the move.
+	// Impact points on moving walls depend on when the wall is sampled, the server detects those itself.
+	// No wall is not claimed, the server would have to run the full fan to check it anyway.
+	if (IsWallRunning() && !IsWallRunningOnMovingWall()) {
+		DetectedWallClaim = WallRunSide == EWallRunSide::Left ? EWallRunWallClaim::Left : EWallRunWallClaim::Right;
+	}
+	else {
+		DetectedWallClaim = EWallRunWallClaim::None;
+	}
+
+	// Wallrunnign Update state
+	if (IsWallRunning() && WallRunState == EWallRunState::Start && Velocity.Z <= WallRunMidZVelocityThreshold)
+	{
+		WallRunState = EWallRunState::Mid;
+		// Set timer for duration of "Mid" section of WallRun
+		if (!bInfinite) {
+			bIsWallRunDurationTimerStarted = true;
+		}
+	}
+
+	
+	// If in end state, gradually increase gravity until desired gravity is reached
+	if (IsWallRunning() && WallRunState == EWallRunState::End)
+	{
+		if (CurrentWallRunEndGravity < WallRunGravityEndState)
+		{
+			CurrentWallRunEndGravity = FMath::Min(WallRunGravityEndState, CurrentWallRunEndGravity + ((1.0f / WallRunGravityEndStateApplySpeed) * DeltaSeconds));
+		}
+	}
+
+	// Update WallRun Timers
+	UpdateWallRunTimers(DeltaSeconds);
+}
+
+void UShooterCharacterMovement::SelectWallRunVariant()
+{
+	static const FWallRunStateUpdateFunc StateUpdateVariants[2][2] = {
+		{ &UShooterCharacterMovement::UpdateWallRunState<false, false>, &UShooterCharacterMovement::UpdateWallRunState<false, true> },
+		{ &UShooterCharacterMovement::UpdateWallRunState<true, false>, &UShooterCharacterMovement::UpdateWallRunState<true, true> },
+	};
+	static const FPhysWallRunningFunc PhysVariants[2] = {
+		&UShooterCharacterMovement::PhysWallRunningImpl<false>,
+		&UShooterCharacterMovement::PhysWallRunningImpl<true>,
+	};
+
+	WallRunStateUpdateFunc = StateUpdateVariants[bIsWallRunInfinite ? 1 : 0][bPreventWallRunIfMovingBackwards ? 1 : 0];
+	PhysWallRunningFunc = PhysVariants[bScaleWallRunGravityWithSpeed ? 1 : 0];
+}
+
+void UShooterCharacterMovement::SetWallRunInfinite(bool bInfinite)
+{
+	bIsWallRunInfinite = bInfinite;
+	SelectWallRunVariant();
+}
+
+void UShooterCharacterMovement::SetScaleWallRunGravityWithSpeed(bool bScaleWithSpeed)
+{
+	bScaleWallRunGravityWithSpeed = bScaleWithSpeed;
+	SelectWallRunVariant();
+}
+
+void UShooterCharacterMovement::SetPreventWallRunIfMovingBackwards(bool bPrevent)
+{
+	bPreventWallRunIfMovingBackwards = bPrevent;
+	SelectWallRunVariant();
+}
+
+#if WITH_EDITOR
+void UShooterCharacterMovement::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	const FName PropertyName = PropertyChangedEvent.GetPropertyName();
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UShooterCharacterMovement, bIsWallRunInfinite)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(UShooterCharacterMovement, bScaleWallRunGravityWithSpeed)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(UShooterCharacterMovement, bPreventWallRunIfMovingBackwards))
+	{
+		SelectWallRunVariant();
+	}
+}
+#endif
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+/** Times the specialized variants called through the selected member function pointers against picking them by branching on the options every call */
+static void BenchmarkWallRunVariants(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	const int32 NumIterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+	const float DeltaSeconds = 1.0f / 60.0f;
+
+	for (TObjectIterator<UShooterCharacterMovement> It; It; ++It)
+	{
+		UShooterCharacterMovement* MovementComp = *It;
+		if (MovementComp->GetWorld() != World || !MovementComp->HasValidData())
+		{
+			continue;
+		}
+
+		// Every call starts from the same state, only the dispatched call itself is timed
+		const FVector StartLocation = MovementComp->UpdatedComponent->GetComponentLocation();
+		const FQuat StartRotation = MovementComp->UpdatedComponent->GetComponentQuat();
+		const FVector StartVelocity = MovementComp->Velocity;
+		const EMovementMode StartMovementMode = MovementComp->MovementMode;
+		const uint8 StartCustomMovementMode = MovementComp->CustomMovementMode;
+		const FWallRunStateSnapshot StartWallRun = FWallRunStateSnapshot::Capture(*MovementComp);
+		const bool bStartWallRunning = MovementComp->IsWallRunning();
+		auto RestoreStart = [&]()
+		{
+			MovementComp->UpdatedComponent->SetWorldLocationAndRotation(StartLocation, StartRotation, false, nullptr, ETeleportType::TeleportPhysics);
+			MovementComp->Velocity = StartVelocity;
+			MovementComp->SetMovementMode(StartMovementMode, StartCustomMovementMode);
+			StartWallRun.Restore(*MovementComp);
+		};
+
+		auto TimeCalls = [&](auto&& Call)
+		{
+			uint64 Cycles = 0;
+			for (int32 i = 0; i < NumIterations; i++)
+			{
+				RestoreStart();
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				Call();
+				Cycles += FPlatformTime::Cycles64() - StartCycles;
+			}
+			return FPlatformTime::ToMilliseconds64(Cycles) * 1000.0 / NumIterations;
+		};
+
+		const double StatePointerTime = TimeCalls([&]() { (MovementComp->*MovementComp->WallRunStateUpdateFunc)(DeltaSeconds); });
+		const double StateBranchingTime = TimeCalls([&]()
+		{
+			if (MovementComp->bIsWallRunInfinite)
+			{
+				MovementComp->bPreventWallRunIfMovingBackwards ? MovementComp->UpdateWallRunState<true, true>(DeltaSeconds) : MovementComp->UpdateWallRunState<true, false>(DeltaSeconds);
+			}
+			else
+			{
+				MovementComp->bPreventWallRunIfMovingBackwards ? MovementComp->UpdateWallRunState<false, true>(DeltaSeconds) : MovementComp->UpdateWallRunState<false, false>(DeltaSeconds);
+			}
+		});
+
+		// Wallrun physics only makes sense on a wall
+		double PhysPointerTime = 0.0;
+		double PhysBranchingTime = 0.0;
+		if (bStartWallRunning)
+		{
+			PhysPointerTime = TimeCalls([&]() { (MovementComp->*MovementComp->PhysWallRunningFunc)(DeltaSeconds, 0); });
+			PhysBranchingTime = TimeCalls([&]()
+			{
+				MovementComp->bScaleWallRunGravityWithSpeed ? MovementComp->PhysWallRunningImpl<true>(DeltaSeconds, 0) : MovementComp->PhysWallRunningImpl<false>(DeltaSeconds, 0);
+			});
+		}
+
+		RestoreStart();
+
+		UE_LOG(LogTemp, Log, TEXT("WallRun.BenchmarkVariants - %s, %d calls. State update: pointer %.3f us, branching %.3f us. Physics: %s"),
+			*MovementComp->GetPawnOwner()->GetName(), NumIterations, StatePointerTime, StateBranchingTime,
+			bStartWallRunning ? *FString::Printf(TEXT("pointer %.3f us, branching %.3f us"), PhysPointerTime, PhysBranchingTime) : TEXT("not wallrunning, skipped"));
+	}
+}
+
+static FAutoConsoleCommand CmdWallRunBenchmarkVariants(TEXT("WallRun.BenchmarkVariants"),
+	TEXT("Times wallrun state update and physics of every character called through the selected variant pointers against branching on the options every call. Usage: WallRun.BenchmarkVariants [NumCalls]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkWallRunVariants));
+#endif
+
+int32 UShooterCharacterMovement::WallRunTimeToTicks(float Seconds) const
+{
+	return FMath::RoundToInt(Seconds * WallRunTimerTicksPerSecond);
+}
+
+float UShooterCharacterMovement::WallRunTicksToTime(int32 Ticks) const
+{
+	return (float)Ticks / WallRunTimerTicksPerSecond;
+}
+
+float UShooterCharacterMovement::QuantizeWallRunTime(float Seconds) const
+{
+	if (!bUseQuantizedWallRunTimers)
+	{
+		return Seconds;
+	}
+	return WallRunTicksToTime(WallRunTimeToTicks(Seconds));
+}
+
+void UShooterCharacterMovement::UpdateWallRunTimers(float DeltaSeconds)
+{
+	// Timers are stored as floats either way, but when quantized they only ever hold whole ticks and all math is done on integers.
+	// Only whole ticks of the delta are counted down, the fraction left over is carried into the next move (and saved with it),
+	// so timers run at real time speed on any frame rate. Client and server step the same tick count as long as they see
+	// the same move deltas, which the saved move guarantees up to the precision DeltaTime is sent with.
+	int32 DeltaTicks = 0;
+	if (bUseQuantizedWallRunTimers)
+	{
+		const float Ticks = DeltaSeconds * WallRunTimerTicksPerSecond + WallRunTimerTickRemainder;
+		DeltaTicks = FMath::FloorToInt(Ticks);
+		WallRunTimerTickRemainder = Ticks - DeltaTicks;
+	}
+	auto CountDown = [this, DeltaSeconds, DeltaTicks](float& TimeRemaining)
+	{
+		if (bUseQuantizedWallRunTimers)
+		{
+			TimeRemaining = WallRunTicksToTime(FMath::Max(0, WallRunTimeToTicks(TimeRemaining) - DeltaTicks));
+		}
+		else
+		{
+			TimeRemaining = FMath::Max(0.0f, TimeRemaining - DeltaSeconds);
+		}
+	};
+
+	// Unstick Timer
+	if (bWallrunWantsToUnstick)
+	{
+		// Pressed part way through this move, the timer only runs from that instant
+		if (WallRunUnstickInputOffset > 0)
+		{
+			WantsToUnstickTimeRemaining += QuantizeWallRunTime(DeltaSeconds * WallRunUnstickInputOffset / 256.0f);
+		}
+		CountDown(WantsToUnstickTimeRemaining);
+		if (WantsToUnstickTimeRemaining <= 0.0f)
+		{
+			UnstickFromWall_Internal();
+		}
+	}
+	else {
+		WantsToUnstickTimeRemaining = QuantizeWallRunTime(UnstickFromWallTimeThreshold);
+	}
+
+	// WallRun Cooldowns
+	if (WallRunCooldownLeftTimeRemaining > 0.0f)
+	{
+		CountDown(WallRunCooldownLeftTimeRemaining);
+	}
+
+	if (WallRunCooldownRightTimeRemaining > 0.0f)
+	{
+		CountDown(WallRunCooldownRightTimeRemaining);
+	}
+
+	// Wallrun duration timer
+	if (bIsWallRunDurationTimerStarted && IsWallRunning() && WallRunTimeRemaining > 0.0f)
+	{
+		CountDown(WallRunTimeRemaining);
+		if (WallRunTimeRemaining <= 0.0f && WallRunState != EWallRunState::End)
+		{
+			TransitionWallRunToEndState();
+		}
+	}
+}
+
+void UShooterCharacterMovement::UpdateCharacterStateAfterMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateAfterMovement(DeltaSeconds);
+
+	// Wallrun ended before PhysWallRunning got to the deferred jump, don't drop the press and jump now instead
+	if (bWallRunJumpDeferred)
+	{
+		bWallRunJumpDeferred = false;
+		TGuardValue<uint8> JumpNow(WallRunJumpInputOffset, 0);
+		DoJump(bWallRunJumpDeferredReplaying);
+	}
+
+	if (GetOwnerRole() == ROLE_Authority && IsWallRunning())
+	{
+		UpdateReplicatedWallRunState();
+	}
+}
+
+void UShooterCharacterMovement::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Owning client simulates the wallrun itself
+	DOREPLIFETIME_CONDITION(UShooterCharacterMovement, ReplicatedWallRunState, COND_SimulatedOnly);
+}
+
+void UShooterCharacterMovement::UpdateReplicatedWallRunState()
+{
+	// Proxies count the duration timer down themselves, it's only sent along with a change of anything else
+	FWallRunProxyState& State = ReplicatedWallRunState;
+	const bool bChanged = State.State != WallRunState
+		|| State.Side != WallRunSide
+		|| State.bDurationTimerStarted != bIsWallRunDurationTimerStarted
+		|| FVector::DotProduct(State.WallNormal, WallRunWallNormal) < 0.999f
+		|| FMemory::Memcmp(&State.Surface, &CurrentWallRunSurface, sizeof(FWallRunSurfaceParams)) != 0;
+	if (bChanged)
+	{
+		State.State = WallRunState;
+		State.Side = WallRunSide;
+		State.bDurationTimerStarted = bIsWallRunDurationTimerStarted;
+		State.TimeRemaining = WallRunTimeRemaining;
+		State.WallNormal = WallRunWallNormal;
+		State.Surface = CurrentWallRunSurface;
+	}
+}
+
+void UShooterCharacterMovement::OnRep_ReplicatedWallRunState()
+{
+	WallRunState = ReplicatedWallRunState.State;
+	WallRunSide = ReplicatedWallRunState.Side;
+	bIsWallRunDurationTimerStarted = ReplicatedWallRunState.bDurationTimerStarted;
+	WallRunTimeRemaining = ReplicatedWallRunState.TimeRemaining;
+	WallRunWallNormal = ReplicatedWallRunState.WallNormal;
+	CurrentWallRunSurface = ReplicatedWallRunState.Surface;
+}
+
+bool UShooterCharacterMovement::DoJump(bool bReplayingMoves)
+{
+	// Implementation taken from CharacterMovementComponent::DoJump but added chase for wallrunning
+	if(CharacterOwner){
+		if (IsWallRunning()) 
+		{
+			if (WallRunJumpInputOffset > 0)
+			{
+				bWallRunJumpDeferred = true;
+				bWallRunJumpDeferredReplaying = bReplayingMoves;
+			}
+			else
+			{
+				DoWallRunJump(bReplayingMoves);
+			}
+		}
+		else if(CharacterOwner->CanJump()) // Default jump
+		{
+			// Don't jump if we can't move up/down.
+			if (!bConstrainToPlane || FMath::Abs(PlaneConstraintNormal.Z) != 1.f)
+			{
+				Velocity.Z = FMath::Max(Velocity.Z, JumpZVelocity);
+				SetMovementMode(MOVE_Falling);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void UShooterCharacterMovement::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+{
+	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+
+
+}
+
+void UShooterCharacterMovement::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+}
+
+
+void UShooterCharacterMovement::PhysCustom(float deltaTime, int32 Iterations)
+{
+	switch (CustomMovementMode)
+	{
+	case ECustomMovementMode::CMOVE_WallRunning:
+	{
+		PhysWallRunning(deltaTime, Iterations);
+		break;
+	}
+	}
+
+	// Not sure if this is needed
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+
+float UShooterCharacterMovement::GetMaxSpeed() const
+{
+	switch (MovementMode)
+	{
+	case MOVE_Walking:
+	case MOVE_NavWalking:
+	{
+		if (IsCrouching())
+		{
+			return MaxWalkSpeedCrouched;
+		}
+		else
+		{
+
+			return RunSpeed;
+		}
+	}
+	case MOVE_Falling:
+		return MaxWalkSpeed;
+	case MOVE_Swimming:
+		return MaxSwimSpeed;
+	case MOVE_Flying:
+		return MaxFlySpeed;
+	case MOVE_Custom:
+		switch (CustomMovementMode)
+		{
+		case CMOVE_WallRunning:
+		{
+			return WallRunSpeed * CurrentWallRunSurface.SpeedScale;
+		}
+		default:
+			return MaxCustomMovementSpeed;
+		}
+
+	case MOVE_None:
+	default:
+		return 0.f;
+	}
+}
+
+float UShooterCharacterMovement::GetMaxAcceleration() const
+{
+	if (MovementMode == MOVE_Custom)
+	{
+		switch (CustomMovementMode)
+		{
+		case CMOVE_WallRunning:
+		{
+			return WallRunAcceleration;
+		}
+		default:
+			return Super::GetMaxAcceleration();
+		}
+	}
+
+	return Super::GetMaxAcceleration();
+}
+
+float UShooterCharacterMovement::GetMaxBrakingDeceleration() const
+{
+	if (MovementMode == MOVE_Custom)
+	{
+		switch (CustomMovementMode)
+		{
+		case CMOVE_WallRunning:
+		{
+			return BrakingDecelerationWallRunning;
+		}
+		default:
+			return Super::GetMaxBrakingDeceleration();
+		}
+	}
+
+	return Super::GetMaxBrakingDeceleration();
+}
+
+void UShooterCharacterMovement::ProcessLanded(const FHitResult& Hit, float remainingTime, int32 Iterations)
+{
+
+	// If we landed while wall running, make sure we stop wall running
+	if (IsWallRunning())
+	{
+		StopWallRunning();
+	}
+
+
+	Super::ProcessLanded(Hit, remainingTime, Iterations);
+}
+
+void UShooterCharacterMovement::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	// Read the values from the compressed flags
+	// bWallrunWantsToUnstick = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+}
+
+
+
+#pragma region WallRun
+FVector UShooterCharacterMovement::CalcWallRunJumpVelocity(const FVector& InVelocity, const FVector& AimForward, EWallRunSide Side) const
+{
+	// We calculate a deviation angle from the wallrun direction
+			// And base the jump direction, velocity (horizontal and vertical) based on that angle
+			// More acute angle results in faster jump (but not as much Z) and vise-versa
+	FVector JumpVelocity = InVelocity;
+
+	// This is -180 to 180 angle compared to wallrun direction
+	float AimAngle = FMath::UnwindDegrees(UKismetMathLibrary::DegAtan2(AimForward.X, AimForward.Y) - UKismetMathLibrary::DegAtan2(JumpVelocity.X, JumpVelocity.Y));
+
+	bool bIsFacingIntoWall = false;
+	if ((Side == EWallRunSide::Left && AimAngle < 0.0f) ||
+		(Side == EWallRunSide::Right && AimAngle > 0.0f))
+	{
+		bIsFacingIntoWall = true;
+	}
+
+	AimAngle = FMath::Abs(AimAngle);
+
+	// From 15 (min angle) to 90 (max angle) 
+	AimAngle = FMath::Clamp(AimAngle, MinimumWallrunJumpAngle, MaximumWallrunJumpAngle);
+	// 0 to 1 from Min Angle to Max Angle
+	float AimAngleLerpAlpha = (AimAngle - MinimumWallrunJumpAngle) / MaximumWallrunJumpAngle;
+
+	// Calculate Jump Velocity based on angle
+	float NewZVelocity = FMath::Lerp(WallRunForwardJump.UpVelocity, WallRunSideJump.UpVelocity, AimAngleLerpAlpha);
+	float NewXYVelocity = FMath::Lerp(WallRunForwardJump.ForwardVelocity, WallRunSideJump.ForwardVelocity, AimAngleLerpAlpha);
+
+	// Set Z velocity
+	JumpVelocity.Z = FMath::Max(JumpVelocity.Z, NewZVelocity);
+
+	// Current velocity (the wallrun direction) * New velocity 
+	// This results in correct magnitude but it is in direction of wall run, we rotate it later
+	FVector2D HorizontalVelocity = FVector2D(JumpVelocity.X, JumpVelocity.Y).GetSafeNormal() * NewXYVelocity;
+	JumpVelocity.X = HorizontalVelocity.X;
+	JumpVelocity.Y = HorizontalVelocity.Y;
+
+	// Rotate jump direction
+	if (Side == EWallRunSide::Left) {
+		JumpVelocity = UKismetMathLibrary::RotateAngleAxis(JumpVelocity, AimAngle, FVector(0.0f, 0.0f, 1.0f));
+	}
+	else {
+		JumpVelocity = UKismetMathLibrary::RotateAngleAxis(JumpVelocity, -AimAngle, FVector(0.0f, 0.0f, 1.0f));
+	}
+	//UE_LOG(LogTemp, Log, TEXT("WallRun Jump - Player Look Angle: %f, Velocity Lerp: %f, New XY Magniture: %f"), AimAngle, AimAngleLerpAlpha, NewXYVelocity);
+
+	return JumpVelocity;
+}
+
+void UShooterCharacterMovement::DoWallRunJump(bool bReplayingMoves)
+{
+	WALLRUN_INC_COUNTER(Jumps, 1);
+
+	Velocity = CalcWallRunJumpVelocity(Velocity, GetPawnOwner()->GetActorForwardVector(), WallRunSide);
+
+#if WALLRUN_DEBUG
+	// Debug Jump Arrow
+	if (CVar_WallRun_ShowAll || CVar_WallRun_ShowJumps)
+	{
+		FVector PawnLoc = GetPawnOwner()->GetActorLocation();
+
+		// Draw where was the last "contact" point
+		DrawDebugPoint(GetWorld(), WallRunTraceImpactPoint, 10.0f, FColor::Green, false, 20.0f);
+		// Draw the direction and velocity of jump
+		DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + Velocity.GetSafeNormal() * 200.0f, 60.f, FColor::Red, false, 20.0f, 0, 2.f);
+
+		// Draw character capsule (If owned by character which as capsule)
+		if (ACharacter* Character = Cast<ACharacter>(GetPawnOwner())) {
+			UCapsuleComponent* CharacterCapsule = Character->GetCapsuleComponent();
+			if (CharacterCapsule) {
+				FVector CapsuleLoc = CharacterCapsule->GetComponentLocation();
+				float HalfHeight = CharacterCapsule->GetScaledCapsuleHalfHeight();
+				float Radius = CharacterCapsule->GetScaledCapsuleRadius();
+				FRotator Rotation = CharacterCapsule->GetComponentRotation();
+
+				DrawDebugCapsule(GetWorld(), CapsuleLoc, HalfHeight, Radius, Rotation.Quaternion(), FColor::Blue, false, 20.0f, 0, 0.5f);
+			}
+		}
+	}
+#endif
+	StopWallRunning();
+}
+
+
+void UShooterCharacterMovement::StartWallRunning(EWallRunSide Side, FVector InWallNormal, FVector InWallRunTraceImpactPoint)
+{
+	WALLRUN_INC_COUNTER(Starts, 1);
+
+	// Clean up
+	WallRunState = EWallRunState::Start;
+	bWallrunWantsToUnstick = false;
+	WantsToUnstickTimeRemaining = 0.0f;
+	bIsWallRunDurationTimerStarted = false;
+
+	ResolveWallRunSurface();
+	WallRunTimeRemaining = QuantizeWallRunTime(WallRunDuration * CurrentWallRunSurface.DurationScale);
+	WallRunSide = Side;
+	WallRunWallNormal = InWallNormal;
+	WallRunTraceImpactPoint = InWallRunTraceImpactPoint;
+	
+	Velocity.Z = FMath::Max(Velocity.Z, WallRunStartZVelocity);
+
+	SetMovementMode(EMovementMode::MOVE_Custom, ECustomMovementMode::CMOVE_WallRunning);
+	UpdateWallRunBase();
+}
+
+void UShooterCharacterMovement::ResolveWallRunSurface()
+{
+	CurrentWallRunSurface = FWallRunSurfaceParams();
+	if (WallRunSurfaceOverrides.Num() == 0)
+	{
+		return;
+	}
+
+	WALLRUN_INC_COUNTER(SurfaceLookups, 1);
+	if (UPhysicalMaterial* WallMaterial = DetectedWallPhysMaterial.Get())
+	{
+		if (const FWallRunSurfaceParams* Params = WallRunSurfaceOverrides.Find(WallMaterial))
+		{
+			CurrentWallRunSurface = *Params;
+		}
+	}
+}
+
+void UShooterCharacterMovement::UpdateWallRunBase()
+{
+	UPrimitiveComponent* Wall = bSupportMovingWalls ? DetectedWallComponent.Get() : nullptr;
+	if (Wall && Wall->Mobility != EComponentMobility::Movable)
+	{
+		Wall = nullptr;
+	}
+
+	UPrimitiveComponent* CurrentBase = CharacterOwner ? CharacterOwner->GetMovementBase() : nullptr;
+	if (Wall != CurrentBase)
+	{
+		// Velocity is relative to the base while based, the base carries the character along
+		if (CurrentBase)
+		{
+			Velocity += CurrentBase->GetComponentVelocity();
+		}
+		if (Wall)
+		{
+			Velocity -= Wall->GetComponentVelocity();
+		}
+		SetBase(Wall);
+	}
+
+	if (Wall)
+	{
+		WallRunLocalWallNormal = Wall->GetComponentQuat().UnrotateVector(WallRunWallNormal);
+	}
+}
+
+bool UShooterCharacterMovement::IsWallRunningOnMovingWall() const
+{
+	return bSupportMovingWalls && MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_WallRunning
+		&& CharacterOwner && CharacterOwner->GetMovementBase() != nullptr;
+}
+
+template<bool bPreventMovingBackwards>
+bool UShooterCharacterMovement::TryChainWallRun(EWallRunSide Side)
+{
+	const EWallRunSide OtherSide = Side == EWallRunSide::Left ? EWallRunSide::Right : EWallRunSide::Left;
+
+	FVector WallNormal;
+	FVector ImpactPoint;
+	if (!CanStartWallRunSideImpl<bPreventMovingBackwards>(OtherSide, WallNormal, ImpactPoint))
+	{
+		return false;
+	}
+
+	// Same as stopping and starting again, just without the falling mode in between
+	WALLRUN_INC_COUNTER(Chains, 1);
+	StartWallRunCooldown(Side);
+	StartWallRunning(OtherSide, WallNormal, ImpactPoint);
+	return true;
+}
+
+void UShooterCharacterMovement::StopWallRunning()
+{
+	WALLRUN_INC_COUNTER(Stops, 1);
+	StartWallRunCooldown(WallRunSide);
+	SetMovementMode(EMovementMode::MOVE_Falling);
+}
+
+bool UShooterCharacterMovement::CanStartWallRunSide(EWallRunSide Side, FVector& OutWallNormal, FVector& OutImpactPoint)
+{
+	return bPreventWallRunIfMovingBackwards
+		? CanStartWallRunSideImpl<true>(Side, OutWallNormal, OutImpactPoint)
+		: CanStartWallRunSideImpl<false>(Side, OutWallNormal, OutImpactPoint);
+}
+
+template<bool bPreventMovingBackwards>
+bool UShooterCharacterMovement::CanStartWallRunSideImpl(EWallRunSide Side, FVector& OutWallNormal, FVector& OutImpactPoint)
+{
+	FVector TestedWallNormal;
+	bool bSuccess = IsWallRunOnCooldown(Side) == false && TraceNearbyForWalls(Side, false, TestedWallNormal, OutImpactPoint);
+	if (bSuccess) 
+	{
+		FVector PawnForwardVector = GetPawnOwner()->GetActorForwardVector();
+		FVector RunDirection = GetWallRunForwardDirection(Side, TestedWallNormal);
+		if (!IsValidWallRunStartDirection(PawnForwardVector, Velocity, RunDirection, WallRunStartMaxAngle, bPreventMovingBackwards))
+		{
+			return false;
+		}
+
+		// Add additional wallsliding checks here
+
+		// All tests passed
+		OutWallNormal = TestedWallNormal;
+		return true;
+	}
+
+
+	return false;
+}
+
+
+void UShooterCharacterMovement::UpdateCameraTiltProximity()
+{
+#if !WALLRUN_HEADLESS
+	// Only matters while in the air and not wallrunning yet (wallrunning tilts to WallRunSide)
+	if (!IsFalling())
+	{
+		bIsCloseToWallToTiltCamera = false;
+		return;
+	}
+
+	FWallRunTraceContext TraceContext;
+	InitWallRunTraceContext(TraceContext);
+	if (TraceContext.Pawn == nullptr || !TraceContext.Pawn->IsFirstPerson())
+	{
+		bIsCloseToWallToTiltCamera = false;
+		return;
+	}
+
+	if (IsHeadingToWallForCameraTilt(TraceContext, EWallRunSide::Left))
+	{
+		bIsCloseToWallToTiltCamera = true;
+		CameraTiltSide = EWallRunSide::Left;
+	}
+	else if (IsHeadingToWallForCameraTilt(TraceContext, EWallRunSide::Right))
+	{
+		bIsCloseToWallToTiltCamera = true;
+		CameraTiltSide = EWallRunSide::Right;
+	}
+	else
+	{
+		bIsCloseToWallToTiltCamera = false;
+	}
+#endif
+}
+
+bool UShooterCharacterMovement::IsHeadingToWallForCameraTilt(const FWallRunTraceContext& TraceContext, EWallRunSide Side) const
+{
+	FWallFanQuery Query;
+	Query.Origin = TraceContext.Pawn->GetActorLocation();
+	Query.Forward = TraceContext.Pawn->GetActorForwardVector();
+	Query.Direction = Side == EWallRunSide::Left ? -1.0f : 1.0f;
+	Query.RayLength = CameraTiltWallDistance;
+	Query.WallDetectDistance = CameraTiltWallDistance;
+	Query.FirstTraceTopOffset = FirstTraceTopOffset;
+	Query.RayRotations = TraceContext.RayRotations;
+	Query.bStopAtFirstWall = false;
+
+	// Do we care about camera tilt and is player velocity heading to that hit/wall?
+	const FVector VelocityDirection = (Velocity * FVector(1.0f, 1.0f, 0.0f)).GetSafeNormal();
+	bool bHeadingToWall = false;
+	auto CheckHeading = [&Query, &VelocityDirection, &bHeadingToWall](const FWallQueryHit& RayHit)
+	{
+		if (!bHeadingToWall && RayHit.bBlockingHit && RayHit.Distance <= Query.WallDetectDistance)
+		{
+			float t = 0.0f;
+			FVector IntersectionPoint;
+			bHeadingToWall = UKismetMathLibrary::LinePlaneIntersection_OriginNormal(Query.Origin, Query.Origin + VelocityDirection * 700.0f, RayHit.Location, RayHit.Normal, t, IntersectionPoint);
+		}
+	};
+
+	FWallQueryHit WallHit;
+	TraceWallFan(TraceContext.GetBackend(), Query, WallHit, CheckHeading);
+	return bHeadingToWall;
+}
+
+bool UShooterCharacterMovement::TraceNearbyForWalls(EWallRunSide Side, bool bFallbackToFeetLevel, FVector& OutNormal, FVector& OutImpactPoint)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WallRunDetection);
+	CSV_SCOPED_TIMING_STAT(WallRun, Detection);
+	WALLRUN_INC_COUNTER(DetectionCalls, 1);
+
+	// Server processing a client move, try to settle it with the client's claim first
+	bool bClaimedWall = false;
+	if (VerifyClientWallClaim(Side, bFallbackToFeetLevel, OutNormal, OutImpactPoint, bClaimedWall))
+	{
+		return bClaimedWall;
+	}
+
+	// Setup shared by all moves of a server packet, or built just for this query
+	FWallRunTraceContext LocalTraceContext;
+	if (!bHasBatchedTraceContext) {
+		InitWallRunTraceContext(LocalTraceContext);
+	}
+	const FWallRunTraceContext& TraceContext = bHasBatchedTraceContext ? BatchedTraceContext : LocalTraceContext;
+
+	AShooterCharacter* Pawn = TraceContext.Pawn;
+	if (Pawn == nullptr) {
+		return false;
+	}
+
+	FWallFanQuery Query;
+	Query.Origin = Pawn->GetActorLocation();
+	Query.Forward = Pawn->GetActorForwardVector();
+	Query.Direction = Side == EWallRunSide::Left ? -1.0f : 1.0f;
+	Query.RayLength = WallDetectDistance;
+	Query.WallDetectDistance = WallDetectDistance;
+	Query.FirstTraceTopOffset = FirstTraceTopOffset;
+	Query.FallbackTraceTopOffset = FallbackTraceTopOffset;
+	Query.bFallbackToFeetLevel = bFallbackToFeetLevel;
+	Query.RayRotations = TraceContext.RayRotations;
+	Query.bStopAtFirstWall = !bFitWallPlaneFromFan;
+
+	// All rays hitting a wall, for the plane fit
+	TArray<FWallQueryHit, TInlineAllocator<16>> WallHits;
+	auto OnRayTraced = [this, &WallHits](const FWallQueryHit& RayHit)
+	{
+		if (bFitWallPlaneFromFan && RayHit.bBlockingHit && RayHit.Distance <= WallDetectDistance)
+		{
+			WallHits.Add(RayHit);
+		}
+	};
+
+	FWallQueryHit WallHit;
+	if (TraceWallFan(TraceContext.GetBackend(), Query, WallHit, OnRayTraced))
+	{
+		DetectedWallComponent = WallHit.Component;
+		DetectedWallPhysMaterial = WallHit.PhysMaterial;
+		OutImpactPoint = WallHit.Location;
+		OutNormal = bFitWallPlaneFromFan
+			? FitWallPlaneNormal(WallHit, WallHits, WallDetectDistance, WallPlaneFitMaxNormalAngle)
+			: (WallHit.Normal * FVector(1.0f, 1.0f, 0.0f)).GetSafeNormal();
+		return true;
+	}
+
+	return false;
+}
+
+/** End of a wall detection ray (before trace level offset) */
+static FVector GetWallFanRayEnd(const FWallFanQuery& Query, int32 RayIndex)
+{
+	// Rotate around Z axis (same as RotateAngleAxis, but with precomputed sin/cos)
+	const FVector EndLocPreRotate = Query.Forward * Query.RayLength;
+	const float Cos = Query.RayRotations[RayIndex].X;
+	const float Sin = Query.RayRotations[RayIndex].Y * Query.Direction;
+	return FVector(EndLocPreRotate.X * Cos - EndLocPreRotate.Y * Sin, EndLocPreRotate.X * Sin + EndLocPreRotate.Y * Cos, EndLocPreRotate.Z) + Query.Origin;
+}
+
+bool UShooterCharacterMovement::TraceWallFan(const IWallQueryBackend& Backend, const FWallFanQuery& Query, FWallQueryHit& OutHit, TFunctionRef<void(const FWallQueryHit&)> OnRayTraced)
+{
+	if (Backend.PrefersBatchedRaycasts())
+	{
+		return TraceWallFanBatched(Backend, Query, OutHit, OnRayTraced);
+	}
+
+	bool bFoundWall = false;
+	for (int32 i = 0; i < Query.RayRotations.Num(); i++)
+	{	
+		FWallQueryHit RayHit;
+		FVector EndLoc = GetWallFanRayEnd(Query, i);
+		Backend.Raycast(Query.Origin + FVector(0.0f, 0.0f, Query.FirstTraceTopOffset), EndLoc + FVector(0.0f, 0.0f, Query.FirstTraceTopOffset), RayHit);
+		WALLRUN_INC_COUNTER(RaysCast, 1);
+
+
+		if (Query.bFallbackToFeetLevel && RayHit.bBlockingHit == false)
+		{
+			Backend.Raycast(Query.Origin + FVector(0.0f, 0.0f, Query.FallbackTraceTopOffset), EndLoc + FVector(0.0f, 0.0f, Query.FallbackTraceTopOffset), RayHit);
+			WALLRUN_INC_COUNTER(FallbackRaysCast, 1);
+		}
+
+		OnRayTraced(RayHit);
+
+		// Handle Wallrunning 
+		if (!bFoundWall && RayHit.bBlockingHit && RayHit.Distance <= Query.WallDetectDistance)
+		{
+			// Priorities forward walls
+			OutHit = RayHit;
+			bFoundWall = true;
+			if (Query.bStopAtFirstWall)
+			{
+				return true;
+			}
+		}
+	}
+
+	return bFoundWall;
+}
+
+bool UShooterCharacterMovement::TraceWallFanBatched(const IWallQueryBackend& Backend, const FWallFanQuery& Query, FWallQueryHit& OutHit, TFunctionRef<void(const FWallQueryHit&)> OnRayTraced)
+{
+	const int32 NumRays = Query.RayRotations.Num();
+
+	// Whole fan at once, then fallback level for the rays which missed. Results are picked in the same order as the ray by ray version.
+	TArray<FVector, TInlineAllocator<16>> Starts;
+	TArray<FVector, TInlineAllocator<16>> Ends;
+	TArray<FWallQueryHit, TInlineAllocator<16>> RayHits;
+	Starts.SetNumUninitialized(NumRays);
+	Ends.SetNumUninitialized(NumRays);
+	RayHits.SetNum(NumRays);
+
+	for (int32 i = 0; i < NumRays; i++)
+	{
+		const FVector EndLoc = GetWallFanRayEnd(Query, i);
+		Starts[i] = Query.Origin + FVector(0.0f, 0.0f, Query.FirstTraceTopOffset);
+		Ends[i] = EndLoc + FVector(0.0f, 0.0f, Query.FirstTraceTopOffset);
+	}
+	Backend.RaycastBatch(Starts, Ends, RayHits);
+	WALLRUN_INC_COUNTER(RaysCast, NumRays);
+
+	if (Query.bFallbackToFeetLevel)
+	{
+		const float FallbackOffset = Query.FallbackTraceTopOffset - Query.FirstTraceTopOffset;
+		for (int32 i = 0; i < NumRays; i++)
+		{
+			Starts[i].Z += FallbackOffset;
+			Ends[i].Z += FallbackOffset;
+		}
+
+		TArray<FWallQueryHit, TInlineAllocator<16>> FallbackHits;
+		FallbackHits.SetNum(NumRays);
+		Backend.RaycastBatch(Starts, Ends, FallbackHits);
+		WALLRUN_INC_COUNTER(FallbackRaysCast, NumRays);
+		for (int32 i = 0; i < NumRays; i++)
+		{
+			if (RayHits[i].bBlockingHit == false)
+			{
+				RayHits[i] = FallbackHits[i];
+			}
+		}
+	}
+
+	bool bFoundWall = false;
+	for (int32 i = 0; i < NumRays; i++)
+	{
+		OnRayTraced(RayHits[i]);
+		if (!bFoundWall && RayHits[i].bBlockingHit && RayHits[i].Distance <= Query.WallDetectDistance)
+		{
+			OutHit = RayHits[i];
+			bFoundWall = true;
+			if (Query.bStopAtFirstWall)
+			{
+				return true;
+			}
+		}
+	}
+
+	return bFoundWall;
+}
+
+FVector UShooterCharacterMovement::FitWallPlaneNormal(const FWallQueryHit& PrimaryHit, TArrayView<const FWallQueryHit> WallHits, float WallDetectDistance, float MaxNormalAngle)
+{
+	const FVector PrimaryNormal = (PrimaryHit.Normal * FVector(1.0f, 1.0f, 0.0f)).GetSafeNormal();
+	const float MinNormalDot = FMath::Cos(FMath::DegreesToRadians(MaxNormalAngle));
+
+	// Weighted centroid and mean normal of hits on the same wall, closer hits weigh more
+	float TotalWeight = 0.0f;
+	FVector2D Centroid = FVector2D::ZeroVector;
+	FVector2D MeanNormal = FVector2D::ZeroVector;
+	for (const FWallQueryHit& Hit : WallHits)
+	{
+		const FVector HitNormal = (Hit.Normal * FVector(1.0f, 1.0f, 0.0f)).GetSafeNormal();
+		if (FVector::DotProduct(HitNormal, PrimaryNormal) < MinNormalDot)
+		{
+			continue;
+		}
+
+		const float Weight = FMath::Max(1.0f - Hit.Distance / FMath::Max(WallDetectDistance, 1.0f), 0.1f);
+		TotalWeight += Weight;
+		Centroid += FVector2D(Hit.Location) * Weight;
+		MeanNormal += FVector2D(HitNormal) * Weight;
+	}
+
+	if (TotalWeight <= 0.0f || MeanNormal.IsNearlyZero())
+	{
+		return PrimaryNormal;
+	}
+	Centroid /= TotalWeight;
+	MeanNormal.Normalize();
+
+	// Weighted covariance of the hit points in XY, the wall runs along its principal axis
+	float Cxx = 0.0f;
+	float Cxy = 0.0f;
+	float Cyy = 0.0f;
+	for (const FWallQueryHit& Hit : WallHits)
+	{
+		const FVector HitNormal = (Hit.Normal * FVector(1.0f, 1.0f, 0.0f)).GetSafeNormal();
+		if (FVector::DotProduct(HitNormal, PrimaryNormal) < MinNormalDot)
+		{
+			continue;
+		}
+
+		const float Weight = FMath::Max(1.0f - Hit.Distance / FMath::Max(WallDetectDistance, 1.0f), 0.1f);
+		const FVector2D Offset = FVector2D(Hit.Location) - Centroid;
+		Cxx += Offset.X * Offset.X * Weight;
+		Cxy += Offset.X * Offset.Y * Weight;
+		Cyy += Offset.Y * Offset.Y * Weight;
+	}
+
+	// Points too close together (single hit or rays converging on one spot) don't define a line, mean normal is all we have
+	const float Spread = (Cxx + Cyy) / TotalWeight;
+	if (Spread < 1.0f)
+	{
+		return FVector(MeanNormal, 0.0f);
+	}
+
+	const float LineAngle = 0.5f * FMath::Atan2(2.0f * Cxy, Cxx - Cyy);
+	FVector2D FitNormal = FVector2D(-FMath::Sin(LineAngle), FMath::Cos(LineAngle));
+	if (FVector2D::DotProduct(FitNormal, MeanNormal) < 0.0f)
+	{
+		FitNormal = -FitNormal;
+	}
+
+	// Points give the overall plane, normals keep it facing the right way on curved walls
+	return FVector((FitNormal + MeanNormal).GetSafeNormal(), 0.0f);
+}
+
+bool UShooterCharacterMovement::IsValidWallRunStartDirection(const FVector& PawnForwardVector, const FVector& PawnVelocity, const FVector& RunDirection, float MaxAngle, bool bPreventMovingBackwards)
+{
+	// Check if we are rotated in acceptable angle (Prevents starting wallrun when player back faces wall)
+	// This is -180 to 180 angle compared to wallrun direction
+	float AimAngle = FMath::UnwindDegrees(UKismetMathLibrary::DegAtan2(PawnForwardVector.X, PawnForwardVector.Y) - UKismetMathLibrary::DegAtan2(RunDirection.X, RunDirection.Y));
+	if (FMath::Abs(AimAngle) > MaxAngle)
+	{
+		return false;
+	}
+
+	// Check if player is not moving backwards
+	if (bPreventMovingBackwards) {
+		float FacingForwardDot = FVector::DotProduct(PawnVelocity.GetSafeNormal(), PawnForwardVector.GetSafeNormal());
+		bool bIsFacingForward = FacingForwardDot > 0.0f;
+		if (bIsFacingForward == false) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool UShooterCharacterMovement::VerifyClientWallClaim(EWallRunSide Side, bool bFallbackToFeetLevel, FVector& OutNormal, FVector& OutImpactPoint, bool& bOutHasWall)
+{
+	if (ServerWallClaim == EWallRunWallClaim::None) {
+		return false;
+	}
+
+	// Client found no wall on this side. Not trusted: it would let the client drop a wallrun the server sees whenever it likes,
+	// so the server runs the same fan the client did.
+	const EWallRunWallClaim SideClaim = Side == EWallRunSide::Left ? EWallRunWallClaim::Left : EWallRunWallClaim::Right;
+	if (ServerWallClaim != SideClaim) {
+		return false;
+	}
+
+	// Fitted normal needs all hits of the fan, a single probe can't reproduce what the client computed
+	if (bFitWallPlaneFromFan) {
+		return false;
+	}
+
+	APawn* Pawn = GetPawnOwner();
+	if (Pawn == nullptr) {
+		return false;
+	}
+
+	// The claimed hit has to be on one of our trace levels, on the correct side and within detection distance
+	const FVector PawnLoc = Pawn->GetActorLocation();
+	const FVector ToClaim = (ServerWallClaimImpactPoint - PawnLoc) * FVector(1.0f, 1.0f, 0.0f);
+	const float ClaimHeight = ServerWallClaimImpactPoint.Z - PawnLoc.Z;
+	const float SideSign = Side == EWallRunSide::Left ? -1.0f : 1.0f;
+
+	const bool bOnTraceLevel = FMath::Abs(ClaimHeight - FirstTraceTopOffset) <= WallClaimTolerance
+		|| (bFallbackToFeetLevel && FMath::Abs(ClaimHeight - FallbackTraceTopOffset) <= WallClaimTolerance);
+	const bool bOnSide = FVector::DotProduct(ToClaim, Pawn->GetActorRightVector()) * SideSign > 0.0f;
+
+	if (bOnTraceLevel && bOnSide && ToClaim.Size() <= WallDetectDistance + WallClaimTolerance)
+	{
+		// Single probe towards the claimed point. Fan rays start at the character too, so this is the ray which found the wall
+		// on the client and the hit normal is the one its detection used.
+		FWallRunTraceContext LocalTraceContext;
+		if (!bHasBatchedTraceContext) {
+			InitWallRunTraceContext(LocalTraceContext);
+		}
+		const FWallRunTraceContext& TraceContext = bHasBatchedTraceContext ? BatchedTraceContext : LocalTraceContext;
+
+		FWallQueryHit HitResult;
+		const FVector StartLoc = FVector(PawnLoc.X, PawnLoc.Y, ServerWallClaimImpactPoint.Z);
+		const FVector EndLoc = StartLoc + ToClaim.GetSafeNormal() * WallDetectDistance;
+		TraceContext.GetBackend().Raycast(StartLoc, EndLoc, HitResult);
+
+		if (HitResult.bBlockingHit && FVector::DistSquared(HitResult.Location, ServerWallClaimImpactPoint) <= FMath::Square(WallClaimTolerance))
+		{
+			DetectedWallComponent = HitResult.Component;
+			DetectedWallPhysMaterial = HitResult.PhysMaterial;
+			OutImpactPoint = HitResult.Location;
+			OutNormal = (HitResult.Normal * FVector(1.0f, 1.0f, 0.0f)).GetSafeNormal();
+			bOutHasWall = true;
+			return true;
+		}
+	}
+
+	// Claim doesn't match what server sees, don't trust it for the rest of this move
+	ServerWallClaim = EWallRunWallClaim::None;
+	return false;
+}
+
+void UShooterCharacterMovement::InitWallRunTraceContext(FWallRunTraceContext& OutContext)
+{
+	OutContext.Pawn = Cast<AShooterCharacter>(GetPawnOwner());
+	OutContext.PhysicsBackend = FWallQueryBackend_Physics(GetWorld(), FCollisionQueryParams(SCENE_QUERY_STAT(WallRunTrace), false, OutContext.Pawn), WallRunTraceChannel);
+	// Surface overrides are looked up with the material of the detection hit
+	OutContext.PhysicsBackend.QueryParams.bReturnPhysicalMaterial = WallRunSurfaceOverrides.Num() > 0;
+	if (WallRunObjectTypes.Num() > 0)
+	{
+		OutContext.PhysicsBackend.ObjectQueryParams = FCollisionObjectQueryParams(WallRunObjectTypes);
+	}
+	OutContext.BackendOverride = WallQueryBackendOverride.IsValid() ? WallQueryBackendOverride.Get() : BakedWallIndex.Get();
+
+	// Angles to raycast, in order of priority (the smallest angle from actor forward vector first)
+	float TargetAngle = 180.0f / NumberOfRaysPerSide + 1;
+
+	OutContext.RayRotations.Reset();
+	for (int32 i = 1; i < NumberOfRaysPerSide; i++)
+	{
+		float Sin, Cos;
+		FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(TargetAngle * i));
+		OutContext.RayRotations.Add(FVector2D(Cos, Sin));
+	}
+}
+
+void UShooterCharacterMovement::SetWallQueryBackend(TSharedPtr<IWallQueryBackend> InBackend)
+{
+	WallQueryBackendOverride = InBackend;
+}
+
+bool UShooterCharacterMovement::ClientUpdatePositionAfterServerUpdate()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WallRunReplay);
+	CSV_SCOPED_TIMING_STAT(WallRun, Replay);
+
+	// Only corrections replay the saved moves, PrepMoveFor is also used outside of replays
+	const FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+	if (ClientData && ClientData->bUpdatePosition)
+	{
+		WALLRUN_INC_COUNTER(ReplayedMoves, ClientData->SavedMoves.Num());
+	}
+
+	const bool bResult = Super::ClientUpdatePositionAfterServerUpdate();
+
+	// Replayed moves leave the offsets of the last one behind
+	WallRunJumpInputOffset = 0;
+	WallRunUnstickInputOffset = 0;
+	return bResult;
+}
+
+void UShooterCharacterMovement::ControlledCharacterMove(const FVector& InputVector, float DeltaSeconds)
+{
+	if (CharacterOwner && CharacterOwner->InputComponent != WallRunInputComponent.Get())
+	{
+		BindWallRunInput();
+	}
+
+	// Offsets are used by CheckJumpInput, picked up by SetMoveFor and used by this move's physics
+	const double MoveTime = FPlatformTime::Seconds();
+	WallRunJumpInputOffset = GetSubTickInputOffset(WallRunJumpInputTime, MoveTime);
+	WallRunUnstickInputOffset = GetSubTickInputOffset(WallRunUnstickInputTime, MoveTime);
+	LastControlledMoveTime = MoveTime;
+
+	Super::ControlledCharacterMove(InputVector, DeltaSeconds);
+
+	WallRunJumpInputOffset = 0;
+	WallRunUnstickInputOffset = 0;
+	WallRunJumpInputTime = 0.0;
+	WallRunUnstickInputTime = 0.0;
+}
+
+void UShooterCharacterMovement::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	// Before Super, which acknowledges the corrected move and drops it from SavedMoves
+	const FShooterCharacterMoveResponseDataContainer& ShooterMoveResponse = static_cast<const FShooterCharacterMoveResponseDataContainer&>(MoveResponse);
+	if (!MoveResponse.IsGoodMove())
+	{
+		NumCorrectionsReceived++;
+		if (ShooterMoveResponse.bHasWallRunSnapshot)
+		{
+			AttributeCorrection(MoveResponse.ClientAdjustment.TimeStamp, ShooterMoveResponse.WallRunSnapshot);
+		}
+	}
+
+	Super::ClientHandleMoveResponse(MoveResponse);
+}
+
+void UShooterCharacterMovement::AttributeCorrection(float TimeStamp, const FWallRunStateSnapshot& ServerSnapshot)
+{
+	const FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+	const FSavedMove_ShooterCharacter* CorrectedMove = nullptr;
+	for (const FSavedMovePtr& SavedMove : ClientData->SavedMoves)
+	{
+		if (SavedMove->TimeStamp == TimeStamp)
+		{
+			CorrectedMove = static_cast<const FSavedMove_ShooterCharacter*>(SavedMove.Get());
+			break;
+		}
+	}
+
+	if (!CorrectedMove || !CorrectedMove->bHasEndWallRunSnapshot)
+	{
+		FWallRunCorrectionStats::RecordUnattributedCorrection();
+		return;
+	}
+
+	float Delta = 0.0f;
+	const EWallRunSnapshotField Field = CorrectedMove->EndWallRunSnapshot.FindFirstDivergence(ServerSnapshot, Delta);
+	FWallRunCorrectionStats::RecordCorrection(Field, Delta);
+
+	if (Field != EWallRunSnapshotField::None)
+	{
+		UE_LOG(LogTemp, Verbose, TEXT("WallRun correction at %f: field %d diverged by %f (client %s, server %s)"), TimeStamp, (int32)Field, Delta,
+			*CorrectedMove->EndWallRunSnapshot.DescribeField(Field), *ServerSnapshot.DescribeField(Field));
+	}
+}
+
+void UShooterCharacterMovement::ServerMove_HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WallRunServerMove);
+	CSV_SCOPED_TIMING_STAT(WallRun, ServerMove);
+
+	// New, pending and old move of this packet all share one trace setup
+	InitWallRunTraceContext(BatchedTraceContext);
+	bHasBatchedTraceContext = true;
+
+	// Client made the newest move against the world it got about a round trip ago, older moves of the packet even earlier.
+	// The offset maps client timestamps to that server time, smoothed since packet arrival jitters.
+	const APlayerState* PlayerState = CharacterOwner ? CharacterOwner->GetPlayerState() : nullptr;
+	const FCharacterNetworkMoveData* NewMove = MoveDataContainer.GetNewMoveData();
+	const FNetworkPredictionData_Server_Character* ServerData = GetPredictionData_Server_Character();
+	if (WallGeometryHistory.IsValid() && PlayerState && NewMove && ServerData && BatchedTraceContext.BackendOverride == nullptr)
+	{
+		const float Offset = GetWorld()->GetTimeSeconds() - PlayerState->ExactPing * 0.001f - NewMove->TimeStamp;
+		// Client timestamps start over every MinTimeBetweenTimeStampResets, the offset jumps along with them
+		const bool bTimeStampReset = ServerData->CurrentClientTimeStamp - NewMove->TimeStamp > MinTimeBetweenTimeStampResets * 0.5f;
+		ClientToServerTimeOffset = bHasClientToServerTimeOffset && !bTimeStampReset ? FMath::Lerp(ClientToServerTimeOffset, Offset, 0.1f) : Offset;
+		bHasClientToServerTimeOffset = true;
+		bRewindWallQueries = true;
+	}
+
+	Super::ServerMove_HandleMoveData(MoveDataContainer);
+
+	bHasBatchedTraceContext = false;
+	bRewindWallQueries = false;
+}
+
+void UShooterCharacterMovement::UnstickFromWallPressed()
+{
+	if (IsWallRunning() && !bWallrunWantsToUnstick)
+	{
+		WantsToUnstickTimeRemaining = QuantizeWallRunTime(UnstickFromWallTimeThreshold);
+		bWallrunWantsToUnstick = true;
+		WallRunUnstickInputTime = FPlatformTime::Seconds();
+	}
+}
+
+void UShooterCharacterMovement::WallRunJumpPressed()
+{
+	if (IsWallRunning())
+	{
+		WallRunJumpInputTime = FPlatformTime::Seconds();
+	}
+}
+
+void UShooterCharacterMovement::BindWallRunInput()
+{
+	// Character's own jump binding stays, input is not consumed
+	UInputComponent* InputComponent = CharacterOwner->InputComponent;
+	WallRunInputComponent = InputComponent;
+	if (InputComponent && bUseSubTickWallRunInput && WallRunJumpActionName != NAME_None)
+	{
+		FInputActionBinding& Binding = InputComponent->BindAction(WallRunJumpActionName, IE_Pressed, this, &UShooterCharacterMovement::WallRunJumpPressed);
+		Binding.bConsumeInput = false;
+	}
+}
+
+uint8 UShooterCharacterMovement::GetSubTickInputOffset(double InputTime, double MoveTime) const
+{
+	if (!bUseSubTickWallRunInput || InputTime <= LastControlledMoveTime || MoveTime <= LastControlledMoveTime)
+	{
+		return 0;
+	}
+	const double Fraction = (InputTime - LastControlledMoveTime) / (MoveTime - LastControlledMoveTime);
+	return (uint8)FMath::Clamp(FMath::FloorToInt(Fraction * 256.0), 0, 255);
+}
+
+void UShooterCharacterMovement::UnstickFromWall_Internal()
+{
+	if (IsWallRunning())
+	{
+		Velocity += WallRunWallNormal.GetSafeNormal() * WallRunUnstickVelocity;
+		StopWallRunning();
+	}
+}
+
+void UShooterCharacterMovement::ResetUnstickFromWall()
+{
+	WantsToUnstickTimeRemaining = QuantizeWallRunTime(UnstickFromWallTimeThreshold);
+	bWallrunWantsToUnstick = false;
+}
+
+float UShooterCharacterMovement::GetWallRunGravityScale()
+{
+	return bScaleWallRunGravityWithSpeed ? GetWallRunGravityScaleImpl<true>() : GetWallRunGravityScaleImpl<false>();
+}
+
+template<bool bScaleGravityWithSpeed>
+float UShooterCharacterMovement::GetWallRunGravityScaleImpl()
+{
+	return CalcWallRunGravityScale<bScaleGravityWithSpeed>(Velocity, WallRunState);
+}
+
+void UShooterCharacterMovement::StepWallRunSimulation(FWallRunSimState& Sim, float BaseGravityZ, float DeltaTime) const
+{
+	bScaleWallRunGravityWithSpeed ? StepWallRunSimulationImpl<true>(Sim, BaseGravityZ, DeltaTime) : StepWallRunSimulationImpl<false>(Sim, BaseGravityZ, DeltaTime);
+}
+
+template<bool bScaleGravityWithSpeed>
+void UShooterCharacterMovement::StepWallRunSimulationImpl(FWallRunSimState& Sim, float BaseGravityZ, float DeltaTime) const
+{
+	if (Sim.State == EWallRunState::Start && Sim.Velocity.Z <= WallRunMidZVelocityThreshold)
+	{
+		Sim.State = EWallRunState::Mid;
+		Sim.bTimerStarted = !bIsWallRunInfinite;
+	}
+
+	// Constant acceleration within a step
+	const float GravityZ = BaseGravityZ * CalcWallRunGravityScale<bScaleGravityWithSpeed>(Sim.Velocity, Sim.State) * Sim.Surface.GravityScale;
+	Sim.Location += Sim.Velocity * DeltaTime + FVector(0.0f, 0.0f, 0.5f * GravityZ * DeltaTime * DeltaTime);
+	Sim.Velocity.Z += GravityZ * DeltaTime;
+
+	if (Sim.bTimerStarted && Sim.TimeRemaining > 0.0f)
+	{
+		Sim.TimeRemaining -= DeltaTime;
+		if (Sim.TimeRemaining <= 0.0f)
+		{
+			Sim.State = EWallRunState::End;
+		}
+	}
+}
+
+template<bool bScaleGravityWithSpeed>
+float UShooterCharacterMovement::CalcWallRunGravityScale(const FVector& InVelocity, EWallRunState InState) const
+{
+	// Moving up, return specific value
+	if (InVelocity.Z > WallRunMidZVelocityThreshold) {
+		return WallRunGravityScaleUp;
+	}
+
+	
+	float NewGravityScale = 0.0f;
+
+	// Moving down, start with the default
+	if (InState == EWallRunState::Mid)
+	{
+		NewGravityScale = FMath::Max(NewGravityScale, WallRunGravityMidState);
+	}
+	else if (InState == EWallRunState::End)
+	{
+		NewGravityScale = WallRunGravityEndState;
+	}
+
+	// Should we increase gravity if moving slowly?
+	if (bScaleGravityWithSpeed) 
+	{
+		float CurrentSpeed = InVelocity.Size2D();
+		if (CurrentSpeed < WallRunSpeed * ScaleWallRunGravityStart)
+		{
+			float Alpha = CurrentSpeed / (WallRunSpeed * ScaleWallRunGravityStart);
+			Alpha = FMath::Clamp(Alpha, 0.0f, 1.0f);
+			NewGravityScale = FMath::Max(NewGravityScale, FMath::Lerp(WallRunGravityScaleSlow, WallRunGravityMidState, Alpha));
+		}
+	}
+
+	return NewGravityScale;
+}
+
+FVector FWallRunTrajectoryPrediction::GetLocationAt(float WorldTime) const
+{
+	if (Samples.Num() == 0)
+	{
+		return FVector::ZeroVector;
+	}
+
+	const float SampleTime = FMath::Max(WorldTime - StartTime, 0.0f) / SampleInterval;
+	const int32 Index = FMath::Min(FMath::FloorToInt(SampleTime), Samples.Num() - 1);
+	if (Index == Samples.Num() - 1)
+	{
+		return Samples.Last();
+	}
+	return FMath::Lerp(Samples[Index], Samples[Index + 1], SampleTime - Index);
+}
+
+const FWallRunTrajectoryPrediction& UShooterCharacterMovement::PredictWallRunTrajectory(bool bJumpNow)
+{
+	FWallRunTrajectoryPrediction& Prediction = WallRunPredictions[bJumpNow ? 1 : 0];
+
+	if (!IsWallRunning() || CharacterOwner == nullptr || GetWorld() == nullptr)
+	{
+		Prediction.Samples.Reset();
+		Prediction.bHasLanding = false;
+		Prediction.bValid = false;
+		return Prediction;
+	}
+
+	// Anything the simulation branches on
+	uint32 StateKey = (uint32)WallRunState | ((uint32)WallRunSide << 4) | ((uint32)bIsWallRunDurationTimerStarted << 8);
+	StateKey = FCrc::MemCrc32(&CurrentWallRunSurface, sizeof(CurrentWallRunSurface), StateKey);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const FVector AimForward = GetPawnOwner()->GetActorForwardVector();
+	const FVector CurrentLocation = UpdatedComponent->GetComponentLocation();
+
+	// Predictions reach 1.5x WallRunPredictionTime ahead, so they're reused for half of it as long as the character stays on the path.
+	// A jump path only leaves the wall where the jump happens, it's reused while the character is still there (same sample, same spot).
+	const bool bReuse = Prediction.bValid
+		&& Prediction.StateKey == StateKey
+		&& FVector::DotProduct(Prediction.WallNormal, WallRunWallNormal) > 0.999f
+		&& (bJumpNow
+			? Now - Prediction.StartTime <= Prediction.SampleInterval
+				&& FVector::DotProduct(Prediction.AimForward, AimForward) > 0.999f
+				&& FVector::DistSquared(Prediction.Samples[0], CurrentLocation) <= FMath::Square(WallRunPredictionTolerance)
+			: Now <= Prediction.StartTime + WallRunPredictionTime * 0.5f
+				&& FVector::DistSquared(Prediction.GetLocationAt(Now), CurrentLocation) <= FMath::Square(WallRunPredictionTolerance));
+	if (bReuse)
+	{
+		return Prediction;
+	}
+
+	WALLRUN_INC_COUNTER(Predictions, 1);
+	Prediction.StateKey = StateKey;
+	Prediction.AimForward = AimForward;
+	Prediction.WallNormal = WallRunWallNormal;
+	Prediction.StartTime = Now;
+	if (bScaleWallRunGravityWithSpeed) {
+		BuildWallRunPrediction<true>(Prediction, bJumpNow);
+	}
+	else {
+		BuildWallRunPrediction<false>(Prediction, bJumpNow);
+	}
+	return Prediction;
+}
+
+template<bool bScaleGravityWithSpeed>
+void UShooterCharacterMovement::BuildWallRunPrediction(FWallRunTrajectoryPrediction& Prediction, bool bJumpNow)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WallRunPrediction);
+
+	const float Step = WallRunPredictionSampleInterval;
+	const int32 NumSteps = FMath::CeilToInt(WallRunPredictionTime * 1.5f / Step);
+
+	FWallRunSimState Sim;
+	Sim.Location = UpdatedComponent->GetComponentLocation();
+	Sim.Velocity = Velocity;
+	Sim.State = WallRunState;
+	Sim.bTimerStarted = bIsWallRunDurationTimerStarted;
+	Sim.TimeRemaining = WallRunTimeRemaining;
+	Sim.Surface = CurrentWallRunSurface;
+
+	if (bJumpNow)
+	{
+		Sim.Velocity = CalcWallRunJumpVelocity(Velocity, Prediction.AimForward, WallRunSide);
+	}
+	else
+	{
+		// Push into the wall is taken by the collision, only the part along the wall moves the character
+		const FVector RunDirection = GetWallRunForwardDirection().GetSafeNormal2D();
+		const float RunSpeed = FMath::Clamp(FVector::DotProduct(Sim.Velocity, RunDirection), 0.0f, GetMaxSpeed());
+		Sim.Velocity = FVector(RunDirection.X * RunSpeed, RunDirection.Y * RunSpeed, Sim.Velocity.Z);
+	}
+
+	// Landing is estimated against the floor below the character, one trace per prediction
+	float FloorZ = -BIG_NUMBER;
+	{
+		const float HalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+		FHitResult FloorHit;
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(WallRunPredictFloor), false, CharacterOwner);
+		if (GetWorld()->LineTraceSingleByChannel(FloorHit, Sim.Location, Sim.Location - FVector(0.0f, 0.0f, 10000.0f), UpdatedComponent->GetCollisionObjectType(), QueryParams))
+		{
+			FloorZ = FloorHit.Location.Z + HalfHeight;
+		}
+	}
+
+	Prediction.SampleInterval = Step;
+	Prediction.Samples.Reset();
+	Prediction.Samples.Add(Sim.Location);
+	Prediction.bHasLanding = false;
+
+	for (int32 i = 0; i < NumSteps; ++i)
+	{
+		const FVector PrevLocation = Sim.Location;
+		if (bJumpNow)
+		{
+			// Off the wall, plain gravity
+			const float GravityZ = GetGravityZ();
+			Sim.Location += Sim.Velocity * Step + FVector(0.0f, 0.0f, 0.5f * GravityZ * Step * Step);
+			Sim.Velocity.Z += GravityZ * Step;
+		}
+		else
+		{
+			StepWallRunSimulationImpl<bScaleGravityWithSpeed>(Sim, GetGravityZ(), Step);
+		}
+
+		if (Sim.Location.Z <= FloorZ && PrevLocation.Z > FloorZ)
+		{
+			const float Alpha = (PrevLocation.Z - FloorZ) / (PrevLocation.Z - Sim.Location.Z);
+			Prediction.bHasLanding = true;
+			Prediction.LandingLocation = FMath::Lerp(PrevLocation, Sim.Location, Alpha);
+			Prediction.LandingTime = Prediction.StartTime + (i + Alpha) * Step;
+			// Stays there for the rest of the step
+			Prediction.Samples.Add(Prediction.LandingLocation);
+			break;
+		}
+		Prediction.Samples.Add(Sim.Location);
+	}
+
+	Prediction.bValid = true;
+}
+
+bool UShooterCharacterMovement::IsWallRunning()
+{
+	return MovementMode == MOVE_Custom && CustomMovementMode == ECustomMovementMode::CMOVE_WallRunning && UpdatedComponent;
+}
+
+bool UShooterCharacterMovement::IsWallRunningSide(EWallRunSide Side)
+{
+	return IsWallRunning() && WallRunSide == Side;
+}
+
+void UShooterCharacterMovement::StartWallRunCooldown(EWallRunSide Side) 
+{
+	UWorld* world = GetWorld();
+	if (world)
+	{
+		if (Side == EWallRunSide::Left) {
+			WallRunCooldownLeftTimeRemaining = QuantizeWallRunTime(WallRunCooldown);
+		}
+		else {
+			WallRunCooldownRightTimeRemaining = QuantizeWallRunTime(WallRunCooldown);
+		}
+	}
+}
+
+bool UShooterCharacterMovement::IsWallRunOnCooldown(EWallRunSide Side) 
+{
+	if (Side == EWallRunSide::Left) {
+		return WallRunCooldownLeftTimeRemaining > 0.0f;
+	}
+	return WallRunCooldownRightTimeRemaining > 0.0f;
+}
+
+void UShooterCharacterMovement::OnComponentDestroyed(bool bDestroyingHierarchy)
+{
+	Super::OnComponentDestroyed(bDestroyingHierarchy);
+}
+
+float UShooterCharacterMovement::GetCurrentCameraTilt()
+{
+#if WALLRUN_HEADLESS
+	return 0.0f;
+#else
+	return CurrentCameraTiltAlpha* CameraMaxTilt * -1.0f;
+#endif
+}
+
+FVector UShooterCharacterMovement::GetWallRunForwardDirection()
+{
+	float WallDirection = WallRunSide == EWallRunSide::Left ? -1.0f : 1.0f;
+	return UKismetMathLibrary::RotateAngleAxis(WallRunWallNormal, 90.0f * WallDirection, FVector::UpVector);
+}
+
+FVector UShooterCharacterMovement::GetWallRunForwardDirection(EWallRunSide Side, FVector WallNormal) const
+{
+	float WallDirection = Side == EWallRunSide::Left ? -1.0f : 1.0f;
+	return UKismetMathLibrary::RotateAngleAxis(WallNormal, 90.0f * WallDirection, FVector::UpVector);
+}
+
+FVector UShooterCharacterMovement::GetWallRunLateralAcceleration(float deltaTime)
+{
+	return FVector(Acceleration.X, Acceleration.Y, 0.f);
+}
+
+void UShooterCharacterMovement::TransitionWallRunToEndState()
+{
+	if (WallRunState != EWallRunState::End) {
+		CurrentWallRunEndGravity = WallRunGravityMidState;
+		WallRunState = EWallRunState::End;
+	}
+}
+
+void UShooterCharacterMovement::PhysWallRunning(float deltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WallRunPhys);
+	CSV_SCOPED_TIMING_STAT(WallRun, PhysWallRunning);
+
+	// Wall may have turned since detection, the base already moved us along with it
+	if (IsWallRunningOnMovingWall())
+	{
+		WallRunWallNormal = CharacterOwner->GetMovementBase()->GetComponentQuat().RotateVector(WallRunLocalWallNormal);
+	}
+
+	if (bWallRunJumpDeferred)
+	{
+		// Jump was pressed part way through this move, keep running on the wall until then and jump from there
+		bWallRunJumpDeferred = false;
+		const float TimeBeforeJump = deltaTime * WallRunJumpInputOffset / 256.0f;
+		if (TimeBeforeJump >= MIN_TICK_TIME)
+		{
+			(this->*PhysWallRunningFunc)(TimeBeforeJump, Iterations);
+		}
+
+		if (IsWallRunning())
+		{
+			DoWallRunJump(bWallRunJumpDeferredReplaying);
+		}
+		StartNewPhysics(deltaTime - TimeBeforeJump, Iterations);
+		return;
+	}
+
+	(this->*PhysWallRunningFunc)(deltaTime, Iterations);
+}
+
+template<bool bScaleGravityWithSpeed>
+void UShooterCharacterMovement::PhysWallRunningImpl(float deltaTime, int32 Iterations)
+{
+	// PhysFalling code, but adjusted for wallrunning
+
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	
+	// Acceleration is replicated
+
+	FVector WallRunAccelerationLocal = GetWallRunLateralAcceleration(deltaTime);
+
+	WallRunAccelerationLocal.Z = 0.f;
+	const bool bHasLimitedAirControl = ShouldLimitAirControl(deltaTime, WallRunAccelerationLocal);
+
+
+	float remainingTime = deltaTime;
+	while ((remainingTime >= MIN_TICK_TIME) && (Iterations < MaxSimulationIterations))
+	{
+		Iterations++;
+		float timeTick = GetSimulationTimeStep(remainingTime, Iterations);
+		remainingTime -= timeTick;
+		WALLRUN_INC_COUNTER(Substeps, 1);
+
+		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+		const FQuat PawnRotation = UpdatedComponent->GetComponentQuat();
+		bJustTeleported = false;
+
+		RestorePreAdditiveRootMotionVelocity();
+
+		const FVector OldVelocity = Velocity;
+		// Apply input
+		const float MaxDecel = GetMaxBrakingDeceleration();
+		
+		if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+		{
+			// Compute Velocity
+			{
+				// Acceleration = WallRunAcceleration for CalcVelocity(), but we restore it after using it.
+				TGuardValue<FVector> RestoreAcceleration(Acceleration, WallRunAccelerationLocal);
+				Velocity.Z = 0.f;
+				CalcVelocity(timeTick, /*WallRunLateralFriction*/ 0.0f, false, MaxDecel);
+				Velocity.Z = OldVelocity.Z;
+			}
+		}
+		
+		
+
+		// Apply push to a side where the wall is (stick to the wall)
+		FVector PushToStickToWall = WallRunWallNormal * WallRunPushVelocity * timeTick * -1.0f;;
+		Velocity += PushToStickToWall;
+
+		// Compute current gravity
+		const FVector Gravity(0.f, 0.f, GetGravityZ() * GetWallRunGravityScaleImpl<bScaleGravityWithSpeed>() * CurrentWallRunSurface.GravityScale);
+		float GravityTime = timeTick;
+
+		
+
+#if WALLRUN_DEBUG
+		// Purely debug options in this section
+		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowCharacterCapsule || CVar_WallRun_ShowState)
+		{
+			// Draw character capsule (If owned by character which as capsule)
+			if (ACharacter* Character = Cast<ACharacter>(GetPawnOwner())) {
+				UCapsuleComponent* CharacterCapsule = Character->GetCapsuleComponent();
+				if (CharacterCapsule) {
+					FVector CapsuleLoc = CharacterCapsule->GetComponentLocation();
+					float HalfHeight = CharacterCapsule->GetScaledCapsuleHalfHeight();
+					float Radius = CharacterCapsule->GetScaledCapsuleRadius();
+					FRotator Rotation = CharacterCapsule->GetComponentRotation();
+
+					FColor color = FColor::Blue;
+					if (CVar_WallRun_ShowState)
+					{
+						if (WallRunState == EWallRunState::Start)
+						{
+							color = FColor::Green;
+						}
+						else if (WallRunState == EWallRunState::Mid)
+						{
+							color = FColor::Yellow;
+						}
+						else
+						{
+							color = FColor::Red;
+						}
+					}
+
+					DrawDebugCapsule(GetWorld(), CapsuleLoc, HalfHeight, Radius, Rotation.Quaternion(), color, false, 20.0f, 0, 0.5f);
+				}
+			}
+		}
+		
+		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowRunForwardVector)
+		{
+			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
+			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + GetWallRunForwardDirection().GetSafeNormal() * 300.0f, 80.f, FColor::Blue, false, 0, 0, 2.f);
+		}
+
+		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowGravity)
+		{
+			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
+			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + (Gravity / 4.0f), 80.f, FColor::Red, false, 20.0f, 0, 1.f);
+		}
+
+		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowWallPush)
+		{
+			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
+			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + PushToStickToWall.GetSafeNormal() * 100.0f, 80.f, FColor::Cyan, false, 20.0f, 0, 1.f);
+		}
+
+		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowWallNormal)
+		{
+			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
+			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + WallRunWallNormal.GetSafeNormal() * 100.0f, 80.f, FColor::Yellow, false, 20.0f, 0, 1.f);
+		}
+
+		if (CVar_WallRun_ShowAll || CVar_WallRun_ShowAcceleration)
+		{
+			FVector PawnLoc = GetPawnOwner()->GetActorLocation();
+			DrawDebugDirectionalArrow(GetWorld(), PawnLoc, PawnLoc + Acceleration.GetSafeNormal() * 100.0f, 80.f, FColor::Orange, false, 20.0f, 0, 1.f);
+		}
+#endif
+
+		// If jump is providing force, gravity may be affected.
+		bool bEndingJumpForce = false;
+		if (CharacterOwner->JumpForceTimeRemaining > 0.0f)
+		{
+			// Consume some of the force time. Only the remaining time (if any) is affected by gravity when bApplyGravityWhileJumping=false.
+			const float JumpForceTime = FMath::Min(CharacterOwner->JumpForceTimeRemaining, timeTick);
+			GravityTime = bApplyGravityWhileJumping ? timeTick : FMath::Max(0.0f, timeTick - JumpForceTime);
+
+			// Update Character state
+			CharacterOwner->JumpForceTimeRemaining -= JumpForceTime;
+			if (CharacterOwner->JumpForceTimeRemaining <= 0.0f)
+			{
+				CharacterOwner->ResetJumpState();
+				bEndingJumpForce = true;
+			}
+		}
+
+		// Apply gravity
+		Velocity = NewFallVelocity(Velocity, Gravity, GravityTime);
+
+		// See if we need to sub-step to exactly reach the apex. This is important for avoiding "cutting off the top" of the trajectory as framerate varies.
+		if (OldVelocity.Z > 0.f && Velocity.Z <= 0.f && NumJumpApexAttempts < MaxJumpApexAttemptsPerSimulation)
+		{
+			const FVector DerivedAccel = (Velocity - OldVelocity) / timeTick;
+			if (!FMath::IsNearlyZero(DerivedAccel.Z))
+			{
+				const float TimeToApex = -OldVelocity.Z / DerivedAccel.Z;
+
+				// The time-to-apex calculation should be precise, and we want to avoid adding a substep when we are basically already at the apex from the previous iteration's work.
+				const float ApexTimeMinimum = 0.0001f;
+				if (TimeToApex >= ApexTimeMinimum && TimeToApex < timeTick)
+				{
+					const FVector ApexVelocity = OldVelocity + DerivedAccel * TimeToApex;
+					Velocity = ApexVelocity;
+					Velocity.Z = 0.f; // Should be nearly zero anyway, but this makes apex notifications consistent.
+
+					// We only want to move the amount of time it takes to reach the apex, and refund the unused time for next iteration.
+					remainingTime += (timeTick - TimeToApex);
+					timeTick = TimeToApex;
+					Iterations--;
+					NumJumpApexAttempts++;
+				}
+			}
+		}
+
+		ApplyRootMotionToVelocity(timeTick);
+
+		// Compute change in position (using midpoint integration method).
+		FVector Adjusted = 0.5f * (OldVelocity + Velocity) * timeTick;
+
+		// Special handling if ending the jump force where we didn't apply gravity during the jump.
+		if (bEndingJumpForce && !bApplyGravityWhileJumping)
+		{
+			// We had a portion of the time at constant speed then a portion with acceleration due to gravity.
+			// Account for that here with a more correct change in position.
+			const float NonGravityTime = FMath::Max(0.f, timeTick - GravityTime);
+			Adjusted = (OldVelocity * NonGravityTime) + (0.5f * (OldVelocity + Velocity) * GravityTime);
+		}
+
+		// Move
+		FHitResult Hit(1.f);
+		SafeMoveUpdatedComponent(Adjusted, PawnRotation, true, Hit);
+
+		if (!HasValidData())
+		{
+			return;
+		}
+
+		float LastMoveTimeSlice = timeTick;
+		float subTimeTickRemaining = timeTick * (1.f - Hit.Time);
+
+		if (IsSwimming()) //just entered water
+		{
+			remainingTime += subTimeTickRemaining;
+			StartSwimming(OldLocation, OldVelocity, timeTick, remainingTime, Iterations);
+			return;
+		}
+		else if (Hit.bBlockingHit)
+		{
+			if (IsValidLandingSpot(UpdatedComponent->GetComponentLocation(), Hit))
+			{
+				remainingTime += subTimeTickRemaining;
+				ProcessLanded(Hit, remainingTime, Iterations);
+				return;
+			}
+			else
+			{
+				// Compute impact deflection based on final velocity, not integration step.
+				// This allows us to compute a new velocity from the deflected vector, and ensures the full gravity effect is included in the slide result.
+				Adjusted = Velocity * timeTick;
+
+				// See if we can convert a normally invalid landing spot (based on the hit result) to a usable one.
+				if (!Hit.bStartPenetrating && ShouldCheckForValidLandingSpot(timeTick, Adjusted, Hit))
+				{
+					const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
+					FFindFloorResult FloorResult;
+					FindFloor(PawnLocation, FloorResult, false);
+					if (FloorResult.IsWalkableFloor() && IsValidLandingSpot(PawnLocation, FloorResult.HitResult))
+					{
+						remainingTime += subTimeTickRemaining;
+						ProcessLanded(FloorResult.HitResult, remainingTime, Iterations);
+						return;
+					}
+				}
+
+				HandleImpact(Hit, LastMoveTimeSlice, Adjusted);
+
+				// If we've changed physics mode, abort.
+				if (!HasValidData() || !IsWallRunning())
+				{
+					return;
+				}
+
+				// Limit air control based on what we hit.
+				// We moved to the impact point using air control, but may want to deflect from there based on a limited air control acceleration.
+				FVector VelocityNoAirControl = OldVelocity;
+				FVector AirControlAccel = Acceleration;
+				if (bHasLimitedAirControl)
+				{
+					// Compute VelocityNoAirControl
+					{
+						// Find velocity *without* acceleration.
+						TGuardValue<FVector> RestoreAcceleration(Acceleration, FVector::ZeroVector);
+						TGuardValue<FVector> RestoreVelocity(Velocity, OldVelocity);
+						Velocity.Z = 0.f;
+						CalcVelocity(timeTick, 0.0f, false, MaxDecel);
+						VelocityNoAirControl = FVector(Velocity.X, Velocity.Y, OldVelocity.Z);
+						VelocityNoAirControl = NewFallVelocity(VelocityNoAirControl, Gravity, GravityTime);
+					}
+
+					const bool bCheckLandingSpot = false; // we already checked above.
+					AirControlAccel = (Velocity - VelocityNoAirControl) / timeTick;
+					const FVector AirControlDeltaV = LimitAirControl(LastMoveTimeSlice, AirControlAccel, Hit, bCheckLandingSpot) * LastMoveTimeSlice;
+					Adjusted = (VelocityNoAirControl + AirControlDeltaV) * LastMoveTimeSlice;
+				}
+
+				const FVector OldHitNormal = Hit.Normal;
+				const FVector OldHitImpactNormal = Hit.ImpactNormal;
+				FVector Delta = ComputeSlideVector(Adjusted, 1.f - Hit.Time, OldHitNormal, Hit);
+
+				// Compute velocity after deflection (only gravity component for RootMotion)
+				if (subTimeTickRemaining > KINDA_SMALL_NUMBER && !bJustTeleported)
+				{
+					const FVector NewVelocity = (Delta / subTimeTickRemaining);
+					Velocity = HasAnimRootMotion() || CurrentRootMotion.HasOverrideVelocityWithIgnoreZAccumulate() ? FVector(Velocity.X, Velocity.Y, NewVelocity.Z) : NewVelocity;
+				}
+
+				if (subTimeTickRemaining > KINDA_SMALL_NUMBER && (Delta | Adjusted) > 0.f)
+				{
+					// Move in deflected direction.
+					SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
+
+					if (Hit.bBlockingHit)
+					{
+						// hit second wall
+						LastMoveTimeSlice = subTimeTickRemaining;
+						subTimeTickRemaining = subTimeTickRemaining * (1.f - Hit.Time);
+
+						if (IsValidLandingSpot(UpdatedComponent->GetComponentLocation(), Hit))
+						{
+							remainingTime += subTimeTickRemaining;
+							ProcessLanded(Hit, remainingTime, Iterations);
+							return;
+						}
+
+						HandleImpact(Hit, LastMoveTimeSlice, Delta);
+
+						// If we've changed physics mode, abort.
+						if (!HasValidData() || !IsWallRunning())
+						{
+							return;
+						}
+
+						// Act as if there was no air control on the last move when computing new deflection.
+						if (bHasLimitedAirControl && Hit.Normal.Z > 0.001f)
+						{
+							const FVector LastMoveNoAirControl = VelocityNoAirControl * LastMoveTimeSlice;
+							Delta = ComputeSlideVector(LastMoveNoAirControl, 1.f, OldHitNormal, Hit);
+						}
+
+						FVector PreTwoWallDelta = Delta;
+						TwoWallAdjust(Delta, Hit, OldHitNormal);
+
+						// Limit air control, but allow a slide along the second wall.
+						if (bHasLimitedAirControl)
+						{
+							const bool bCheckLandingSpot = false; // we already checked above.
+							const FVector AirControlDeltaV = LimitAirControl(subTimeTickRemaining, AirControlAccel, Hit, bCheckLandingSpot) * subTimeTickRemaining;
+
+							// Only allow if not back in to first wall
+							if (FVector::DotProduct(AirControlDeltaV, OldHitNormal) > 0.f)
+							{
+								Delta += (AirControlDeltaV * subTimeTickRemaining);
+							}
+						}
+
+						// Compute velocity after deflection (only gravity component for RootMotion)
+						if (subTimeTickRemaining > KINDA_SMALL_NUMBER && !bJustTeleported)
+						{
+							const FVector NewVelocity = (Delta / subTimeTickRemaining);
+							Velocity = HasAnimRootMotion() || CurrentRootMotion.HasOverrideVelocityWithIgnoreZAccumulate() ? FVector(Velocity.X, Velocity.Y, NewVelocity.Z) : NewVelocity;
+						}
+
+						// bDitch=true means that pawn is straddling two slopes, neither of which he can stand on
+						bool bDitch = ((OldHitImpactNormal.Z > 0.f) && (Hit.ImpactNormal.Z > 0.f) && (FMath::Abs(Delta.Z) <= KINDA_SMALL_NUMBER) && ((Hit.ImpactNormal | OldHitImpactNormal) < 0.f));
+						SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
+						if (Hit.Time == 0.f)
+						{
+							// if we are stuck then try to side step
+							FVector SideDelta = (OldHitNormal + Hit.ImpactNormal).GetSafeNormal2D();
+							if (SideDelta.IsNearlyZero())
+							{
+								SideDelta = FVector(OldHitNormal.Y, -OldHitNormal.X, 0).GetSafeNormal();
+							}
+							SafeMoveUpdatedComponent(SideDelta, PawnRotation, true, Hit);
+						}
+
+						if (bDitch || IsValidLandingSpot(UpdatedComponent->GetComponentLocation(), Hit) || Hit.Time == 0.f)
+						{
+							remainingTime = 0.f;
+							ProcessLanded(Hit, remainingTime, Iterations);
+							return;
+						}
+						else if (GetPerchRadiusThreshold() > 0.f && Hit.Time == 1.f && OldHitImpactNormal.Z >= GetWalkableFloorZ())
+						{
+							// We might be in a virtual 'ditch' within our perch radius. This is rare.
+							const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
+							const float ZMovedDist = FMath::Abs(PawnLocation.Z - OldLocation.Z);
+							const float MovedDist2DSq = (PawnLocation - OldLocation).SizeSquared2D();
+							if (ZMovedDist <= 0.2f * timeTick && MovedDist2DSq <= 4.f * timeTick)
+							{
+								Velocity.X += 0.25f * GetMaxSpeed() * (RandomStream.FRand() - 0.5f);
+								Velocity.Y += 0.25f * GetMaxSpeed() * (RandomStream.FRand() - 0.5f);
+								Velocity.Z = FMath::Max<float>(JumpZVelocity * 0.25f, 1.f);
+								Delta = Velocity * timeTick;
+								SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if (Velocity.SizeSquared2D() <= KINDA_SMALL_NUMBER * 10.f)
+		{
+			Velocity.X = 0.f;
+			Velocity.Y = 0.f;
+		}
+
+		
+	}
+
+}
+#pragma endregion
@@ -1,349 +1,864 @@
-/**
- * Movement component meant for use with Pawns with support for WallRunning
- */
-
-#pragma once
-#include "GameFramework/CharacterMovementComponent.h"
-#include "ShooterMovementReplication.h"
-#include "ShooterMovementTypes.h"
-#include "ShooterCharacterMovement.generated.h"
-
-
-UCLASS()
-class UShooterCharacterMovement : public UCharacterMovementComponent
-{
-	GENERATED_BODY()
-
-public:
-	UShooterCharacterMovement(const FObjectInitializer& ObjectInitializer);
-
-	friend class FSavedMove_ShooterCharacter;
-
-	FShooterCharacterNetworkMoveDataContainer NetworkMoveDataContainer;
-
-
-public:
-	// The ground speed when running
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "My Character Movement|Grounded")
-	float RunSpeed = 900.0f;
-	// The ground speed when sprinting
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "My Character Movement|Grounded")
-	float SprintSpeed = 800.0f;
-	// The acceleration when running
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "My Character Movement|Grounded")
-	float RunAcceleration = 2048.0f;
-	// The acceleration when sprinting
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "My Character Movement|Grounded")
-	float SprintAcceleration = 2048.0f;
-
-#pragma region WallRun Defaults
-public:
-	// The player's velocity while wall running
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float WallRunSpeed = 1200.0f;
-
-	// TODO: DESC
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float WallRunAcceleration = 2048.0f;
-
-	/**  Deceleration when Wall Running and not applying acceleration */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float BrakingDecelerationWallRunning = 400.0f;
-
-	// The player's velocity while wall running (applied per side)
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float WallRunCooldown = 0.5f;
-
-	/**
-	 *  For how long does an "unstick" button need to be pressed for (in seconds) before the character unsticks from wall
-	 * Unstick button is button representing the opposite direction of WallRun normal (when wallrunning right wall, it would be A (WASD), if wallrunning left wall, it would be D)
-	 */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float UnstickFromWallTimeThreshold = 0.15f;
-	
-
-	/** If WallRun is finite, gravity increases greatly after WallRunDuration period */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Duration")
-	bool bIsWallRunInfinite = false;
-
-	/** If WallRun is finite, gravity increases greatly after WallRunDuration period */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Duration", meta = (EditCondition = "!bIsWallRunInfinite"))
-	float WallRunDuration = 1.7f;
-
-
-
-	/** Jump setting swhen player jumps same way (narrow angle) to wallrun direction */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Jump")
-	FWallRunJumpSettings WallRunForwardJump;
-
-	/** Jump settings when player jumps at 90 degree angle to wall direction (away from the wall) */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Jump")
-	FWallRunJumpSettings WallRunSideJump;
-
-	// Minimum Angle to launch character off the wall (When looking at the wall, we still launch character n degrees off the wall)
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Jump")
-	float MinimumWallrunJumpAngle = 15.0f;
-
-	// Maximum Angle to launch character off the wall
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Jump")
-	float MaximumWallrunJumpAngle = 90.0f;
-
-
-
-	// Length of the trace to detect wall
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
-	float CameraTiltWallDistance = 200.0f;
-	
-	/**  */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Camera Tilt")
-	bool bShouldTiltCamera = true;
-
-	/**  */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Camera Tilt", meta = (EditCondition = bShouldTiltCamera))
-	float CameraMaxTilt = 10.0f;
-
-	/** How quickly (in seconds to tilt from no tilt to full tilt) */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Camera Tilt", meta = (EditCondition = bShouldTiltCamera))
-	float CameraTiltSpeed = 0.2f;
-	
-
-	// Length of the trace to detect wall
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
-	float WallDetectDistance = 100.0f;
-
-	/** Number of rays to cast per side when detecting a nearby wall */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
-	int32 NumberOfRaysPerSide = 7;
-
-	/** We trace on 2 levels (top and bottom). This value determines the offset from middle of the character. */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
-	float FirstTraceTopOffset = 50.0f;
-
-	/** We trace on 2 levels (top and bottom). This value determines the offset from middle of the character for lower level (fallback) trace. */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
-	float FallbackTraceTopOffset = -200.0f;
-
-
-
-	/** Gravity scale before apex is reached (when character is sliding up) */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
-	float WallRunGravityScaleUp = 0.75f;
-
-	/** Gravity scale after apex is reached  */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
-	float WallRunGravityMidState = 0.11f;
-
-	/** Gravity scale after apex is reached  */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
-	float WallRunGravityEndState = 0.7f;
-
-	/** How quickly (in seconds) is WallRunGravityEndState applied after transition to end state. */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
-	float WallRunGravityEndStateApplySpeed = 0.5f;
-
-	/** The maximum required Velocity.Z needed to transition from State::Start to State::Mid */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
-	float WallRunMidZVelocityThreshold = 130.0f;
-
-	
-
-	/** Should increase gravity if character is going slowly? */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
-	bool bScaleWallRunGravityWithSpeed = true;
-
-	/** The fraction of WallRunSpeed to start increasing gravity. When character moves slow, increase the gravity */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity", meta = (EditCondition = bScaleWallRunGravityWithSpeed))
-	float ScaleWallRunGravityStart = 0.6f;
-
-	/** Gravity when Scaling with speed is enabled and character is moving slowly (0 velocity) */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity", meta = (EditCondition = bScaleWallRunGravityWithSpeed))
-	float WallRunGravityScaleSlow = 1.0f;
-
-
-
-	/* Z Velocity to be set when character starts new wallrun */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float WallRunStartZVelocity = 150.0f;
-
-	// Amount of constant force/velocity to apply to stick to the wall
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float WallRunPushVelocity = 1600.0f;
-
-	/* The minimum angle (from player forward vector) to accept as valid wallrun start 
-	This prevents wallrunning when we back to the wall. */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float WallRunStartMaxAngle = 120.0f;
-	
-	/** Should wallrun start be prevented if character is moving backwards */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	bool bPreventWallRunIfMovingBackwards = true;
-
-	
-	/** Push when player requests unsticking from wall */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
-	float WallRunUnstickVelocity = 300.0f;
-
-#pragma endregion
-
-
-#pragma region Networking
-
-	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
-	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
-
-#pragma endregion
-
-
-#pragma region Wall Running 
-	//////////////////////////////////////////////////////////////////////////
-	// Camera tilt
-
-	/** Is character close enough to wall to trigger camera tilt */
-	bool bIsCloseToWallToTiltCamera = false;
-
-	/** Direction of current camera tilt */
-	EWallRunSide CameraTiltSide = EWallRunSide::Left;
-
-	/** Camera tilt alpha/multiplier ranging from -1.0 (full left tilt) to 1.0 (full right tilt) */
-	float CurrentCameraTiltAlpha = 0.0f;
-	
-	/** Returns roll angle by which should the camera be titled by (from -X [left] to +X [right]) */
-	float GetCurrentCameraTilt();
-
-
-	//////////////////////////////////////////////////////////////////////////
-	// Cooldown
-
-	void StartWallRunCooldown(EWallRunSide Side);
-	bool IsWallRunOnCooldown(EWallRunSide Side);
-
-	float WallRunCooldownLeftTimeRemaining = 0.0f;
-	float WallRunCooldownRightTimeRemaining = 0.0f;
-
-	//////////////////////////////////////////////////////////////////////////
-	// Unstick from wall
-
-	// [client + server] Replicated via saved moved
-	uint8 bWallrunWantsToUnstick : 1;
-	
-	// Current time of how long WantsToUnstick was pressed for
-	float WantsToUnstickTimeRemaining = 0.0f;
-	
-	// Start short timer before calling UnstickFromWall_Internal which performs the unstick
-	void UnstickFromWallPressed();
-	
-	// Clears the timer time and sets wantstounstick to 0
-	void ResetUnstickFromWall();
-	
-	/** Performs the actual "unsticking" from wall */
-	UFUNCTION()
-	void UnstickFromWall_Internal();
-	
-
-	//////////////////////////////////////////////////////////////////////////
-	// Generic Wallrun
-
-	// Checks if wall is close enough and cooldown is down
-	bool CanStartWallRunSide(EWallRunSide Side, FVector& OutWallNormal, FVector& OutImpactPoint);
-
-	/** Starts wall running immediately for given side. WallRunNormal and Trace point are stored for physics calculations and debugging respectively */
-	void StartWallRunning(EWallRunSide Side, FVector InWallNormal, FVector InWallRunTraceImpactPoint);
-
-	/** Ends wallrun and transitions to fall state */
-	void StopWallRunning();
-
-	/** Important function - Traces from character body outwards in specific angles and takes 
-	* first impact point (the smallest angle from actor forward vector) and outputs if we hit any wall at all and 
-	* if so, a normal of that hit wall surface (only XY axis)
-	*/
-	bool TraceNearbyForWalls(EWallRunSide Side, bool bFallbackToFeetLevel, FVector& OutNormal, FVector& OutImpactPoint);
-
-	/** Returns the current gravity scale. This changes based on state, time etc. */
-	float GetWallRunGravityScale();
-
-	/** Is character currently performing a WallRun? */
-	bool IsWallRunning();
-
-	/** Is character currently performing a WallRun for a given side? */
-	bool IsWallRunningSide(EWallRunSide Side);
-
-	// The side of the wall the player is running on.
-	EWallRunSide WallRunSide;
-
-	// How long till the wallrun transitions to END state. (Timer)
-	float WallRunTimeRemaining = 0.0f;
-
-	/** Timer start only when transiting from START -> MID state where the "proper" wallrun begins */
-	bool bIsWallRunDurationTimerStarted = false;
-
-	// Important - Is used for calculations such as way of wallrunning (forward vector)
-	FVector WallRunWallNormal;
-	
-	// Used for debugging
-	FVector WallRunTraceImpactPoint;
-
-	// When ending wallrun (last stage), gravity in gradually increasing. This is the currant gravity value
-	float CurrentWallRunEndGravity = 0.0f;
-
-	// Current state of wallrun
-	EWallRunState WallRunState = EWallRunState::Start;
-
-	/** Returns a direction indicating the forward direction of WallRun (expected to be parallel with the wall) */
-	FVector GetWallRunForwardDirection();
-
-	/** Returns a direction indicating the forward direction of WallRun with explicitely given wall normal and wallrun side. */
-	FVector GetWallRunForwardDirection(EWallRunSide Side, FVector WallNormal);
-
-	/** Returns the acceleration when wallrunning */
-	FVector GetWallRunLateralAcceleration(float deltaTime);
-
-	/** Timer has expired, move to end state of wallrun */
-	void TransitionWallRunToEndState();
-
-	/** IMPORTANT: This is where the heavy lifting is done. This function is heavely inspired by PhysFalling but modified to work for wallrunning. It is responsible for moving character along the wall */
-	void PhysWallRunning(float deltaTime, int32 Iterations);
-
-	/** Perform a jump from wall */
-	void DoWallRunJump(bool bReplayingMoves);
-
-
-#pragma endregion
-
-#pragma region Overrides
-protected:
-	virtual void BeginPlay() override;
-	/** Update the character state in PerformMovement right before doing the actual position change */
-	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds);
-
-	/** Update the character state in PerformMovement after the position change. Some rotation updates happen after this. */
-	virtual void UpdateCharacterStateAfterMovement(float DeltaSeconds);
-
-	virtual void OnComponentDestroyed(bool bDestroyingHierarchy) override;
-public:
-	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
-
-	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
-	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
-	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
-	virtual float GetMaxSpeed() const override;
-	virtual float GetMaxAcceleration() const override;
-	virtual float GetMaxBrakingDeceleration() const override;
-	virtual void ProcessLanded(const FHitResult& Hit, float remainingTime, int32 Iterations) override;
-#pragma endregion
-
-
-
-#pragma region Private Variables
-
-
-
-#pragma endregion
-
-	bool DoJump(bool bReplayingMoves) override;
-
-protected:
-	void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
-
-	
-	
-};
+/**
+ * Movement component meant for use with Pawns with support for WallRunning
+ */
+
+#pragma once
+#include "GameFramework/CharacterMovementComponent.h"
+#include "ShooterMovementReplication.h"
+#include "ShooterMovementTypes.h"
+#include "WallQueryBackend.h"
+#include "WallGeometryHistory.h"
+#include "ShooterMoveCapture.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ShooterCharacterMovement.generated.h"
+
+
+/** stat WallRun - cycle counters live in ShooterCharacterMovement.cpp, per-frame counts are shared with the replication code */
+DECLARE_STATS_GROUP(TEXT("WallRun"), STATGROUP_WallRun, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Detection Calls"), STAT_WallRunDetectionCalls, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rays Cast"), STAT_WallRunRaysCast, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Fallback Rays Cast"), STAT_WallRunFallbackRaysCast, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Substeps"), STAT_WallRunSubsteps, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Starts"), STAT_WallRunStarts, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Stops"), STAT_WallRunStops, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Chains"), STAT_WallRunChains, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Surface Lookups"), STAT_WallRunSurfaceLookups, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Trajectory Predictions"), STAT_WallRunPredictions, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rewound Traces"), STAT_WallRunRewoundTraces, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Jumps"), STAT_WallRunJumps, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Combined Moves"), STAT_WallRunCombinedMoves, STATGROUP_WallRun, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Replayed Moves"), STAT_WallRunReplayedMoves, STATGROUP_WallRun, );
+
+CSV_DECLARE_CATEGORY_EXTERN(WallRun);
+
+/** Adds to a per-frame WallRun counter, both in stats and CSV profiles (e.g. WALLRUN_INC_COUNTER(Jumps, 1)) */
+#define WALLRUN_INC_COUNTER(Name, Amount) \
+	do \
+	{ \
+		INC_DWORD_STAT_BY(STAT_WallRun##Name, Amount); \
+		CSV_CUSTOM_STAT(WallRun, Name, (int32)(Amount), ECsvCustomStatOp::Accumulate); \
+	} while (0)
+
+
+class AShooterCharacter;
+class AWallRunSurfaceIndex;
+class UPhysicalMaterial;
+class UInputComponent;
+
+/** Setup of TraceNearbyForWalls queries which doesn't change between moves of one server packet */
+struct FWallRunTraceContext
+{
+	AShooterCharacter* Pawn = nullptr;
+
+	/** Traces against the world, used unless the backend is overridden */
+	FWallQueryBackend_Physics PhysicsBackend;
+	IWallQueryBackend* BackendOverride = nullptr;
+
+	/** [server] Physics traces with dynamic walls where the client saw them, see UShooterCharacterMovement::bLagCompensateWallDetection */
+	FWallQueryBackend_Rewound RewoundBackend;
+
+	/** Cos (X) and Sin (Y) of the ray fan angles, in order of priority */
+	TArray<FVector2D, TInlineAllocator<16>> RayRotations;
+
+	const IWallQueryBackend& GetBackend() const { return BackendOverride ? *BackendOverride : PhysicsBackend; }
+};
+
+/** Everything the wall detection ray fan needs to know, independent of world and character */
+struct FWallFanQuery
+{
+	/** Character location and forward vector */
+	FVector Origin = FVector::ZeroVector;
+	FVector Forward = FVector::ForwardVector;
+
+	/** -1 for left side, 1 for right side */
+	float Direction = 1.0f;
+
+	/** Length of each ray and the distance within which a hit counts as a wall */
+	float RayLength = 0.0f;
+	float WallDetectDistance = 0.0f;
+
+	float FirstTraceTopOffset = 0.0f;
+	float FallbackTraceTopOffset = 0.0f;
+	bool bFallbackToFeetLevel = false;
+
+	/** Cos (X) and Sin (Y) of the ray fan angles, in order of priority */
+	TArrayView<const FVector2D> RayRotations;
+
+	/** If false, the rest of the fan is still traced after the first wall is found (e.g. to fit a wall plane from all hits) */
+	bool bStopAtFirstWall = true;
+};
+
+
+/** Predicted path of a wallrunning character, see UShooterCharacterMovement::PredictWallRunTrajectory */
+struct FWallRunTrajectoryPrediction
+{
+	/** World time of the first sample, Samples[i] is the predicted location at StartTime + i * SampleInterval */
+	float StartTime = 0.0f;
+	float SampleInterval = 0.0f;
+	TArray<FVector, TInlineAllocator<64>> Samples;
+
+	/** Where and when (world time) the character reaches the floor below it, if within the predicted time */
+	bool bHasLanding = false;
+	FVector LandingLocation = FVector::ZeroVector;
+	float LandingTime = 0.0f;
+
+	/** Predicted location at the given world time, clamped to the predicted time span */
+	FVector GetLocationAt(float WorldTime) const;
+
+	float GetEndTime() const { return StartTime + FMath::Max(Samples.Num() - 1, 0) * SampleInterval; }
+
+	/** False when the character wasn't wallrunning, Samples is empty then */
+	bool IsValid() const { return bValid; }
+
+private:
+	friend class UShooterCharacterMovement;
+
+	/** Wallrun state the prediction was made from, any change invalidates it */
+	uint32 StateKey = 0;
+	FVector WallNormal = FVector::ZeroVector;
+	FVector AimForward = FVector::ZeroVector;
+	bool bValid = false;
+};
+
+
+/** Wallrun state advanced by UShooterCharacterMovement::StepWallRunSimulation, for simulations outside of the movement */
+struct FWallRunSimState
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	EWallRunState State = EWallRunState::Start;
+	bool bTimerStarted = false;
+	float TimeRemaining = 0.0f;
+
+	/** Surface of the wall, its GravityScale is applied by the step. DurationScale and SpeedScale are up to whoever starts the simulation. */
+	FWallRunSurfaceParams Surface;
+};
+
+
+UCLASS()
+class UShooterCharacterMovement : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UShooterCharacterMovement(const FObjectInitializer& ObjectInitializer);
+
+	friend class FSavedMove_ShooterCharacter;
+	friend class FWallRunDeferredJumpTest;
+
+	FShooterCharacterNetworkMoveDataContainer NetworkMoveDataContainer;
+	FShooterCharacterMoveResponseDataContainer MoveResponseDataContainer;
+
+
+public:
+	// The ground speed when running
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "My Character Movement|Grounded")
+	float RunSpeed = 900.0f;
+	// The ground speed when sprinting
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "My Character Movement|Grounded")
+	float SprintSpeed = 800.0f;
+	// The acceleration when running
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "My Character Movement|Grounded")
+	float RunAcceleration = 2048.0f;
+	// The acceleration when sprinting
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "My Character Movement|Grounded")
+	float SprintAcceleration = 2048.0f;
+
+#pragma region WallRun Defaults
+public:
+	// The player's velocity while wall running
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float WallRunSpeed = 1200.0f;
+
+	// TODO: DESC
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float WallRunAcceleration = 2048.0f;
+
+	/**  Deceleration when Wall Running and not applying acceleration */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float BrakingDecelerationWallRunning = 400.0f;
+
+	// The player's velocity while wall running (applied per side)
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float WallRunCooldown = 0.5f;
+
+	/**
+	 *  For how long does an "unstick" button need to be pressed for (in seconds) before the character unsticks from wall
+	 * Unstick button is button representing the opposite direction of WallRun normal (when wallrunning right wall, it would be A (WASD), if wallrunning left wall, it would be D)
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float UnstickFromWallTimeThreshold = 0.15f;
+	
+
+	/** If WallRun is finite, gravity increases greatly after WallRunDuration period */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Duration")
+	bool bIsWallRunInfinite = false;
+
+	/** If WallRun is finite, gravity increases greatly after WallRunDuration period */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Duration", meta = (EditCondition = "!bIsWallRunInfinite"))
+	float WallRunDuration = 1.7f;
+
+
+
+	/** Jump setting swhen player jumps same way (narrow angle) to wallrun direction */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Jump")
+	FWallRunJumpSettings WallRunForwardJump;
+
+	/** Jump settings when player jumps at 90 degree angle to wall direction (away from the wall) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Jump")
+	FWallRunJumpSettings WallRunSideJump;
+
+	// Minimum Angle to launch character off the wall (When looking at the wall, we still launch character n degrees off the wall)
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Jump")
+	float MinimumWallrunJumpAngle = 15.0f;
+
+	// Maximum Angle to launch character off the wall
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Jump")
+	float MaximumWallrunJumpAngle = 90.0f;
+
+
+
+	// Length of the camera tilt proximity trace (walls closer than this pre-tilt the camera of local player)
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	float CameraTiltWallDistance = 200.0f;
+	
+	/**  */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Camera Tilt")
+	bool bShouldTiltCamera = true;
+
+	/**  */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Camera Tilt", meta = (EditCondition = bShouldTiltCamera))
+	float CameraMaxTilt = 10.0f;
+
+	/** How quickly (in seconds to tilt from no tilt to full tilt) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Camera Tilt", meta = (EditCondition = bShouldTiltCamera))
+	float CameraTiltSpeed = 0.2f;
+
+	/** How many times per second locally controlled characters look for walls to pre-tilt the camera towards (0 = every tick) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Camera Tilt", meta = (EditCondition = bShouldTiltCamera, ClampMin = "0"))
+	float CameraTiltQueryRate = 15.0f;
+	
+
+	// Length of the trace to detect wall
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	float WallDetectDistance = 100.0f;
+
+	/** Number of rays to cast per side when detecting a nearby wall */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	int32 NumberOfRaysPerSide = 7;
+
+	/** We trace on 2 levels (top and bottom). This value determines the offset from middle of the character. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	float FirstTraceTopOffset = 50.0f;
+
+	/** We trace on 2 levels (top and bottom). This value determines the offset from middle of the character for lower level (fallback) trace. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	float FallbackTraceTopOffset = -200.0f;
+
+	/**
+	 * Fit the wall normal from all fan rays hitting the wall (weighted least squares over hit points and normals),
+	 * instead of using the normal of the first hit. Keeps the normal stable on faceted and curved walls, so more moves combine.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	bool bFitWallPlaneFromFan = false;
+
+	/** Hits with normal further than this (in degrees) from the first hit are considered a different wall and left out of the fit */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection", meta = (EditCondition = bFitWallPlaneFromFan, ClampMin = "0", ClampMax = "90"))
+	float WallPlaneFitMaxNormalAngle = 45.0f;
+
+	/**
+	 * Channel wall detection traces on. Using a dedicated channel which only surfaces designers opted in block
+	 * skips props, foliage and complex collision in the broad phase, instead of hitting them first like Visibility does.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	TEnumAsByte<ECollisionChannel> WallRunTraceChannel = ECC_Visibility;
+
+	/** If not empty, wall detection only considers these object types (WallRunTraceChannel is not used) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	TArray<TEnumAsByte<EObjectTypeQuery>> WallRunObjectTypes;
+
+	/** Detect walls in the baked surface index of the level (WallRun.BakeSurfaceIndex) instead of the physics scene, if the level has one */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Wall Detection")
+	bool bUseBakedWallIndex = false;
+
+
+
+	/** Gravity scale before apex is reached (when character is sliding up) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
+	float WallRunGravityScaleUp = 0.75f;
+
+	/** Gravity scale after apex is reached  */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
+	float WallRunGravityMidState = 0.11f;
+
+	/** Gravity scale after apex is reached  */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
+	float WallRunGravityEndState = 0.7f;
+
+	/** How quickly (in seconds) is WallRunGravityEndState applied after transition to end state. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
+	float WallRunGravityEndStateApplySpeed = 0.5f;
+
+	/** The maximum required Velocity.Z needed to transition from State::Start to State::Mid */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
+	float WallRunMidZVelocityThreshold = 130.0f;
+
+	
+
+	/** Should increase gravity if character is going slowly? */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity")
+	bool bScaleWallRunGravityWithSpeed = true;
+
+	/** The fraction of WallRunSpeed to start increasing gravity. When character moves slow, increase the gravity */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity", meta = (EditCondition = bScaleWallRunGravityWithSpeed))
+	float ScaleWallRunGravityStart = 0.6f;
+
+	/** Gravity when Scaling with speed is enabled and character is moving slowly (0 velocity) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Gravity", meta = (EditCondition = bScaleWallRunGravityWithSpeed))
+	float WallRunGravityScaleSlow = 1.0f;
+
+
+
+	/* Z Velocity to be set when character starts new wallrun */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float WallRunStartZVelocity = 150.0f;
+
+	// Amount of constant force/velocity to apply to stick to the wall
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float WallRunPushVelocity = 1600.0f;
+
+	/* The minimum angle (from player forward vector) to accept as valid wallrun start 
+	This prevents wallrunning when we back to the wall. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float WallRunStartMaxAngle = 120.0f;
+	
+	/** Should wallrun start be prevented if character is moving backwards */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	bool bPreventWallRunIfMovingBackwards = true;
+
+	/**
+	 * When the wall runs out, look for a wall on the other side right away and continue the wallrun on it,
+	 * without falling in between. Corners on the same side are already followed by the wall normal update.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	bool bAllowWallRunChaining = false;
+
+	/**
+	 * Wallruns on movable components (trains, elevators) use the wall as movement base: the character is carried along with it,
+	 * location is replicated relative to it and the wall normal is kept in its local space. Needs wall detection against the
+	 * physics scene, the baked wall index only contains static geometry.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	bool bSupportMovingWalls = false;
+
+	/**
+	 * Per-surface tuning keyed by the physical material of the wall. Resolved once when a wallrun starts and kept until it ends,
+	 * walls without an entry use the values above unchanged. Looked up with the physical material of the detection hit,
+	 * walls found in the baked wall index have no materials.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Surfaces")
+	TMap<UPhysicalMaterial*, FWallRunSurfaceParams> WallRunSurfaceOverrides;
+
+	/** How far ahead (in seconds) PredictWallRunTrajectory is guaranteed to reach */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Prediction", meta = (ClampMin = "0.1"))
+	float WallRunPredictionTime = 1.0f;
+
+	/** Time between samples of a predicted path */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Prediction", meta = (ClampMin = "0.01"))
+	float WallRunPredictionSampleInterval = 1.0f / 30.0f;
+
+	/** Cached prediction is recomputed once the character is further (in cm) than this from the predicted path (from the take-off point for jumps) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Prediction", meta = (ClampMin = "0"))
+	float WallRunPredictionTolerance = 20.0f;
+
+	
+	/** Push when player requests unsticking from wall */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running")
+	float WallRunUnstickVelocity = 300.0f;
+
+
+
+	/**
+	 * Keep wallrun timers (duration, cooldowns, unstick) on a fixed grid of whole ticks instead of free running floats.
+	 * Timers hold exact tick counts instead of accumulating float error, so client and server stay bit identical for the same moves.
+	 * Sub-tick parts of move deltas are carried over (WallRunTimerTickRemainder), timers run at real time speed.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking")
+	bool bUseQuantizedWallRunTimers = false;
+
+	/** Resolution of quantized wallrun timers (ticks per second) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (EditCondition = bUseQuantizedWallRunTimers, ClampMin = "1"))
+	int32 WallRunTimerTicksPerSecond = 1000;
+
+	/**
+	 * Moves carry when within the move the wall jump or unstick was pressed (1/256 of the move) and wallrun physics is split at that instant
+	 * on client and server, instead of applying the input at the start of the move. Matters at low client frame rates where moves are long.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking")
+	bool bUseSubTickWallRunInput = false;
+
+	/** Input action the character jumps with, the component binds WallRunJumpPressed to it while bUseSubTickWallRunInput is set (None to call it by hand) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (EditCondition = bUseSubTickWallRunInput))
+	FName WallRunJumpActionName = TEXT("Jump");
+
+	/**
+	 * Allocate client saved moves from one preallocated pool instead of a separate heap allocation per move.
+	 * Helps high-ping clients where the unacked move history is long and is walked on every ack and replay.
+	 * Moves are not kept in any particular order in the pool, the engine reuses its most recently freed move first.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking")
+	bool bUseSavedMovePool = false;
+
+	/**
+	 * The highest round trip time (in seconds) the saved move pool is sized for. Raises the engine limit of unacked moves (MaxSavedMoveCount)
+	 * if it needs more, the pool always holds at least that many moves.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (EditCondition = bUseSavedMovePool, ClampMin = "0"))
+	float SavedMovePoolMaxLatency = 0.3f;
+
+	/** How many saved moves per second the client is expected to create (roughly its max frame rate) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (EditCondition = bUseSavedMovePool, ClampMin = "1"))
+	float SavedMovePoolMovesPerSecond = 120.0f;
+
+	/** How much (per component) the wall normal may differ between two saved moves for them to be combined. Tune with WallRun.CombineHarness. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (ClampMin = "0"))
+	float WallNormalCombineThreshold = 0.01f;
+
+	/** Minimum acceleration direction similarity (dot product) for two moves starting on a wall to be combined. Engine default is 0.996. Tune with WallRun.CombineHarness. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (ClampMin = "-1", ClampMax = "1"))
+	float WallRunAccelDotCombineThreshold = 0.996f;
+
+	/** Acceleration direction change (dot product) under which a steady wallrun move is not considered important. Engine default is 0.9. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (ClampMin = "-1", ClampMax = "1"))
+	float WallRunSteadyAccelDotThreshold = 0.7f;
+
+	/** Multiplier of the client send interval while wallrunning steadily, so more moves get combined. Wallrun transitions are always sent immediately. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (ClampMin = "1"))
+	float WallRunSteadyNetSendIntervalScale = 1.0f;
+
+	/**
+	 * Client sends the wall it detected with every move and the server verifies it with a single probe instead of tracing the full ray fan.
+	 * Full detection runs on the server when the claim doesn't check out, when the client claims there is no wall (so it can't veto
+	 * a wallrun the server sees) and with bFitWallPlaneFromFan (the fitted normal needs the whole fan).
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking")
+	bool bVerifyClientWallClaims = false;
+
+	/** How far (in cm) can the claimed impact point be from what the server probe finds */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking", meta = (EditCondition = bVerifyClientWallClaims, ClampMin = "0"))
+	float WallClaimTolerance = 10.0f;
+
+	/**
+	 * [server] Wall detection for a received move traces dynamic walls (see AWallGeometryHistory) where they were when the client made the move,
+	 * about one round trip ago, instead of where they are now. Only applies to physics scene traces, the baked wall index is static.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Character Movement: Wall Running|Networking")
+	bool bLagCompensateWallDetection = false;
+
+#pragma endregion
+
+
+#pragma region Networking
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
+	virtual bool CanDelaySendingMove(const FSavedMovePtr& NewMove) override;
+	virtual float GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const override;
+	virtual bool ClientUpdatePositionAfterServerUpdate() override;
+	virtual void ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse) override;
+
+	/** [server] Starts recording client moves as they arrive (see FShooterMoveCapture) */
+	void StartMoveCapture();
+
+	/** [server] Stops recording and returns the capture, nullptr if no capture was running */
+	TSharedPtr<FShooterMoveCapture> StopMoveCapture();
+
+	bool IsCapturingMoves() const { return ActiveMoveCapture.IsValid(); }
+
+	/** [server] Resets character to the captured start state and runs all captured moves through MoveAutonomous. Refused while this character is being captured. */
+	FShooterMoveReplayResult ReplayMoveCapture(const FShooterMoveCapture& Capture);
+
+	/** Hash of the simulated movement state (transform, velocity, movement mode and all wallrun state), used to check replays for determinism */
+	uint32 GetMovementStateHash() const;
+
+protected:
+	/** [client] Compares the server wallrun state sent with a correction to what we recorded for the corrected move */
+	void AttributeCorrection(float TimeStamp, const FWallRunStateSnapshot& ServerSnapshot);
+
+	/** Processes all moves of one client packet with a shared wall trace setup */
+	virtual void ServerMove_HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer) override;
+
+	/** Fills in the per-packet part of wall traces (pawn, query params, ray fan) */
+	void InitWallRunTraceContext(FWallRunTraceContext& OutContext);
+
+	/** Sub-tick input offsets of the move are set before Super, so CheckJumpInput already defers the wall jump like the server does */
+	virtual void ControlledCharacterMove(const FVector& InputVector, float DeltaSeconds) override;
+
+	/** [client] Real time of presses not used by a move yet and of the previous move, for sub-tick input offsets */
+	double WallRunJumpInputTime = 0.0;
+	double WallRunUnstickInputTime = 0.0;
+	double LastControlledMoveTime = 0.0;
+
+	/** Converts the real time of a press to its offset within the move covering [LastControlledMoveTime, MoveTime] */
+	uint8 GetSubTickInputOffset(double InputTime, double MoveTime) const;
+
+	/** [client] Binds WallRunJumpPressed to WallRunJumpActionName, again whenever the character gets a new input component */
+	void BindWallRunInput();
+	TWeakObjectPtr<UInputComponent> WallRunInputComponent;
+
+	/** Trace setup valid while a server packet is being processed */
+	FWallRunTraceContext BatchedTraceContext;
+	bool bHasBatchedTraceContext = false;
+
+	/** Wall queries go here instead of the world if set */
+	TSharedPtr<IWallQueryBackend> WallQueryBackendOverride;
+
+	/** Baked surface index of the level, found on BeginPlay when bUseBakedWallIndex is set */
+	TWeakObjectPtr<AWallRunSurfaceIndex> BakedWallIndex;
+
+	/** [server] Recorded dynamic walls, found or spawned on BeginPlay when bLagCompensateWallDetection is set */
+	TWeakObjectPtr<AWallGeometryHistory> WallGeometryHistory;
+
+	/** [server] Client timestamp to the server time of the world the client saw when making the move, tracked per packet */
+	float ClientToServerTimeOffset = 0.0f;
+	bool bHasClientToServerTimeOffset = false;
+	/** [server] Moves of the packet being processed are rewound one by one in MoveAutonomous */
+	bool bRewindWallQueries = false;
+
+	/** Client moves are recorded here while set */
+	TSharedPtr<FShooterMoveCapture> ActiveMoveCapture;
+
+public:
+
+#pragma endregion
+
+
+#pragma region Wall Running 
+	//////////////////////////////////////////////////////////////////////////
+	// Camera tilt
+
+	/** Is character close enough to wall to trigger camera tilt */
+	bool bIsCloseToWallToTiltCamera = false;
+
+	/** Direction of current camera tilt */
+	EWallRunSide CameraTiltSide = EWallRunSide::Left;
+
+	/** Camera tilt alpha/multiplier ranging from -1.0 (full left tilt) to 1.0 (full right tilt) */
+	float CurrentCameraTiltAlpha = 0.0f;
+	
+	/** Returns roll angle by which should the camera be titled by (from -X [left] to +X [right]) */
+	float GetCurrentCameraTilt();
+
+	/** Time until the next camera tilt proximity query */
+	float CameraTiltQueryTimeRemaining = 0.0f;
+
+	/** [local] Looks for walls within CameraTiltWallDistance the character is heading to. Cosmetic only, not part of the simulated move. */
+	void UpdateCameraTiltProximity();
+
+	/** Wall on given side within CameraTiltWallDistance, which character velocity heads to */
+	bool IsHeadingToWallForCameraTilt(const FWallRunTraceContext& TraceContext, EWallRunSide Side) const;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// Cooldown
+
+	void StartWallRunCooldown(EWallRunSide Side);
+	bool IsWallRunOnCooldown(EWallRunSide Side);
+
+	float WallRunCooldownLeftTimeRemaining = 0.0f;
+	float WallRunCooldownRightTimeRemaining = 0.0f;
+
+	//////////////////////////////////////////////////////////////////////////
+	// Timers
+
+	/** Converts time to whole timer ticks (see WallRunTimerTicksPerSecond) */
+	int32 WallRunTimeToTicks(float Seconds) const;
+
+	/** Converts whole timer ticks back to time */
+	float WallRunTicksToTime(int32 Ticks) const;
+
+	/** Snaps time to the timer tick grid if quantized timers are used, otherwise returns it unchanged */
+	float QuantizeWallRunTime(float Seconds) const;
+
+	/** Counts down all wallrun timers (unstick, cooldowns, duration) in one pass and fires their expiry events */
+	void UpdateWallRunTimers(float DeltaSeconds);
+
+	/** [client + server] Fraction of a timer tick not yet counted down by quantized timers, carried into the next move */
+	float WallRunTimerTickRemainder = 0.0f;
+
+	//////////////////////////////////////////////////////////////////////////
+	// Unstick from wall
+
+	// [client + server] Replicated via saved moved
+	uint8 bWallrunWantsToUnstick : 1;
+	
+	// Current time of how long WantsToUnstick was pressed for
+	float WantsToUnstickTimeRemaining = 0.0f;
+	
+	// Start short timer before calling UnstickFromWall_Internal which performs the unstick
+	void UnstickFromWallPressed();
+
+	/** [client] Remembers when the jump was pressed (see bUseSubTickWallRunInput), bound to WallRunJumpActionName. Call it along with Jump() when jumping without input. */
+	void WallRunJumpPressed();
+
+	/** [client + server] Offset (in 1/256 of the move) of the jump and unstick press within the move being performed, 0 is the start of the move */
+	uint8 WallRunJumpInputOffset = 0;
+	uint8 WallRunUnstickInputOffset = 0;
+
+	/** Wall jump pressed part way through the move, done by PhysWallRunning at WallRunJumpInputOffset */
+	bool bWallRunJumpDeferred = false;
+	bool bWallRunJumpDeferredReplaying = false;
+	
+	// Clears the timer time and sets wantstounstick to 0
+	void ResetUnstickFromWall();
+	
+	/** Performs the actual "unsticking" from wall */
+	UFUNCTION()
+	void UnstickFromWall_Internal();
+	
+
+	//////////////////////////////////////////////////////////////////////////
+	// Generic Wallrun
+
+	// Checks if wall is close enough and cooldown is down
+	bool CanStartWallRunSide(EWallRunSide Side, FVector& OutWallNormal, FVector& OutImpactPoint);
+
+	/** Starts wall running immediately for given side. WallRunNormal and Trace point are stored for physics calculations and debugging respectively */
+	void StartWallRunning(EWallRunSide Side, FVector InWallNormal, FVector InWallRunTraceImpactPoint);
+
+	/** Makes the wall found by the last detection the movement base if it can move, clears the base otherwise (see bSupportMovingWalls) */
+	void UpdateWallRunBase();
+
+	/** Whether the current wallrun is on a movable wall used as movement base */
+	bool IsWallRunningOnMovingWall() const;
+
+	/** Wall component and physical material hit by the last successful wall detection */
+	TWeakObjectPtr<UPrimitiveComponent> DetectedWallComponent;
+	TWeakObjectPtr<UPhysicalMaterial> DetectedWallPhysMaterial;
+
+	/** WallRunWallNormal in the space of the movement base while wallrunning on a moving wall */
+	FVector WallRunLocalWallNormal = FVector::ZeroVector;
+
+	/** Looks up WallRunSurfaceOverrides for the wall found by the last detection, sets CurrentWallRunSurface */
+	void ResolveWallRunSurface();
+
+	/** Surface tuning of the current wallrun, resolved at start (see WallRunSurfaceOverrides) */
+	FWallRunSurfaceParams CurrentWallRunSurface;
+
+	/** Wall on Side ran out, hands the wallrun over to a wall on the other side without leaving CMOVE_WallRunning. Returns false if there is none. */
+	template<bool bPreventMovingBackwards>
+	bool TryChainWallRun(EWallRunSide Side);
+
+	/** Ends wallrun and transitions to fall state */
+	void StopWallRunning();
+
+	/** Important function - Traces from character body outwards in specific angles and takes 
+	* first impact point (the smallest angle from actor forward vector) and outputs if we hit any wall at all and 
+	* if so, a normal of that hit wall surface (only XY axis)
+	*/
+	bool TraceNearbyForWalls(EWallRunSide Side, bool bFallbackToFeetLevel, FVector& OutNormal, FVector& OutImpactPoint);
+
+	/** Casts the detection ray fan against given backend and returns first ray (in order of priority) which hit a wall. OnRayTraced is called for every traced ray. */
+	static bool TraceWallFan(const IWallQueryBackend& Backend, const FWallFanQuery& Query, FWallQueryHit& OutHit, TFunctionRef<void(const FWallQueryHit&)> OnRayTraced);
+
+	/** Horizontal normal of a wall plane fitted through PrimaryHit and WallHits (closer hits weigh more, hits of other walls are ignored) */
+	static FVector FitWallPlaneNormal(const FWallQueryHit& PrimaryHit, TArrayView<const FWallQueryHit> WallHits, float WallDetectDistance, float MaxNormalAngle);
+
+	/** Same result as TraceWallFan, but casts the whole fan in one batch. Used for backends which prefer batched raycasts. */
+	static bool TraceWallFanBatched(const IWallQueryBackend& Backend, const FWallFanQuery& Query, FWallQueryHit& OutHit, TFunctionRef<void(const FWallQueryHit&)> OnRayTraced);
+
+	/** Start angle filters of CanStartWallRunSide. Rejects starts when the character looks too far away from run direction or moves backwards. */
+	static bool IsValidWallRunStartDirection(const FVector& PawnForwardVector, const FVector& PawnVelocity, const FVector& RunDirection, float MaxAngle, bool bPreventMovingBackwards);
+
+	/** Replaces the physics scene as source of wall queries (e.g. with FWallQueryBackend_Analytic). Pass nullptr to go back to the baked index (see bUseBakedWallIndex) or the world. */
+	void SetWallQueryBackend(TSharedPtr<IWallQueryBackend> InBackend);
+
+	/** Moving average of the angle (in degrees) the wall normal changes by per wallrun update. WallRun.ShowNormalJitter */
+	float WallNormalJitter = 0.0f;
+
+	/** Saved moves made while wallrunning and how many of them were combined, for WallRun.ShowNormalJitter */
+	uint32 NumWallRunSavedMoves = 0;
+	uint32 NumWallRunCombinedMoves = 0;
+
+	/** [client] Corrections received from the server so far */
+	uint32 NumCorrectionsReceived = 0;
+
+	/** [client] Result of the last wall detection, sent to server with the move (see bVerifyClientWallClaims) */
+	EWallRunWallClaim DetectedWallClaim = EWallRunWallClaim::None;
+
+	/** [server] Wall claimed by the client for the move currently being processed */
+	EWallRunWallClaim ServerWallClaim = EWallRunWallClaim::None;
+	FVector ServerWallClaimImpactPoint;
+
+	/**
+	 * [server] Checks client claimed wall with a single probe. Returns true if the claim settled the query (bOutHasWall and outputs are valid),
+	 * false if full wall detection is needed (no claim, a claim of no wall on this side, or the claim didn't check out).
+	 */
+	bool VerifyClientWallClaim(EWallRunSide Side, bool bFallbackToFeetLevel, FVector& OutNormal, FVector& OutImpactPoint, bool& bOutHasWall);
+
+	/** Returns the current gravity scale. This changes based on state, time etc. */
+	float GetWallRunGravityScale();
+
+	/**
+	 * Where the character will be over the next WallRunPredictionTime seconds if it keeps wallrunning (or wall jumps right now with
+	 * bJumpNow), for AI and server side aim assist. Forward simulates wallrun states, timers and gravity along the wall without
+	 * collision, landing is estimated against the floor below the character. Empty unless wallrunning.
+	 * Simulated proxies predict from ReplicatedWallRunState, their duration timer runs from the last update they got.
+	 * Results are cached until the wallrun state changes or the character leaves the predicted path, so it's cheap to call every frame.
+	 */
+	const FWallRunTrajectoryPrediction& PredictWallRunTrajectory(bool bJumpNow = false);
+
+	/** Is character currently performing a WallRun? */
+	bool IsWallRunning();
+
+	/** Is character currently performing a WallRun for a given side? */
+	bool IsWallRunningSide(EWallRunSide Side);
+
+	// The side of the wall the player is running on.
+	EWallRunSide WallRunSide;
+
+	// How long till the wallrun transitions to END state. (Timer)
+	float WallRunTimeRemaining = 0.0f;
+
+	/** Timer start only when transiting from START -> MID state where the "proper" wallrun begins */
+	bool bIsWallRunDurationTimerStarted = false;
+
+	// Important - Is used for calculations such as way of wallrunning (forward vector)
+	FVector WallRunWallNormal;
+	
+	// Used for debugging
+	FVector WallRunTraceImpactPoint;
+
+	// When ending wallrun (last stage), gravity in gradually increasing. This is the currant gravity value
+	float CurrentWallRunEndGravity = 0.0f;
+
+	// Current state of wallrun
+	EWallRunState WallRunState = EWallRunState::Start;
+
+	/** Returns a direction indicating the forward direction of WallRun (expected to be parallel with the wall) */
+	FVector GetWallRunForwardDirection();
+
+	/** Returns a direction indicating the forward direction of WallRun with explicitely given wall normal and wallrun side. */
+	FVector GetWallRunForwardDirection(EWallRunSide Side, FVector WallNormal) const;
+
+	/** Returns the acceleration when wallrunning */
+	FVector GetWallRunLateralAcceleration(float deltaTime);
+
+	/** Timer has expired, move to end state of wallrun */
+	void TransitionWallRunToEndState();
+
+	/** IMPORTANT: This is where the heavy lifting is done. This function is heavely inspired by PhysFalling but modified to work for wallrunning. It is responsible for moving character along the wall */
+	void PhysWallRunning(float deltaTime, int32 Iterations);
+
+	//////////////////////////////////////////////////////////////////////////
+	// Specialized variants
+	// bIsWallRunInfinite, bScaleWallRunGravityWithSpeed and bPreventWallRunIfMovingBackwards rarely change at runtime,
+	// so the hot paths are compiled once per combination and the matching one is picked up front instead of branching every substep.
+	// WallRun.BenchmarkVariants compares this dispatch with branching on the options every call.
+
+	/** Picks the specialized wallrun state update and physics for current options. Called by the setters below, call again if the options are written directly. */
+	void SelectWallRunVariant();
+
+	void SetWallRunInfinite(bool bInfinite);
+	void SetScaleWallRunGravityWithSpeed(bool bScaleWithSpeed);
+	void SetPreventWallRunIfMovingBackwards(bool bPrevent);
+
+	typedef void (UShooterCharacterMovement::*FWallRunStateUpdateFunc)(float);
+	typedef void (UShooterCharacterMovement::*FPhysWallRunningFunc)(float, int32);
+	FWallRunStateUpdateFunc WallRunStateUpdateFunc = nullptr;
+	FPhysWallRunningFunc PhysWallRunningFunc = nullptr;
+
+	/** Wallrun part of UpdateCharacterStateBeforeMovement (detection, start/stop, state, timers) */
+	template<bool bInfinite, bool bPreventMovingBackwards>
+	void UpdateWallRunState(float DeltaSeconds);
+
+	template<bool bScaleGravityWithSpeed>
+	void PhysWallRunningImpl(float deltaTime, int32 Iterations);
+
+	template<bool bScaleGravityWithSpeed>
+	float GetWallRunGravityScaleImpl();
+
+	/** Gravity scale of a wallrun in the given state moving with the given velocity */
+	template<bool bScaleGravityWithSpeed>
+	float CalcWallRunGravityScale(const FVector& InVelocity, EWallRunState InState) const;
+
+	/**
+	 * One step of wallrun physics along the wall without collision: state change at the apex, duration timer and wallrun gravity.
+	 * Shared by PredictWallRunTrajectory and nav link baking (see AWallRunNavLinks), so both follow PhysWallRunning the same way.
+	 */
+	void StepWallRunSimulation(FWallRunSimState& Sim, float BaseGravityZ, float DeltaTime) const;
+	template<bool bScaleGravityWithSpeed>
+	void StepWallRunSimulationImpl(FWallRunSimState& Sim, float BaseGravityZ, float DeltaTime) const;
+
+	/** Velocity after a wall jump with the given velocity and aim, see DoWallRunJump */
+	FVector CalcWallRunJumpVelocity(const FVector& InVelocity, const FVector& AimForward, EWallRunSide Side) const;
+
+	/** Fills Prediction from the current state */
+	template<bool bScaleGravityWithSpeed>
+	void BuildWallRunPrediction(FWallRunTrajectoryPrediction& Prediction, bool bJumpNow);
+
+	/** Cached results of PredictWallRunTrajectory, without and with a jump */
+	FWallRunTrajectoryPrediction WallRunPredictions[2];
+
+	/** [server -> simulated proxies] Wallrun state for PredictWallRunTrajectory, not resent for the duration timer alone */
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedWallRunState)
+	FWallRunProxyState ReplicatedWallRunState;
+
+	UFUNCTION()
+	void OnRep_ReplicatedWallRunState();
+
+	/** [server] Updates ReplicatedWallRunState after a wallrunning move */
+	void UpdateReplicatedWallRunState();
+
+	template<bool bPreventMovingBackwards>
+	bool CanStartWallRunSideImpl(EWallRunSide Side, FVector& OutWallNormal, FVector& OutImpactPoint);
+
+	/** Perform a jump from wall */
+	void DoWallRunJump(bool bReplayingMoves);
+
+
+#pragma endregion
+
+#pragma region Overrides
+protected:
+	virtual void BeginPlay() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	/** Update the character state in PerformMovement right before doing the actual position change */
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds);
+
+	/** Update the character state in PerformMovement after the position change. Some rotation updates happen after this. */
+	virtual void UpdateCharacterStateAfterMovement(float DeltaSeconds);
+
+	virtual void OnComponentDestroyed(bool bDestroyingHierarchy) override;
+public:
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	virtual float GetMaxSpeed() const override;
+	virtual float GetMaxAcceleration() const override;
+	virtual float GetMaxBrakingDeceleration() const override;
+	virtual void ProcessLanded(const FHitResult& Hit, float remainingTime, int32 Iterations) override;
+#pragma endregion
+
+
+
+#pragma region Private Variables
+
+
+
+#pragma endregion
+
+	bool DoJump(bool bReplayingMoves) override;
+
+protected:
+	void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+
+	
+	
+};
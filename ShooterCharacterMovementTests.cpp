@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterCharacterMovement.h"
+#include "ShooterCharacter.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/CollisionProfile.h"
+#include "Components/BoxComponent.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ShooterCharacterMovementTests
+{
+	/** Game world with physics, nothing is ticked */
+	struct FTestWorld
+	{
+		UWorld* World = nullptr;
+
+		FTestWorld()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false);
+			FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+			WorldContext.SetCurrentWorld(World);
+			World->InitializeActorsForPlay(FURL());
+			World->BeginPlay();
+		}
+
+		~FTestWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+	};
+
+	/** Long wall along the X axis blocking everything, its face towards the origin is at Location.Y - 10 */
+	UBoxComponent* SpawnWall(UWorld* World, const FVector& Location)
+	{
+		AActor* WallActor = World->SpawnActor<AActor>();
+		UBoxComponent* Box = NewObject<UBoxComponent>(WallActor);
+		Box->SetBoxExtent(FVector(4000.0f, 10.0f, 1000.0f));
+		Box->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		WallActor->SetRootComponent(Box);
+		Box->RegisterComponent();
+		WallActor->SetActorLocation(Location);
+		return Box;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWallRunDeferredJumpTest, "ShooterGame.WallRun.SubTickInput.DeferredJump",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWallRunDeferredJumpTest::RunTest(const FString& Parameters)
+{
+	using namespace ShooterCharacterMovementTests;
+
+	FTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+	SpawnWall(World, FVector(0.0f, 70.0f, 0.0f));
+
+	AShooterCharacter* Character = World->SpawnActor<AShooterCharacter>(FVector(-2000.0f, 0.0f, 0.0f), FRotator::ZeroRotator);
+	UShooterCharacterMovement* Movement = Character ? Cast<UShooterCharacterMovement>(Character->GetCharacterMovement()) : nullptr;
+	if (!TestNotNull(TEXT("Character with wallrun movement is spawned"), Movement))
+	{
+		return false;
+	}
+	Movement->bUseSubTickWallRunInput = true;
+
+	// Running along the wall on the right, every move below starts from here
+	const FVector StartLocation = Character->GetActorLocation();
+	Movement->Velocity = FVector(Movement->WallRunSpeed, 0.0f, 0.0f);
+	Movement->SetMovementMode(MOVE_Falling);
+	Movement->StartWallRunning(EWallRunSide::Right, FVector(0.0f, -1.0f, 0.0f), FVector(StartLocation.X, 60.0f, StartLocation.Z));
+	if (!TestTrue(TEXT("Character is wallrunning"), Movement->IsWallRunning()))
+	{
+		return false;
+	}
+	const FVector StartVelocity = Movement->Velocity;
+	const FWallRunStateSnapshot StartWallRun = FWallRunStateSnapshot::Capture(*Movement);
+
+	auto RestoreStart = [&]()
+	{
+		Movement->UpdatedComponent->SetWorldLocationAndRotation(StartLocation, FRotator::ZeroRotator, false, nullptr, ETeleportType::TeleportPhysics);
+		Movement->Velocity = StartVelocity;
+		Movement->SetMovementMode(MOVE_Custom, CMOVE_WallRunning);
+		StartWallRun.Restore(*Movement);
+		Character->StopJumping();
+		Character->JumpCurrentCount = 0;
+	};
+
+	constexpr float MoveTime = 0.1f;
+	constexpr uint8 HalfWayOffset = 128;
+
+	// Client presses jump half way through its move. Press and previous move are far apart in time,
+	// so however long the test takes the offset stays at HalfWayOffset.
+	RestoreStart();
+	const double Now = FPlatformTime::Seconds();
+	Movement->LastControlledMoveTime = Now - 100.0;
+	Movement->WallRunJumpInputTime = Now - 49.8;
+	Character->Jump();
+	Movement->ControlledCharacterMove(FVector::ForwardVector, MoveTime);
+	const FVector ClientAcceleration = Movement->GetCurrentAcceleration();
+	const FVector ClientLocation = Movement->UpdatedComponent->GetComponentLocation();
+	TestFalse(TEXT("Client jumped off the wall"), Movement->IsWallRunning());
+
+	// Server gets the same move with the offset, as MoveAutonomous of a received packet
+	auto RunServerMove = [&](uint8 JumpInputOffset)
+	{
+		RestoreStart();
+		FShooterCharacterNetworkMoveData MoveData;
+		MoveData.TimeStamp = MoveTime;
+		MoveData.Acceleration = ClientAcceleration;
+		MoveData.CompressedMoveFlags = FSavedMove_Character::FLAG_JumpPressed;
+		MoveData.WallRunJumpInputOffset = JumpInputOffset;
+		Movement->SetCurrentNetworkMoveData(&MoveData);
+		Movement->MoveAutonomous(MoveData.TimeStamp, MoveTime, MoveData.CompressedMoveFlags, MoveData.Acceleration);
+		Movement->SetCurrentNetworkMoveData(nullptr);
+		return Movement->UpdatedComponent->GetComponentLocation();
+	};
+
+	const FVector ServerLocation = RunServerMove(HalfWayOffset);
+	TestFalse(TEXT("Server jumped off the wall"), Movement->IsWallRunning());
+	TestTrue(TEXT("Client and server end the deferred jump in the same place"), ClientLocation.Equals(ServerLocation, KINDA_SMALL_NUMBER));
+
+	// Otherwise the check above passes just as well with both sides jumping right away
+	const FVector ImmediateJumpLocation = RunServerMove(0);
+	TestFalse(TEXT("Deferred jump ends somewhere else than an immediate one"), ImmediateJumpLocation.Equals(ServerLocation, 1.0f));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,386 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterCombineHarness.h"
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+#include "ShooterCharacterMovement.h"
+#include "ShooterMoveCapture.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+
+
+/** Everything the harness resets a character to before simulating a sequence */
+struct FCombineHarnessState
+{
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	FVector Velocity = FVector::ZeroVector;
+	uint8 MovementMode = 0;
+	uint8 CustomMovementMode = 0;
+	int32 JumpCurrentCount = 0;
+	FWallRunStateSnapshot WallRun;
+	bool bWantsToUnstick = false;
+
+	static FCombineHarnessState Capture(UShooterCharacterMovement& MovementComp)
+	{
+		FCombineHarnessState State;
+		State.Location = MovementComp.UpdatedComponent->GetComponentLocation();
+		State.Rotation = MovementComp.UpdatedComponent->GetComponentRotation();
+		State.Velocity = MovementComp.Velocity;
+		State.MovementMode = MovementComp.MovementMode;
+		State.CustomMovementMode = MovementComp.CustomMovementMode;
+		State.JumpCurrentCount = MovementComp.GetCharacterOwner()->JumpCurrentCount;
+		State.WallRun = FWallRunStateSnapshot::Capture(MovementComp);
+		State.bWantsToUnstick = MovementComp.bWallrunWantsToUnstick;
+		return State;
+	}
+
+	/** State the captured character started from */
+	static FCombineHarnessState FromCaptureStart(const FShooterMoveCapture& Capture)
+	{
+		FCombineHarnessState State;
+		State.Location = Capture.StartLocation;
+		State.Rotation = Capture.StartRotation;
+		State.Velocity = Capture.StartVelocity;
+		State.MovementMode = Capture.StartMovementMode;
+		State.CustomMovementMode = Capture.StartCustomMovementMode;
+		State.JumpCurrentCount = Capture.StartJumpCurrentCount;
+		State.WallRun = Capture.StartWallRun;
+		State.bWantsToUnstick = Capture.bStartWantsToUnstick;
+		return State;
+	}
+
+	void Restore(UShooterCharacterMovement& MovementComp) const
+	{
+		ACharacter* Character = MovementComp.GetCharacterOwner();
+		MovementComp.UpdatedComponent->SetWorldLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+		MovementComp.Velocity = Velocity;
+
+		// Mode change may end a wallrun and reset its timers, the snapshot goes on top
+		MovementComp.SetMovementMode((EMovementMode)MovementMode, CustomMovementMode);
+		WallRun.Restore(MovementComp);
+		MovementComp.bWallrunWantsToUnstick = bWantsToUnstick;
+		MovementComp.bWallRunJumpDeferred = false;
+		MovementComp.ServerWallClaim = EWallRunWallClaim::None;
+		MovementComp.WallRunJumpInputOffset = 0;
+		MovementComp.WallRunUnstickInputOffset = 0;
+
+		Character->StopJumping();
+		Character->JumpCurrentCount = JumpCurrentCount;
+		Character->JumpForceTimeRemaining = 0.0f;
+		Character->JumpKeyHoldTime = 0.0f;
+
+		if (MovementComp.IsMovingOnGround())
+		{
+			MovementComp.FindFloor(Location, MovementComp.CurrentFloor, false);
+		}
+	}
+};
+
+
+/** One client frame of a harness sequence */
+struct FCombineHarnessFrame
+{
+	float DeltaTime = 0.0f;
+	uint8 CompressedFlags = 0;
+	FVector Acceleration = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	bool bWantsToUnstick = false;
+};
+
+struct FCombineHarnessSequence
+{
+	FCombineHarnessState Start;
+	TArray<FCombineHarnessFrame> Frames;
+};
+
+
+static void RunHarnessMove(UShooterCharacterMovement& MovementComp, FShooterCharacterNetworkMoveData& MoveData, float& TimeStamp,
+	float DeltaTime, uint8 CompressedFlags, const FVector& Acceleration, const FRotator& Rotation, bool bWantsToUnstick)
+{
+	TimeStamp += DeltaTime;
+	MoveData.TimeStamp = TimeStamp;
+	MoveData.Acceleration = Acceleration;
+	MoveData.CompressedMoveFlags = CompressedFlags;
+	MoveData.bWantsToUnstick = bWantsToUnstick;
+	MoveData.WallClaim = (uint8)EWallRunWallClaim::None;
+
+	MovementComp.UpdatedComponent->SetWorldRotation(Rotation);
+	MovementComp.MoveAutonomous(TimeStamp, DeltaTime, CompressedFlags, Acceleration);
+}
+
+/** Frame by frame, what a client without move combining would send */
+static FCombineHarnessState SimulateUncombined(UShooterCharacterMovement& MovementComp, const FCombineHarnessSequence& Sequence)
+{
+	FShooterCharacterNetworkMoveData MoveData;
+	MovementComp.SetCurrentNetworkMoveData(&MoveData);
+
+	Sequence.Start.Restore(MovementComp);
+	float TimeStamp = 0.0f;
+	for (const FCombineHarnessFrame& Frame : Sequence.Frames)
+	{
+		RunHarnessMove(MovementComp, MoveData, TimeStamp, Frame.DeltaTime, Frame.CompressedFlags, Frame.Acceleration, Frame.Rotation, Frame.bWantsToUnstick);
+	}
+
+	MovementComp.SetCurrentNetworkMoveData(nullptr);
+	return FCombineHarnessState::Capture(MovementComp);
+}
+
+/**
+ * Same frames, but each one is first offered to the pending move like ReplicateMoveToServer does:
+ * if CanCombineWith agrees, CombineWith rolls the character back and the merged move is simulated over the summed delta.
+ */
+static FCombineHarnessState SimulateCombined(UShooterCharacterMovement& MovementComp, const FCombineHarnessSequence& Sequence,
+	float NetSendInterval, int32& OutNumCombined)
+{
+	ACharacter* Character = MovementComp.GetCharacterOwner();
+	FNetworkPredictionData_Client_ShooterCharacter ClientData(MovementComp);
+
+	FShooterCharacterNetworkMoveData MoveData;
+	MovementComp.SetCurrentNetworkMoveData(&MoveData);
+
+	Sequence.Start.Restore(MovementComp);
+	float TimeStamp = 0.0f;
+	FSavedMovePtr PendingMove;
+	for (const FCombineHarnessFrame& Frame : Sequence.Frames)
+	{
+		// Input of this frame as the client would have it when saving the move
+		MovementComp.UpdatedComponent->SetWorldRotation(Frame.Rotation);
+		MovementComp.UpdateFromCompressedFlags(Frame.CompressedFlags);
+		MovementComp.bWallrunWantsToUnstick = Frame.bWantsToUnstick;
+
+		FSavedMovePtr NewMove = ClientData.CreateSavedMove();
+		NewMove->SetMoveFor(Character, Frame.DeltaTime, Frame.Acceleration, ClientData);
+
+		if (PendingMove.IsValid() && PendingMove->CanCombineWith(NewMove, Character, ClientData.MaxMoveDeltaTime))
+		{
+			NewMove->CombineWith(PendingMove.Get(), Character, nullptr, PendingMove->GetRevertedLocation());
+			OutNumCombined++;
+		}
+
+		const FSavedMove_ShooterCharacter* ShooterMove = static_cast<const FSavedMove_ShooterCharacter*>(NewMove.Get());
+		RunHarnessMove(MovementComp, MoveData, TimeStamp, NewMove->DeltaTime, NewMove->GetCompressedFlags(), NewMove->Acceleration, Frame.Rotation, ShooterMove->bWallrunWantsToUnstick);
+		NewMove->PostUpdate(Character, FSavedMove_Character::PostUpdate_Record);
+
+		// Once a send interval worth of time is collected the move goes out and nothing can be combined into it anymore
+		PendingMove = NewMove->DeltaTime < NetSendInterval ? NewMove : nullptr;
+	}
+	PendingMove = nullptr;
+
+	MovementComp.SetCurrentNetworkMoveData(nullptr);
+	return FCombineHarnessState::Capture(MovementComp);
+}
+
+
+TArray<FShooterCombineHarnessResult> FShooterCombineHarness::Run(UShooterCharacterMovement& MovementComp, const FShooterMoveCapture& Capture, const FShooterCombineHarnessSettings& Settings)
+{
+	TArray<FShooterCombineHarnessResult> Results;
+	// Simulated moves go through MoveAutonomous and would end up in a running capture
+	if (!MovementComp.HasValidData() || Capture.Moves.Num() < 2 || MovementComp.IsCapturingMoves())
+	{
+		return Results;
+	}
+
+	const FCombineHarnessState OriginalState = FCombineHarnessState::Capture(MovementComp);
+	const float OriginalNormalThreshold = MovementComp.WallNormalCombineThreshold;
+	const float OriginalAccelDotCombineThreshold = MovementComp.WallRunAccelDotCombineThreshold;
+	FCharacterNetworkMoveData* OriginalMoveData = MovementComp.GetCurrentNetworkMoveData();
+
+	// Replay the capture once to know the state before every captured move
+	TArray<FCombineHarnessState> CapturedStates;
+	{
+		FShooterCharacterNetworkMoveData MoveData;
+		MovementComp.SetCurrentNetworkMoveData(&MoveData);
+		FCombineHarnessState::FromCaptureStart(Capture).Restore(MovementComp);
+		for (const FShooterCapturedMove& Move : Capture.Moves)
+		{
+			CapturedStates.Add(FCombineHarnessState::Capture(MovementComp));
+			MoveData.TimeStamp = Move.ClientTimeStamp;
+			MoveData.Acceleration = Move.Acceleration;
+			MoveData.CompressedMoveFlags = Move.CompressedFlags;
+			MoveData.bWantsToUnstick = Move.bWantsToUnstick;
+			MoveData.WallClaim = Move.WallClaim;
+			MoveData.WallClaimImpactPoint = Move.WallClaimImpactPoint;
+			MoveData.WallRunJumpInputOffset = Move.WallRunJumpInputOffset;
+			MoveData.WallRunUnstickInputOffset = Move.WallRunUnstickInputOffset;
+			MovementComp.UpdatedComponent->SetWorldRotation(Move.Rotation);
+			MovementComp.MoveAutonomous(Move.ClientTimeStamp, Move.DeltaTime, Move.CompressedFlags, Move.Acceleration);
+		}
+		MovementComp.SetCurrentNetworkMoveData(nullptr);
+	}
+
+	// Wallrunning starts are what we care about, but keep some of the rest for transitions into a wallrun
+	TArray<int32> WallRunStarts;
+	for (int32 i = 0; i < CapturedStates.Num(); i++)
+	{
+		if (CapturedStates[i].WallRun.bIsWallRunning)
+		{
+			WallRunStarts.Add(i);
+		}
+	}
+
+	FRandomStream Random(Settings.Seed);
+	const int32 SequenceLength = FMath::Clamp(Settings.SequenceLength, 1, Capture.Moves.Num());
+	TArray<FCombineHarnessSequence> Sequences;
+	for (int32 SequenceIndex = 0; SequenceIndex < Settings.NumSequences; SequenceIndex++)
+	{
+		int32 StartIndex = WallRunStarts.Num() > 0 && Random.FRand() < 0.75f
+			? WallRunStarts[Random.RandHelper(WallRunStarts.Num())]
+			: Random.RandHelper(Capture.Moves.Num());
+		StartIndex = FMath::Min(StartIndex, Capture.Moves.Num() - SequenceLength);
+
+		FCombineHarnessSequence& Sequence = Sequences.AddDefaulted_GetRef();
+		Sequence.Start = CapturedStates[StartIndex];
+		for (int32 MoveIndex = StartIndex; MoveIndex < StartIndex + SequenceLength; MoveIndex++)
+		{
+			const FShooterCapturedMove& Move = Capture.Moves[MoveIndex];
+
+			// Random split of the captured move into client frames, the jump press stays on the first one
+			const int32 NumFrames = Random.RandRange(1, FMath::Max(1, Settings.MaxFramesPerMove));
+			for (int32 FrameIndex = 0; FrameIndex < NumFrames; FrameIndex++)
+			{
+				FCombineHarnessFrame& Frame = Sequence.Frames.AddDefaulted_GetRef();
+				Frame.DeltaTime = Move.DeltaTime / NumFrames;
+				Frame.CompressedFlags = FrameIndex == 0 ? Move.CompressedFlags : (Move.CompressedFlags & ~FSavedMove_Character::FLAG_JumpPressed);
+				Frame.Acceleration = Move.Acceleration;
+				Frame.Rotation = Move.Rotation;
+				Frame.bWantsToUnstick = Move.bWantsToUnstick;
+			}
+		}
+	}
+
+	// Reference results don't depend on the combine setting
+	TArray<FCombineHarnessState> Uncombined;
+	for (const FCombineHarnessSequence& Sequence : Sequences)
+	{
+		Uncombined.Add(SimulateUncombined(MovementComp, Sequence));
+	}
+
+	for (float NormalThreshold : Settings.NormalThresholds)
+	{
+		for (float AccelDotCombineThreshold : Settings.AccelDotCombineThresholds)
+		{
+			MovementComp.WallNormalCombineThreshold = NormalThreshold;
+			MovementComp.WallRunAccelDotCombineThreshold = AccelDotCombineThreshold;
+
+			FShooterCombineHarnessResult& Result = Results.AddDefaulted_GetRef();
+			Result.NormalThreshold = NormalThreshold;
+			Result.AccelDotCombineThreshold = AccelDotCombineThreshold;
+
+			TArray<float> PositionErrors;
+			for (int32 SequenceIndex = 0; SequenceIndex < Sequences.Num(); SequenceIndex++)
+			{
+				const FCombineHarnessState Combined = SimulateCombined(MovementComp, Sequences[SequenceIndex], Settings.NetSendInterval, Result.NumCombinedFrames);
+				const FCombineHarnessState& Reference = Uncombined[SequenceIndex];
+				Result.NumFrames += Sequences[SequenceIndex].Frames.Num();
+
+				PositionErrors.Add(FVector::Dist(Combined.Location, Reference.Location));
+				Result.MaxVelocityError = FMath::Max(Result.MaxVelocityError, FVector::Dist(Combined.Velocity, Reference.Velocity));
+
+				float Delta = 0.0f;
+				const EWallRunSnapshotField Field = Combined.WallRun.FindFirstDivergence(Reference.WallRun, Delta);
+				if (Field != EWallRunSnapshotField::None || Combined.MovementMode != Reference.MovementMode)
+				{
+					Result.NumStateMismatches++;
+					Result.StateMismatchCounts[(int32)Field]++;
+				}
+			}
+
+			PositionErrors.Sort();
+			if (PositionErrors.Num() > 0)
+			{
+				Result.MaxPositionError = PositionErrors.Last();
+				Result.P95PositionError = PositionErrors[FMath::Min(PositionErrors.Num() - 1, FMath::FloorToInt(0.95f * PositionErrors.Num()))];
+			}
+		}
+	}
+
+	MovementComp.WallNormalCombineThreshold = OriginalNormalThreshold;
+	MovementComp.WallRunAccelDotCombineThreshold = OriginalAccelDotCombineThreshold;
+	MovementComp.SetCurrentNetworkMoveData(OriginalMoveData);
+	OriginalState.Restore(MovementComp);
+	return Results;
+}
+
+
+static void RunCombineHarness(const TArray<FString>& Args, UWorld* World)
+{
+	if (Args.Num() < 1)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.CombineHarness - Usage: WallRun.CombineHarness <CaptureFile> [NumSequences] [SequenceLength] [MaxPositionError] [Seed]"));
+		return;
+	}
+
+	FShooterMoveCapture Capture;
+	if (!Capture.LoadFromFile(Args[0]))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.CombineHarness - Failed to load %s"), *Args[0]);
+		return;
+	}
+
+	FShooterCombineHarnessSettings Settings;
+	Settings.NumSequences = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : Settings.NumSequences;
+	Settings.SequenceLength = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : Settings.SequenceLength;
+	Settings.MaxPositionError = Args.Num() > 3 ? FCString::Atof(*Args[3]) : Settings.MaxPositionError;
+	Settings.Seed = Args.Num() > 4 ? FCString::Atoi(*Args[4]) : Settings.Seed;
+
+	UShooterCharacterMovement* MovementComp = nullptr;
+	for (TObjectIterator<UShooterCharacterMovement> It; It; ++It)
+	{
+		if (It->GetWorld() == World && It->GetCharacterOwner() && It->GetOwnerRole() == ROLE_Authority && !It->IsTemplate() && !It->IsCapturingMoves())
+		{
+			MovementComp = *It;
+			break;
+		}
+	}
+	if (MovementComp == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.CombineHarness - No server side character to simulate with"));
+		return;
+	}
+
+	const TArray<FShooterCombineHarnessResult> Results = FShooterCombineHarness::Run(*MovementComp, Capture, Settings);
+
+	const FShooterCombineHarnessResult* Best = nullptr;
+	UE_LOG(LogTemp, Log, TEXT("WallRun.CombineHarness - %d sequences of %d captured moves, position error bound %.2f cm"), Settings.NumSequences, Settings.SequenceLength, Settings.MaxPositionError);
+	for (const FShooterCombineHarnessResult& Result : Results)
+	{
+		const bool bSafe = Result.MaxPositionError <= Settings.MaxPositionError && Result.NumStateMismatches == 0;
+		UE_LOG(LogTemp, Log, TEXT("  NormalThreshold %.4f AccelDotCombineThreshold %.3f: combined %5.1f%% of %d frames, position error max %.3f p95 %.3f cm, velocity error max %.2f, state mismatches %d %s"),
+			Result.NormalThreshold, Result.AccelDotCombineThreshold, Result.GetCombineRatio() * 100.0f, Result.NumFrames, Result.MaxPositionError, Result.P95PositionError,
+			Result.MaxVelocityError, Result.NumStateMismatches, bSafe ? TEXT("") : TEXT("[over bound]"));
+
+		for (int32 i = 0; i < (int32)EWallRunSnapshotField::Num; i++)
+		{
+			if (Result.StateMismatchCounts[i] > 0)
+			{
+				UE_LOG(LogTemp, Log, TEXT("    first diverged %s: %u"), FWallRunStateSnapshot::GetFieldName((EWallRunSnapshotField)i), Result.StateMismatchCounts[i]);
+			}
+		}
+
+		if (bSafe && (Best == nullptr || Result.GetCombineRatio() > Best->GetCombineRatio()))
+		{
+			Best = &Result;
+		}
+	}
+
+	if (Best)
+	{
+		UE_LOG(LogTemp, Log, TEXT("WallRun.CombineHarness - Highest combine ratio within bound: WallNormalCombineThreshold %.4f, WallRunAccelDotCombineThreshold %.3f (%.1f%%)"),
+			Best->NormalThreshold, Best->AccelDotCombineThreshold, Best->GetCombineRatio() * 100.0f);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.CombineHarness - No threshold combination keeps the error within bound"));
+	}
+}
+
+static FAutoConsoleCommand CmdWallRunCombineHarness(TEXT("WallRun.CombineHarness"),
+	TEXT("[server] Simulates random move sequences from a move capture with and without move combining and reports the error per WallNormalCombineThreshold and WallRunAccelDotCombineThreshold. ")
+	TEXT("Usage: WallRun.CombineHarness <CaptureFile> [NumSequences] [SequenceLength] [MaxPositionError] [Seed]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunCombineHarness));
+
+#endif
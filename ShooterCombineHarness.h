@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterMovementReplication.h"
+
+class UShooterCharacterMovement;
+struct FShooterMoveCapture;
+
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+/** Settings of a combine equivalence run, see FShooterCombineHarness */
+struct FShooterCombineHarnessSettings
+{
+	int32 NumSequences = 200;
+	int32 SequenceLength = 30;
+	int32 Seed = 0;
+
+	/** Captured moves are split into up to this many client frames, like a client running at a higher frame rate */
+	int32 MaxFramesPerMove = 3;
+
+	/** Pending move is sent once it covers this much time, only moves within one send interval can be combined */
+	float NetSendInterval = 1.0f / 30.0f;
+
+	/** Final position error (in cm) a combine setting may cause */
+	float MaxPositionError = 1.0f;
+
+	/** UShooterCharacterMovement::WallNormalCombineThreshold values to try */
+	TArray<float> NormalThresholds = { 0.001f, 0.005f, 0.01f, 0.02f, 0.05f, 0.1f };
+
+	/** UShooterCharacterMovement::WallRunAccelDotCombineThreshold values to try, every combination with NormalThresholds is run */
+	TArray<float> AccelDotCombineThresholds = { 0.9f, 0.95f, 0.98f, 0.996f };
+};
+
+
+/** Error of the combined simulation against the uncombined one for a single combine setting */
+struct FShooterCombineHarnessResult
+{
+	float NormalThreshold = 0.0f;
+	float AccelDotCombineThreshold = 0.0f;
+
+	int32 NumFrames = 0;
+	int32 NumCombinedFrames = 0;
+
+	float MaxPositionError = 0.0f;
+	float P95PositionError = 0.0f;
+	float MaxVelocityError = 0.0f;
+
+	/** Sequences which ended in a different wallrun state (see FWallRunStateSnapshot) */
+	int32 NumStateMismatches = 0;
+	uint32 StateMismatchCounts[(int32)EWallRunSnapshotField::Num] = {};
+
+	float GetCombineRatio() const { return NumFrames > 0 ? (float)NumCombinedFrames / NumFrames : 0.0f; }
+};
+
+
+/**
+ * Property test of FSavedMove_ShooterCharacter::CanCombineWith/CombineWith: combining moves has to land in the same place
+ * as simulating them one by one. Random move sequences are cut out of a move capture (WallRun.Capture.*), split into client
+ * frames of random length and simulated on a server side character twice, once frame by frame and once combined the way
+ * the client combines pending moves. Runs in place on the given character and puts it back where it was afterwards.
+ */
+class FShooterCombineHarness
+{
+public:
+	static TArray<FShooterCombineHarnessResult> Run(UShooterCharacterMovement& MovementComp, const FShooterMoveCapture& Capture, const FShooterCombineHarnessSettings& Settings);
+};
+
+#endif
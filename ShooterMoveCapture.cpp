@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterMoveCapture.h"
+#include "ShooterCharacterMovement.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+
+
+// Bump when the layout changes, old captures are rejected
+static const uint32 ShooterMoveCaptureMagic = 0x434D5257; // "WRMC"
+static const uint32 ShooterMoveCaptureVersion = 3;
+
+
+FArchive& operator<<(FArchive& Ar, FShooterCapturedMove& Move)
+{
+	Ar << Move.ClientTimeStamp;
+	Ar << Move.DeltaTime;
+	Ar << Move.CompressedFlags;
+	Ar << Move.Acceleration;
+	Ar << Move.Rotation;
+	Ar << Move.bWantsToUnstick;
+	Ar << Move.WallClaim;
+	Ar << Move.WallClaimImpactPoint;
+	Ar << Move.WallRunJumpInputOffset;
+	Ar << Move.WallRunUnstickInputOffset;
+	return Ar;
+}
+
+void FShooterMoveCapture::Serialize(FArchive& Ar)
+{
+	Ar << MapName;
+	Ar << StartLocation;
+	Ar << StartRotation;
+	Ar << StartVelocity;
+	Ar << StartMovementMode;
+	Ar << StartCustomMovementMode;
+	Ar << StartJumpCurrentCount;
+	StartWallRun.Serialize(Ar);
+	Ar << bStartWantsToUnstick;
+	Ar << Moves;
+	Ar << FinalStateHash;
+}
+
+bool FShooterMoveCapture::SaveToFile(const FString& Filename)
+{
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Writer)
+	{
+		return false;
+	}
+
+	uint32 Magic = ShooterMoveCaptureMagic;
+	uint32 Version = ShooterMoveCaptureVersion;
+	*Writer << Magic;
+	*Writer << Version;
+	Serialize(*Writer);
+	return Writer->Close();
+}
+
+bool FShooterMoveCapture::LoadFromFile(const FString& Filename)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Reader)
+	{
+		return false;
+	}
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Reader << Magic;
+	*Reader << Version;
+	if (Magic != ShooterMoveCaptureMagic || Version != ShooterMoveCaptureVersion)
+	{
+		return false;
+	}
+
+	Serialize(*Reader);
+	return !Reader->IsError();
+}
+
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+/** Server side movement components of wallrunning characters in given world */
+static TArray<UShooterCharacterMovement*> GetAuthorityMovementComponents(UWorld* World, bool bExcludeCapturing = false)
+{
+	TArray<UShooterCharacterMovement*> Result;
+	for (TObjectIterator<UShooterCharacterMovement> It; It; ++It)
+	{
+		if (It->GetWorld() == World && It->GetPawnOwner() && It->GetOwnerRole() == ROLE_Authority && !It->IsTemplate()
+			&& !(bExcludeCapturing && It->IsCapturingMoves()))
+		{
+			Result.Add(*It);
+		}
+	}
+	return Result;
+}
+
+static void StartMoveCaptures(const TArray<FString>& Args, UWorld* World)
+{
+	for (UShooterCharacterMovement* MovementComp : GetAuthorityMovementComponents(World))
+	{
+		MovementComp->StartMoveCapture();
+		UE_LOG(LogTemp, Log, TEXT("WallRun.Capture.Start - capturing moves of %s"), *MovementComp->GetPawnOwner()->GetName());
+	}
+}
+
+static void StopMoveCaptures(const TArray<FString>& Args, UWorld* World)
+{
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("MoveCaptures");
+	const FString Timestamp = FDateTime::Now().ToString();
+
+	for (UShooterCharacterMovement* MovementComp : GetAuthorityMovementComponents(World))
+	{
+		TSharedPtr<FShooterMoveCapture> Capture = MovementComp->StopMoveCapture();
+		if (!Capture.IsValid())
+		{
+			continue;
+		}
+
+		const FString Filename = Directory / FString::Printf(TEXT("%s_%s_%s.wrmoves"), *Capture->MapName, *MovementComp->GetPawnOwner()->GetName(), *Timestamp);
+		const bool bSaved = Capture->SaveToFile(Filename);
+		UE_LOG(LogTemp, Log, TEXT("WallRun.Capture.Stop - %d moves of %s %s %s"),
+			Capture->Moves.Num(), *MovementComp->GetPawnOwner()->GetName(), bSaved ? TEXT("saved to") : TEXT("FAILED to save to"), *Filename);
+	}
+}
+
+static void ReplayMoveCaptureFile(const TArray<FString>& Args, UWorld* World)
+{
+	if (Args.Num() < 1)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.Capture.Replay - Usage: WallRun.Capture.Replay <File> [NumRuns]"));
+		return;
+	}
+
+	FShooterMoveCapture Capture;
+	if (!Capture.LoadFromFile(Args[0]))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.Capture.Replay - Failed to load %s"), *Args[0]);
+		return;
+	}
+
+	// Any server side character which is not being captured will do, its state is reset to the captured start state before each run
+	TArray<UShooterCharacterMovement*> MovementComps = GetAuthorityMovementComponents(World, true);
+	if (MovementComps.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.Capture.Replay - No server side character to replay the moves with (characters being captured can't replay)"));
+		return;
+	}
+
+	if (Capture.MapName != World->GetMapName())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.Capture.Replay - Captured on %s, replaying on %s, state hashes won't match"), *Capture.MapName, *World->GetMapName());
+	}
+
+	const int32 NumRuns = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1;
+	for (int32 Run = 0; Run < NumRuns; Run++)
+	{
+		const FShooterMoveReplayResult Result = MovementComps[0]->ReplayMoveCapture(Capture);
+		UE_LOG(LogTemp, Log, TEXT("WallRun.Capture.Replay - run %d: %d moves in %.3f ms (%.2f us/move), %d rays cast, state hash %08x (%s)"),
+			Run, Result.NumMoves, Result.CpuTime * 1000.0, Result.NumMoves > 0 ? Result.CpuTime * 1000000.0 / Result.NumMoves : 0.0,
+			Result.NumRaysCast, Result.FinalStateHash, Result.bMatchesCapture ? TEXT("matches capture") : TEXT("DIVERGED from capture"));
+	}
+}
+
+static FAutoConsoleCommand CmdWallRunCaptureStart(TEXT("WallRun.Capture.Start"),
+	TEXT("[server] Starts recording client moves of all wallrunning characters"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartMoveCaptures));
+
+static FAutoConsoleCommand CmdWallRunCaptureStop(TEXT("WallRun.Capture.Stop"),
+	TEXT("[server] Stops recording client moves and saves one capture per character to Saved/MoveCaptures"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StopMoveCaptures));
+
+static FAutoConsoleCommand CmdWallRunCaptureReplay(TEXT("WallRun.Capture.Replay"),
+	TEXT("[server] Replays a move capture through MoveAutonomous and reports CPU time, rays cast and whether the final state matches. Usage: WallRun.Capture.Replay <File> [NumRuns]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReplayMoveCaptureFile));
+#endif
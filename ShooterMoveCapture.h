@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterMovementReplication.h"
+
+
+/** One client move as it reached the server (MoveAutonomous arguments and our custom move data) */
+struct FShooterCapturedMove
+{
+	float ClientTimeStamp = 0.0f;
+	float DeltaTime = 0.0f;
+	uint8 CompressedFlags = 0;
+	FVector Acceleration = FVector::ZeroVector;
+
+	/** Rotation the server applied from the client control rotation before the move */
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	bool bWantsToUnstick = false;
+	uint8 WallClaim = 0;
+	FVector WallClaimImpactPoint = FVector::ZeroVector;
+	uint8 WallRunJumpInputOffset = 0;
+	uint8 WallRunUnstickInputOffset = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FShooterCapturedMove& Move);
+};
+
+
+/**
+ * Stream of client moves of a single character recorded on the server, with the state it started from.
+ * Replaying it through UShooterCharacterMovement::ReplayMoveCapture on the same map gives a repeatable
+ * performance benchmark and a determinism check (final state hash has to match the recorded one).
+ */
+struct SHOOTERGAME_API FShooterMoveCapture
+{
+	FString MapName;
+
+	FVector StartLocation = FVector::ZeroVector;
+	FRotator StartRotation = FRotator::ZeroRotator;
+	FVector StartVelocity = FVector::ZeroVector;
+	uint8 StartMovementMode = 0;
+	uint8 StartCustomMovementMode = 0;
+	int32 StartJumpCurrentCount = 0;
+
+	/** Wallrun state (timers, surface, ...) and unstick input the character started from */
+	FWallRunStateSnapshot StartWallRun;
+	bool bStartWantsToUnstick = false;
+
+	TArray<FShooterCapturedMove> Moves;
+
+	/** UShooterCharacterMovement::GetMovementStateHash() on the server when the capture was stopped */
+	uint32 FinalStateHash = 0;
+
+	void Serialize(FArchive& Ar);
+
+	bool SaveToFile(const FString& Filename);
+	bool LoadFromFile(const FString& Filename);
+};
+
+
+/** Outcome of replaying a capture */
+struct FShooterMoveReplayResult
+{
+	int32 NumMoves = 0;
+	double CpuTime = 0.0;
+
+	/** Wall detection rays cast during the replay */
+	int32 NumRaysCast = 0;
+
+	uint32 FinalStateHash = 0;
+	bool bMatchesCapture = false;
+};
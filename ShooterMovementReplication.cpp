@@ -1,220 +1,671 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-
-#include "ShooterMovementReplication.h"
-#include "ShooterCharacterMovement.h"
-#include <GameFramework/Character.h>
-#include "ShooterCharacter.h"
-
-
-void FSavedMove_ShooterCharacter::Clear()
-{
-	Super::Clear();
-
-	// Clear all values
-	bWallrunWantsToUnstick = 0;
-	WantsToUnstickTimeRemaining = 0.0f;
-	WallRunSide = EWallRunSide::Left;
-	WallRunWallNormal = FVector::ZeroVector;
-	CurrentWallRunEndGravity = 1.0f;
-	WallRunState = EWallRunState::End;
-
-	WallRunTimeRemaining = 0.0f;
-	WallRunCooldownLeftTimeRemaining = 0.0f;
-	WallRunCooldownRightTimeRemaining = 0.0f;
-}
-
-uint8 FSavedMove_ShooterCharacter::GetCompressedFlags() const
-{
-	uint8 Result = Super::GetCompressedFlags();
-	/* 
-	FLAG_Custom_0		= 0x10, // Unused
-	FLAG_Custom_1		= 0x20, // Unused
-	FLAG_Custom_2		= 0x40, // Unused
-	FLAG_Custom_3		= 0x80, // Unused
-	*/
-	
-	return Result;
-}
-
-bool FSavedMove_ShooterCharacter::CanCombineWith(const FSavedMovePtr& NewMovePtr, ACharacter* Character, float MaxDelta) const
-{
-	const FSavedMove_ShooterCharacter* NewMove = static_cast<const FSavedMove_ShooterCharacter*>(NewMovePtr.Get());
-
-	AShooterCharacter* ShooterCharacter = Cast<AShooterCharacter>(Character);
-
-	// As an optimization, check if the engine can combine saved moves.
-	if (bWallrunWantsToUnstick != NewMove->bWallrunWantsToUnstick)
-	{
-		return false;
-	}
-
-	// TIMERS
-	// Don't combine on changes to/from zero WantsToUnstickTime.
-	if ((WantsToUnstickTimeRemaining == 0.f) != (NewMove->WantsToUnstickTimeRemaining == 0.f))
-	{
-		return false;
-	}
-
-	if ((WallRunTimeRemaining == 0.f) != (NewMove->WallRunTimeRemaining == 0.f))
-	{
-		return false;
-	}
-
-	if ((WallRunCooldownLeftTimeRemaining == 0.f) != (NewMove->WallRunCooldownLeftTimeRemaining == 0.f))
-	{
-		return false;
-	}
-
-	if ((WallRunCooldownRightTimeRemaining == 0.f) != (NewMove->WallRunCooldownRightTimeRemaining == 0.f))
-	{
-		return false;
-	}
-
-	if (WallRunSide != NewMove->WallRunSide) {
-		return false;
-	}
-
-	if (WallRunState != NewMove->WallRunState) {
-		return false;
-	}
-
-
-	if (!WallRunWallNormal.Equals(NewMove->WallRunWallNormal, WallNormalThresholdCombine))
-	{
-		return false;
-	}
-
-	if (ShooterCharacter == nullptr) {
-		UE_LOG(LogTemp, Warning, TEXT("FSavedMove_ShooterCharacter::CanCombineWith - Failed to get ShooterCharacter, Saved move combination is disabled."));
-		return false;
-	}
-
-	UShooterCharacterMovement* MovementComp = Cast<UShooterCharacterMovement>(ShooterCharacter->GetMovementComponent());
-	if (MovementComp == nullptr) {
-		UE_LOG(LogTemp, Warning, TEXT("FSavedMove_ShooterCharacter::CanCombineWith - Failed to get ShooterCharacterMovement, Saved move combination is disabled."));
-		return false;
-	}
-
-	if ((CurrentWallRunEndGravity == MovementComp->WallRunGravityEndState) != (NewMove->WallRunCooldownRightTimeRemaining == MovementComp->WallRunGravityEndState))
-	{
-		return false;
-	}
-	
-	return Super::CanCombineWith(NewMovePtr, Character, MaxDelta);
-}
-
-void FSavedMove_ShooterCharacter::CombineWith(const FSavedMove_Character* OldMove, ACharacter* InCharacter, APlayerController* PC, const FVector& OldStartLocation)
-{
-	const FSavedMove_ShooterCharacter* OldMoveShooter = static_cast<const FSavedMove_ShooterCharacter*>(OldMove);
-
-	UShooterCharacterMovement* charMov = static_cast<UShooterCharacterMovement*>(InCharacter->GetCharacterMovement());
-	if (charMov)
-	{
-		// Roll back timers. SetMoveFor() will copy them to the saved move. We miss a tick, but delta will be greater
-		charMov->WantsToUnstickTimeRemaining = OldMoveShooter->WantsToUnstickTimeRemaining;
-		charMov->WallRunTimeRemaining = OldMoveShooter->WallRunTimeRemaining;
-		charMov->WallRunCooldownLeftTimeRemaining = OldMoveShooter->WallRunCooldownLeftTimeRemaining;
-		charMov->WallRunCooldownRightTimeRemaining = OldMoveShooter->WallRunCooldownRightTimeRemaining;
-
-
-		// Normals are close enough, but we get the average of them anyway
-		charMov->WallRunWallNormal = ((WallRunWallNormal + OldMoveShooter->WallRunWallNormal) / 2.0f).GetSafeNormal();
-	}
-
-	Super::CombineWith(OldMoveShooter, InCharacter, PC, OldStartLocation);
-}
-
-void FSavedMove_ShooterCharacter::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData)
-{
-	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
-
-	UShooterCharacterMovement* charMov = static_cast<UShooterCharacterMovement*>(Character->GetCharacterMovement());
-	if (charMov)
-	{
-		// Copy values into the saved move
-
-		// Wallrunning
-		bWallrunWantsToUnstick = charMov->bWallrunWantsToUnstick;
-		WallRunTimeRemaining = charMov->WallRunTimeRemaining;
-		WallRunCooldownLeftTimeRemaining = charMov->WallRunCooldownLeftTimeRemaining;
-		WallRunCooldownRightTimeRemaining = charMov->WallRunCooldownRightTimeRemaining;
-		WantsToUnstickTimeRemaining = charMov->WantsToUnstickTimeRemaining;
-		WallRunSide = charMov->WallRunSide;
-		WallRunWallNormal = charMov->WallRunWallNormal;
-		CurrentWallRunEndGravity = charMov->CurrentWallRunEndGravity;
-		WallRunState = charMov->WallRunState;
-	}
-}
-
-void FSavedMove_ShooterCharacter::PrepMoveFor(class ACharacter* Character)
-{
-	Super::PrepMoveFor(Character);
-
-	UShooterCharacterMovement* charMov = Cast<UShooterCharacterMovement>(Character->GetCharacterMovement());
-	if (charMov)
-	{
-		// Copy values out of the saved move
-
-		// Wallrunning
-		charMov->bWallrunWantsToUnstick = bWallrunWantsToUnstick;
-		charMov->WantsToUnstickTimeRemaining = WantsToUnstickTimeRemaining;
-		charMov->WallRunTimeRemaining = WallRunTimeRemaining;
-		charMov->WallRunCooldownLeftTimeRemaining = WallRunCooldownLeftTimeRemaining;
-		charMov->WallRunCooldownRightTimeRemaining = WallRunCooldownRightTimeRemaining;
-		charMov->WallRunSide = WallRunSide;
-		charMov->WallRunWallNormal = WallRunWallNormal;
-		charMov->CurrentWallRunEndGravity = CurrentWallRunEndGravity;
-		charMov->WallRunState = WallRunState;
-
-	}
-}
-
-bool FSavedMove_ShooterCharacter::IsImportantMove(const FSavedMovePtr& LastAckedMove) const
-{
-	const FSavedMove_ShooterCharacter* NewMove = static_cast<const FSavedMove_ShooterCharacter*>(LastAckedMove.Get());
-
-	if (bWallrunWantsToUnstick != NewMove->bWallrunWantsToUnstick)
-	{
-		return true;
-	}
-
-	return Super::IsImportantMove(LastAckedMove);
-}
-
-FNetworkPredictionData_Client_ShooterCharacter::FNetworkPredictionData_Client_ShooterCharacter(const UCharacterMovementComponent& ClientMovement)
-	: Super(ClientMovement)
-{
-
-}
-
-FSavedMovePtr FNetworkPredictionData_Client_ShooterCharacter::AllocateNewMove()
-{
-	return FSavedMovePtr(new FSavedMove_ShooterCharacter());
-}
-
-bool FShooterCharacterNetworkMoveData::Serialize(
-	UCharacterMovementComponent& CharacterMovement, FArchive& Ar,
-	UPackageMap* PackageMap, ENetworkMoveType MoveType)
-{
-	bool bSuperSuccess = Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
-	SerializeOptionalValue<bool>(Ar.IsSaving(), Ar, bWantsToUnstick, false);
-
-	return bSuperSuccess && !Ar.IsError();
-}
-
-void FShooterCharacterNetworkMoveData::ClientFillNetworkMoveData(
-	const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType)
-{
-	Super::ClientFillNetworkMoveData(ClientMove, MoveType);
-	const FSavedMove_ShooterCharacter& Move = static_cast<const FSavedMove_ShooterCharacter&>(ClientMove);
-
-	bWantsToUnstick = Move.bWallrunWantsToUnstick;
-}
-
-FShooterCharacterNetworkMoveDataContainer::FShooterCharacterNetworkMoveDataContainer() : Super()
-{
-	NewMoveData = &BFDefaultMoveData[0];
-	PendingMoveData = &BFDefaultMoveData[1];
-	OldMoveData = &BFDefaultMoveData[2];
-}
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterMovementReplication.h"
+#include "ShooterCharacterMovement.h"
+#include <GameFramework/Character.h>
+#include "ShooterCharacter.h"
+#include "HAL/IConsoleManager.h"
+
+
+int32 CVar_WallRun_CorrectionAttribution = 0;
+static FAutoConsoleVariableRef CVarWallRunCorrectionAttribution(TEXT("WallRun.CorrectionAttribution"), CVar_WallRun_CorrectionAttribution,
+	TEXT("Server sends its wallrun state with every correction and the client reports which field diverged first (WallRun.CorrectionReport). Has to be enabled on both sides, costs bandwidth."), ECVF_Default);
+
+
+void FSavedMove_ShooterCharacter::Clear()
+{
+	Super::Clear();
+
+	// Clear all values
+	bWallrunWantsToUnstick = 0;
+	WantsToUnstickTimeRemaining = 0.0f;
+	WallRunSide = EWallRunSide::Left;
+	WallRunWallNormal = FVector::ZeroVector;
+	CurrentWallRunEndGravity = 1.0f;
+	WallRunState = EWallRunState::End;
+	WallRunSurface = FWallRunSurfaceParams();
+
+	WallRunTimeRemaining = 0.0f;
+	WallRunCooldownLeftTimeRemaining = 0.0f;
+	WallRunCooldownRightTimeRemaining = 0.0f;
+	WallRunTimerTickRemainder = 0.0f;
+
+	bWallRunningAtStart = false;
+	WallRunJumpInputOffset = 0;
+	WallRunUnstickInputOffset = 0;
+	bWallRunTransition = false;
+	bWallRunSteady = false;
+	WallClaim = EWallRunWallClaim::None;
+	WallClaimImpactPoint = FVector::ZeroVector;
+	bHasEndWallRunSnapshot = false;
+	AccelDotThreshold = DefaultAccelDotThreshold;
+	AccelDotThresholdCombine = DefaultAccelDotThresholdCombine;
+}
+
+uint8 FSavedMove_ShooterCharacter::GetCompressedFlags() const
+{
+	uint8 Result = Super::GetCompressedFlags();
+	/* 
+	FLAG_Custom_0		= 0x10, // Unused
+	FLAG_Custom_1		= 0x20, // Unused
+	FLAG_Custom_2		= 0x40, // Unused
+	FLAG_Custom_3		= 0x80, // Unused
+	*/
+	
+	return Result;
+}
+
+bool FSavedMove_ShooterCharacter::CanCombineWith(const FSavedMovePtr& NewMovePtr, ACharacter* Character, float MaxDelta) const
+{
+	const FSavedMove_ShooterCharacter* NewMove = static_cast<const FSavedMove_ShooterCharacter*>(NewMovePtr.Get());
+
+	AShooterCharacter* ShooterCharacter = Cast<AShooterCharacter>(Character);
+
+	// As an optimization, check if the engine can combine saved moves.
+	if (bWallrunWantsToUnstick != NewMove->bWallrunWantsToUnstick)
+	{
+		return false;
+	}
+
+	// Keep wallrun transitions in their own move so they are marked important and sent promptly
+	if (bWallRunTransition)
+	{
+		return false;
+	}
+
+	// TIMERS
+	// Don't combine on changes to/from zero WantsToUnstickTime.
+	if ((WantsToUnstickTimeRemaining == 0.f) != (NewMove->WantsToUnstickTimeRemaining == 0.f))
+	{
+		return false;
+	}
+
+	if ((WallRunTimeRemaining == 0.f) != (NewMove->WallRunTimeRemaining == 0.f))
+	{
+		return false;
+	}
+
+	if ((WallRunCooldownLeftTimeRemaining == 0.f) != (NewMove->WallRunCooldownLeftTimeRemaining == 0.f))
+	{
+		return false;
+	}
+
+	if ((WallRunCooldownRightTimeRemaining == 0.f) != (NewMove->WallRunCooldownRightTimeRemaining == 0.f))
+	{
+		return false;
+	}
+
+	if (WallRunSide != NewMove->WallRunSide) {
+		return false;
+	}
+
+	if (WallRunState != NewMove->WallRunState) {
+		return false;
+	}
+
+
+	if (!WallRunWallNormal.Equals(NewMove->WallRunWallNormal, WallNormalThresholdCombine))
+	{
+		return false;
+	}
+
+	if (ShooterCharacter == nullptr) {
+		UE_LOG(LogTemp, Warning, TEXT("FSavedMove_ShooterCharacter::CanCombineWith - Failed to get ShooterCharacter, Saved move combination is disabled."));
+		return false;
+	}
+
+	UShooterCharacterMovement* MovementComp = Cast<UShooterCharacterMovement>(ShooterCharacter->GetMovementComponent());
+	if (MovementComp == nullptr) {
+		UE_LOG(LogTemp, Warning, TEXT("FSavedMove_ShooterCharacter::CanCombineWith - Failed to get ShooterCharacterMovement, Saved move combination is disabled."));
+		return false;
+	}
+
+	if ((CurrentWallRunEndGravity == MovementComp->WallRunGravityEndState) != (NewMove->CurrentWallRunEndGravity == MovementComp->WallRunGravityEndState))
+	{
+		return false;
+	}
+	
+	return Super::CanCombineWith(NewMovePtr, Character, MaxDelta);
+}
+
+void FSavedMove_ShooterCharacter::CombineWith(const FSavedMove_Character* OldMove, ACharacter* InCharacter, APlayerController* PC, const FVector& OldStartLocation)
+{
+	const FSavedMove_ShooterCharacter* OldMoveShooter = static_cast<const FSavedMove_ShooterCharacter*>(OldMove);
+
+	UShooterCharacterMovement* charMov = static_cast<UShooterCharacterMovement*>(InCharacter->GetCharacterMovement());
+	if (charMov)
+	{
+		// Roll back timers. SetMoveFor() will copy them to the saved move. We miss a tick, but delta will be greater
+		charMov->WantsToUnstickTimeRemaining = OldMoveShooter->WantsToUnstickTimeRemaining;
+		charMov->WallRunTimeRemaining = OldMoveShooter->WallRunTimeRemaining;
+		charMov->WallRunCooldownLeftTimeRemaining = OldMoveShooter->WallRunCooldownLeftTimeRemaining;
+		charMov->WallRunCooldownRightTimeRemaining = OldMoveShooter->WallRunCooldownRightTimeRemaining;
+		charMov->WallRunTimerTickRemainder = OldMoveShooter->WallRunTimerTickRemainder;
+
+		// Offsets are relative to the combined move now, a press of the new move lands after the whole old move
+		const float CombinedDeltaTime = OldMoveShooter->DeltaTime + DeltaTime;
+		auto RebaseInputOffset = [&](uint8 OldOffset, uint8 NewOffset) -> uint8
+		{
+			if (OldOffset > 0)
+			{
+				return (uint8)FMath::Clamp(FMath::FloorToInt(OldOffset * OldMoveShooter->DeltaTime / CombinedDeltaTime), 1, 255);
+			}
+			if (NewOffset > 0)
+			{
+				return (uint8)FMath::Clamp(FMath::FloorToInt((OldMoveShooter->DeltaTime * 256.0f + NewOffset * DeltaTime) / CombinedDeltaTime), 1, 255);
+			}
+			return 0;
+		};
+		WallRunJumpInputOffset = RebaseInputOffset(OldMoveShooter->WallRunJumpInputOffset, WallRunJumpInputOffset);
+		WallRunUnstickInputOffset = RebaseInputOffset(OldMoveShooter->WallRunUnstickInputOffset, WallRunUnstickInputOffset);
+		charMov->WallRunJumpInputOffset = WallRunJumpInputOffset;
+		charMov->WallRunUnstickInputOffset = WallRunUnstickInputOffset;
+
+		// Normals are close enough, but we get the average of them anyway
+		charMov->WallRunWallNormal = ((WallRunWallNormal + OldMoveShooter->WallRunWallNormal) / 2.0f).GetSafeNormal();
+
+		if (charMov->IsWallRunning())
+		{
+			charMov->NumWallRunCombinedMoves++;
+		}
+		WALLRUN_INC_COUNTER(CombinedMoves, 1);
+	}
+
+	Super::CombineWith(OldMoveShooter, InCharacter, PC, OldStartLocation);
+}
+
+void FSavedMove_ShooterCharacter::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	UShooterCharacterMovement* charMov = static_cast<UShooterCharacterMovement*>(Character->GetCharacterMovement());
+	if (charMov)
+	{
+		// Copy values into the saved move
+
+		WallNormalThresholdCombine = charMov->WallNormalCombineThreshold;
+
+		// Wallrunning
+		bWallrunWantsToUnstick = charMov->bWallrunWantsToUnstick;
+		WallRunJumpInputOffset = charMov->WallRunJumpInputOffset;
+		WallRunUnstickInputOffset = charMov->WallRunUnstickInputOffset;
+		WallRunTimeRemaining = charMov->WallRunTimeRemaining;
+		WallRunCooldownLeftTimeRemaining = charMov->WallRunCooldownLeftTimeRemaining;
+		WallRunCooldownRightTimeRemaining = charMov->WallRunCooldownRightTimeRemaining;
+		WantsToUnstickTimeRemaining = charMov->WantsToUnstickTimeRemaining;
+		WallRunTimerTickRemainder = charMov->WallRunTimerTickRemainder;
+		WallRunSide = charMov->WallRunSide;
+		WallRunWallNormal = charMov->WallRunWallNormal;
+		CurrentWallRunEndGravity = charMov->CurrentWallRunEndGravity;
+		WallRunState = charMov->WallRunState;
+		WallRunSurface = charMov->CurrentWallRunSurface;
+		bWallRunningAtStart = charMov->IsWallRunning();
+		AccelDotThresholdCombine = bWallRunningAtStart ? charMov->WallRunAccelDotCombineThreshold : DefaultAccelDotThresholdCombine;
+
+		if (bWallRunningAtStart)
+		{
+			charMov->NumWallRunSavedMoves++;
+		}
+	}
+}
+
+void FSavedMove_ShooterCharacter::PrepMoveFor(class ACharacter* Character)
+{
+	Super::PrepMoveFor(Character);
+
+	UShooterCharacterMovement* charMov = Cast<UShooterCharacterMovement>(Character->GetCharacterMovement());
+	if (charMov)
+	{
+		// Copy values out of the saved move
+
+		// Wallrunning
+		charMov->bWallrunWantsToUnstick = bWallrunWantsToUnstick;
+		charMov->WallRunJumpInputOffset = WallRunJumpInputOffset;
+		charMov->WallRunUnstickInputOffset = WallRunUnstickInputOffset;
+		charMov->WantsToUnstickTimeRemaining = WantsToUnstickTimeRemaining;
+		charMov->WallRunTimeRemaining = WallRunTimeRemaining;
+		charMov->WallRunCooldownLeftTimeRemaining = WallRunCooldownLeftTimeRemaining;
+		charMov->WallRunCooldownRightTimeRemaining = WallRunCooldownRightTimeRemaining;
+		charMov->WallRunTimerTickRemainder = WallRunTimerTickRemainder;
+		charMov->WallRunSide = WallRunSide;
+		charMov->WallRunWallNormal = WallRunWallNormal;
+		charMov->CurrentWallRunEndGravity = CurrentWallRunEndGravity;
+		charMov->WallRunState = WallRunState;
+		charMov->CurrentWallRunSurface = WallRunSurface;
+	}
+}
+
+void FSavedMove_ShooterCharacter::PostUpdate(ACharacter* Character, EPostUpdateMode PostUpdateMode)
+{
+	Super::PostUpdate(Character, PostUpdateMode);
+
+	UShooterCharacterMovement* charMov = Cast<UShooterCharacterMovement>(Character->GetCharacterMovement());
+	if (charMov == nullptr)
+	{
+		return;
+	}
+
+	if (PostUpdateMode == PostUpdate_Record)
+	{
+		// Values copied in SetMoveFor are the state at the start of the move, compare them with the state after it
+		const bool bWasWallRunning = bWallRunningAtStart;
+		const bool bIsWallRunning = charMov->IsWallRunning();
+
+		bWallRunTransition = bWasWallRunning != bIsWallRunning
+			|| (bWasWallRunning && bPressedJump)
+			|| (bIsWallRunning && (WallRunSide != charMov->WallRunSide || WallRunState != charMov->WallRunState));
+		bWallRunSteady = bWasWallRunning && bIsWallRunning && !bWallRunTransition;
+
+		// Small aim changes along the wall are not worth resending a move for
+		AccelDotThreshold = bWallRunSteady ? charMov->WallRunSteadyAccelDotThreshold : DefaultAccelDotThreshold;
+
+		if (charMov->bVerifyClientWallClaims)
+		{
+			WallClaim = charMov->DetectedWallClaim;
+			WallClaimImpactPoint = charMov->WallRunTraceImpactPoint;
+		}
+	}
+
+	// Replays after a correction change the end state too, a later correction of this move is compared with the replayed state
+	if (PostUpdateMode == PostUpdate_Record || PostUpdateMode == PostUpdate_Replay)
+	{
+		bHasEndWallRunSnapshot = FWallRunCorrectionStats::IsEnabled();
+		if (bHasEndWallRunSnapshot)
+		{
+			EndWallRunSnapshot = FWallRunStateSnapshot::Capture(*charMov);
+		}
+	}
+}
+
+bool FSavedMove_ShooterCharacter::IsImportantMove(const FSavedMovePtr& LastAckedMove) const
+{
+	const FSavedMove_ShooterCharacter* NewMove = static_cast<const FSavedMove_ShooterCharacter*>(LastAckedMove.Get());
+
+	if (bWallrunWantsToUnstick != NewMove->bWallrunWantsToUnstick)
+	{
+		return true;
+	}
+
+	// Wallrun start/stop, wall jumps, Start->Mid->End and side changes. Only the move where it happened is flagged,
+	// the steady moves following it don't compete for the redundant "old move" slot.
+	// Not sent exactly once: until acked, the move is resent as the old move of later packets. The server only simulates it once,
+	// ServerMoveOld drops old moves with a timestamp it already processed (VerifyClientTimeStamp).
+	if (bWallRunTransition)
+	{
+		return true;
+	}
+
+	return Super::IsImportantMove(LastAckedMove);
+}
+
+FNetworkPredictionData_Client_ShooterCharacter::FNetworkPredictionData_Client_ShooterCharacter(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+	const UShooterCharacterMovement& MovementComp = static_cast<const UShooterCharacterMovement&>(ClientMovement);
+	if (MovementComp.bUseSavedMovePool)
+	{
+		// Engine flushes the saved moves once there are more than MaxSavedMoveCount, make room for the max latency if the default is not enough
+		const int32 LatencyMoveCount = FMath::CeilToInt(MovementComp.SavedMovePoolMaxLatency * MovementComp.SavedMovePoolMovesPerSecond);
+		MaxSavedMoveCount = FMath::Max(MaxSavedMoveCount, LatencyMoveCount);
+
+		// Every unacked move + pending move + last acked move. Freed moves are reused before new ones are allocated,
+		// so the moves parked in FreeMoves never add up to more than that either.
+		const int32 Capacity = MaxSavedMoveCount + 2;
+
+		// Pool is never resized after this, moves hand out raw pointers into it
+		SavedMovePool.SetNum(Capacity);
+		FreeSavedMovePoolSlots.Reserve(Capacity);
+		for (int32 SlotIndex = Capacity - 1; SlotIndex >= 0; SlotIndex--)
+		{
+			FreeSavedMovePoolSlots.Add(SlotIndex);
+		}
+
+		// Let the engine keep freed pool moves around instead of releasing them
+		MaxFreeMoveCount = FMath::Max(MaxFreeMoveCount, Capacity);
+	}
+}
+
+FNetworkPredictionData_Client_ShooterCharacter::~FNetworkPredictionData_Client_ShooterCharacter()
+{
+	// Release all moves before SavedMovePool is destroyed, the base destructor would be too late
+	SavedMoves.Empty();
+	FreeMoves.Empty();
+	PendingMove = nullptr;
+	LastAckedMove = nullptr;
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_ShooterCharacter::AllocateNewMove()
+{
+	if (FreeSavedMovePoolSlots.Num() > 0)
+	{
+		const int32 SlotIndex = FreeSavedMovePoolSlots.Pop(false);
+		return FSavedMovePtr(&SavedMovePool[SlotIndex], [this, SlotIndex](FSavedMove_Character*) { ReleaseSavedMovePoolSlot(SlotIndex); });
+	}
+
+	// Pool is disabled or exhausted (should not happen while the engine keeps to MaxSavedMoveCount)
+	return FSavedMovePtr(new FSavedMove_ShooterCharacter());
+}
+
+void FNetworkPredictionData_Client_ShooterCharacter::ReleaseSavedMovePoolSlot(int32 SlotIndex)
+{
+	SavedMovePool[SlotIndex].Clear();
+	FreeSavedMovePoolSlots.Push(SlotIndex);
+}
+
+bool FShooterCharacterNetworkMoveData::Serialize(
+	UCharacterMovementComponent& CharacterMovement, FArchive& Ar,
+	UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	bool bSuperSuccess = Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
+	SerializeOptionalValue<bool>(Ar.IsSaving(), Ar, bWantsToUnstick, false);
+
+	bool bLocalSuccess = true;
+	SerializeOptionalValue<uint8>(Ar.IsSaving(), Ar, WallClaim, (uint8)EWallRunWallClaim::None);
+	if (WallClaim == (uint8)EWallRunWallClaim::Left || WallClaim == (uint8)EWallRunWallClaim::Right)
+	{
+		WallClaimImpactPoint.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	}
+	SerializeOptionalValue<uint8>(Ar.IsSaving(), Ar, WallRunJumpInputOffset, 0);
+	SerializeOptionalValue<uint8>(Ar.IsSaving(), Ar, WallRunUnstickInputOffset, 0);
+
+	return bSuperSuccess && bLocalSuccess && !Ar.IsError();
+}
+
+void FShooterCharacterNetworkMoveData::ClientFillNetworkMoveData(
+	const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType)
+{
+	Super::ClientFillNetworkMoveData(ClientMove, MoveType);
+	const FSavedMove_ShooterCharacter& Move = static_cast<const FSavedMove_ShooterCharacter&>(ClientMove);
+
+	bWantsToUnstick = Move.bWallrunWantsToUnstick;
+	WallClaim = (uint8)Move.WallClaim;
+	WallClaimImpactPoint = Move.WallClaimImpactPoint;
+	WallRunJumpInputOffset = Move.WallRunJumpInputOffset;
+	WallRunUnstickInputOffset = Move.WallRunUnstickInputOffset;
+}
+
+FShooterCharacterNetworkMoveDataContainer::FShooterCharacterNetworkMoveDataContainer() : Super()
+{
+	NewMoveData = &BFDefaultMoveData[0];
+	PendingMoveData = &BFDefaultMoveData[1];
+	OldMoveData = &BFDefaultMoveData[2];
+}
+
+
+FWallRunStateSnapshot FWallRunStateSnapshot::Capture(const UShooterCharacterMovement& MovementComp)
+{
+	FWallRunStateSnapshot Snapshot;
+	Snapshot.bIsWallRunning = MovementComp.MovementMode == MOVE_Custom && MovementComp.CustomMovementMode == CMOVE_WallRunning;
+	Snapshot.WallRunSide = MovementComp.WallRunSide;
+	Snapshot.WallRunState = MovementComp.WallRunState;
+	Snapshot.WallRunSurface = MovementComp.CurrentWallRunSurface;
+	Snapshot.WallRunWallNormal = MovementComp.WallRunWallNormal;
+	Snapshot.bIsWallRunDurationTimerStarted = MovementComp.bIsWallRunDurationTimerStarted;
+	Snapshot.WallRunTimeRemaining = MovementComp.WallRunTimeRemaining;
+	Snapshot.CurrentWallRunEndGravity = MovementComp.CurrentWallRunEndGravity;
+	Snapshot.WallRunCooldownLeftTimeRemaining = MovementComp.WallRunCooldownLeftTimeRemaining;
+	Snapshot.WallRunCooldownRightTimeRemaining = MovementComp.WallRunCooldownRightTimeRemaining;
+	Snapshot.WantsToUnstickTimeRemaining = MovementComp.WantsToUnstickTimeRemaining;
+	Snapshot.WallRunTimerTickRemainder = MovementComp.WallRunTimerTickRemainder;
+	return Snapshot;
+}
+
+void FWallRunStateSnapshot::Restore(UShooterCharacterMovement& MovementComp) const
+{
+	MovementComp.WallRunSide = WallRunSide;
+	MovementComp.WallRunState = WallRunState;
+	MovementComp.CurrentWallRunSurface = WallRunSurface;
+	MovementComp.WallRunWallNormal = WallRunWallNormal;
+	MovementComp.bIsWallRunDurationTimerStarted = bIsWallRunDurationTimerStarted;
+	MovementComp.WallRunTimeRemaining = WallRunTimeRemaining;
+	MovementComp.CurrentWallRunEndGravity = CurrentWallRunEndGravity;
+	MovementComp.WallRunCooldownLeftTimeRemaining = WallRunCooldownLeftTimeRemaining;
+	MovementComp.WallRunCooldownRightTimeRemaining = WallRunCooldownRightTimeRemaining;
+	MovementComp.WantsToUnstickTimeRemaining = WantsToUnstickTimeRemaining;
+	MovementComp.WallRunTimerTickRemainder = WallRunTimerTickRemainder;
+}
+
+uint32 FWallRunStateSnapshot::GetHash() const
+{
+	uint32 Hash = 0;
+	auto HashValue = [&Hash](const auto& Value)
+	{
+		Hash = FCrc::MemCrc32(&Value, sizeof(Value), Hash);
+	};
+
+	HashValue(bIsWallRunning);
+	HashValue(WallRunSide);
+	HashValue(WallRunState);
+	HashValue(WallRunSurface);
+	HashValue(WallRunWallNormal);
+	HashValue(bIsWallRunDurationTimerStarted);
+	HashValue(WallRunTimeRemaining);
+	HashValue(CurrentWallRunEndGravity);
+	HashValue(WallRunCooldownLeftTimeRemaining);
+	HashValue(WallRunCooldownRightTimeRemaining);
+	HashValue(WantsToUnstickTimeRemaining);
+	HashValue(WallRunTimerTickRemainder);
+	return Hash;
+}
+
+EWallRunSnapshotField FWallRunStateSnapshot::FindFirstDivergence(const FWallRunStateSnapshot& Other, float& OutDelta) const
+{
+	OutDelta = 0.0f;
+	if (GetHash() == Other.GetHash())
+	{
+		return EWallRunSnapshotField::None;
+	}
+
+	// Side, normal and end gravity only mean something while wallrunning
+	if (bIsWallRunning != Other.bIsWallRunning || WallRunState != Other.WallRunState)
+	{
+		OutDelta = FMath::Abs((float)WallRunState - (float)Other.WallRunState) + (bIsWallRunning != Other.bIsWallRunning ? 1.0f : 0.0f);
+		return EWallRunSnapshotField::State;
+	}
+	if (bIsWallRunning && WallRunSide != Other.WallRunSide)
+	{
+		OutDelta = 1.0f;
+		return EWallRunSnapshotField::Side;
+	}
+	if (bIsWallRunning && (WallRunSurface.GravityScale != Other.WallRunSurface.GravityScale || WallRunSurface.DurationScale != Other.WallRunSurface.DurationScale
+		|| WallRunSurface.SpeedScale != Other.WallRunSurface.SpeedScale))
+	{
+		OutDelta = FMath::Max3(FMath::Abs(WallRunSurface.GravityScale - Other.WallRunSurface.GravityScale), FMath::Abs(WallRunSurface.DurationScale - Other.WallRunSurface.DurationScale),
+			FMath::Abs(WallRunSurface.SpeedScale - Other.WallRunSurface.SpeedScale));
+		return EWallRunSnapshotField::Surface;
+	}
+	if (bIsWallRunning && !WallRunWallNormal.Equals(Other.WallRunWallNormal, KINDA_SMALL_NUMBER))
+	{
+		OutDelta = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(WallRunWallNormal | Other.WallRunWallNormal, -1.0f, 1.0f)));
+		return EWallRunSnapshotField::WallNormal;
+	}
+	if (bIsWallRunDurationTimerStarted != Other.bIsWallRunDurationTimerStarted)
+	{
+		OutDelta = 1.0f;
+		return EWallRunSnapshotField::DurationTimerStarted;
+	}
+
+	struct FTimerField
+	{
+		EWallRunSnapshotField Field;
+		float Value;
+		float OtherValue;
+	};
+	const FTimerField Timers[] =
+	{
+		{ EWallRunSnapshotField::WallRunTime, WallRunTimeRemaining, Other.WallRunTimeRemaining },
+		{ EWallRunSnapshotField::EndGravity, bIsWallRunning ? CurrentWallRunEndGravity : 0.0f, bIsWallRunning ? Other.CurrentWallRunEndGravity : 0.0f },
+		{ EWallRunSnapshotField::CooldownLeft, WallRunCooldownLeftTimeRemaining, Other.WallRunCooldownLeftTimeRemaining },
+		{ EWallRunSnapshotField::CooldownRight, WallRunCooldownRightTimeRemaining, Other.WallRunCooldownRightTimeRemaining },
+		{ EWallRunSnapshotField::UnstickTime, WantsToUnstickTimeRemaining, Other.WantsToUnstickTimeRemaining },
+		{ EWallRunSnapshotField::TimerTickRemainder, WallRunTimerTickRemainder, Other.WallRunTimerTickRemainder },
+	};
+	for (const FTimerField& Timer : Timers)
+	{
+		if (!FMath::IsNearlyEqual(Timer.Value, Timer.OtherValue, KINDA_SMALL_NUMBER))
+		{
+			OutDelta = FMath::Abs(Timer.Value - Timer.OtherValue);
+			return Timer.Field;
+		}
+	}
+
+	return EWallRunSnapshotField::None;
+}
+
+FString FWallRunStateSnapshot::DescribeField(EWallRunSnapshotField Field) const
+{
+	switch (Field)
+	{
+	case EWallRunSnapshotField::State:					return FString::Printf(TEXT("%s/%d"), bIsWallRunning ? TEXT("WallRunning") : TEXT("NotWallRunning"), (int32)WallRunState);
+	case EWallRunSnapshotField::Side:					return WallRunSide == EWallRunSide::Left ? TEXT("Left") : TEXT("Right");
+	case EWallRunSnapshotField::Surface:				return FString::Printf(TEXT("Gravity %g, Duration %g, Speed %g"), WallRunSurface.GravityScale, WallRunSurface.DurationScale, WallRunSurface.SpeedScale);
+	case EWallRunSnapshotField::WallNormal:				return WallRunWallNormal.ToString();
+	case EWallRunSnapshotField::DurationTimerStarted:	return bIsWallRunDurationTimerStarted ? TEXT("true") : TEXT("false");
+	case EWallRunSnapshotField::WallRunTime:			return FString::SanitizeFloat(WallRunTimeRemaining);
+	case EWallRunSnapshotField::EndGravity:				return FString::SanitizeFloat(CurrentWallRunEndGravity);
+	case EWallRunSnapshotField::CooldownLeft:			return FString::SanitizeFloat(WallRunCooldownLeftTimeRemaining);
+	case EWallRunSnapshotField::CooldownRight:			return FString::SanitizeFloat(WallRunCooldownRightTimeRemaining);
+	case EWallRunSnapshotField::UnstickTime:			return FString::SanitizeFloat(WantsToUnstickTimeRemaining);
+	case EWallRunSnapshotField::TimerTickRemainder:		return FString::SanitizeFloat(WallRunTimerTickRemainder);
+	default:											return FString();
+	}
+}
+
+void FWallRunStateSnapshot::Serialize(FArchive& Ar)
+{
+	// Diagnostics only, sent at full precision so small timer drifts are not hidden by quantization
+	Ar << bIsWallRunning;
+	Ar << WallRunSide;
+	Ar << WallRunState;
+	Ar << WallRunSurface.GravityScale;
+	Ar << WallRunSurface.DurationScale;
+	Ar << WallRunSurface.SpeedScale;
+	Ar << WallRunWallNormal;
+	Ar << bIsWallRunDurationTimerStarted;
+	Ar << WallRunTimeRemaining;
+	Ar << CurrentWallRunEndGravity;
+	Ar << WallRunCooldownLeftTimeRemaining;
+	Ar << WallRunCooldownRightTimeRemaining;
+	Ar << WantsToUnstickTimeRemaining;
+	Ar << WallRunTimerTickRemainder;
+}
+
+
+uint32 FWallRunCorrectionStats::NumCorrections = 0;
+uint32 FWallRunCorrectionStats::NumUnattributed = 0;
+uint32 FWallRunCorrectionStats::FieldCounts[(int32)EWallRunSnapshotField::Num] = {};
+float FWallRunCorrectionStats::FieldMaxDelta[(int32)EWallRunSnapshotField::Num] = {};
+
+const TCHAR* FWallRunStateSnapshot::GetFieldName(EWallRunSnapshotField Field)
+{
+	switch (Field)
+	{
+	case EWallRunSnapshotField::State:					return TEXT("State");
+	case EWallRunSnapshotField::Side:					return TEXT("Side");
+	case EWallRunSnapshotField::Surface:				return TEXT("Surface (max scale)");
+	case EWallRunSnapshotField::WallNormal:				return TEXT("WallNormal (deg)");
+	case EWallRunSnapshotField::DurationTimerStarted:	return TEXT("DurationTimerStarted");
+	case EWallRunSnapshotField::WallRunTime:			return TEXT("WallRunTimeRemaining");
+	case EWallRunSnapshotField::EndGravity:				return TEXT("CurrentWallRunEndGravity");
+	case EWallRunSnapshotField::CooldownLeft:			return TEXT("WallRunCooldownLeftTimeRemaining");
+	case EWallRunSnapshotField::CooldownRight:			return TEXT("WallRunCooldownRightTimeRemaining");
+	case EWallRunSnapshotField::UnstickTime:			return TEXT("WantsToUnstickTimeRemaining");
+	case EWallRunSnapshotField::TimerTickRemainder:		return TEXT("WallRunTimerTickRemainder");
+	case EWallRunSnapshotField::None:					return TEXT("None (not wallrun state)");
+	default:											return TEXT("?");
+	}
+}
+
+bool FWallRunCorrectionStats::IsEnabled()
+{
+	return CVar_WallRun_CorrectionAttribution > 0;
+}
+
+void FWallRunCorrectionStats::RecordCorrection(EWallRunSnapshotField Field, float Delta)
+{
+	NumCorrections++;
+	FieldCounts[(int32)Field]++;
+	FieldMaxDelta[(int32)Field] = FMath::Max(FieldMaxDelta[(int32)Field], Delta);
+}
+
+void FWallRunCorrectionStats::RecordUnattributedCorrection()
+{
+	NumCorrections++;
+	NumUnattributed++;
+}
+
+void FWallRunCorrectionStats::Report()
+{
+	UE_LOG(LogTemp, Log, TEXT("WallRun.CorrectionReport - %u corrections, %u without a matching client move"), NumCorrections, NumUnattributed);
+	for (int32 i = 0; i < (int32)EWallRunSnapshotField::Num; i++)
+	{
+		if (FieldCounts[i] > 0)
+		{
+			UE_LOG(LogTemp, Log, TEXT("  %-36s %6u (%5.1f%%), max delta %f"), FWallRunStateSnapshot::GetFieldName((EWallRunSnapshotField)i),
+				FieldCounts[i], 100.0f * FieldCounts[i] / FMath::Max(NumCorrections, 1u), FieldMaxDelta[i]);
+		}
+	}
+}
+
+void FWallRunCorrectionStats::Reset()
+{
+	NumCorrections = 0;
+	NumUnattributed = 0;
+	FMemory::Memzero(FieldCounts);
+	FMemory::Memzero(FieldMaxDelta);
+}
+
+static FAutoConsoleCommand CmdWallRunCorrectionReport(TEXT("WallRun.CorrectionReport"),
+	TEXT("[client] Prints which wallrun state field diverged first for corrections received while WallRun.CorrectionAttribution was enabled. Pass 'reset' to clear the counters."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FWallRunCorrectionStats::Report();
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			FWallRunCorrectionStats::Reset();
+		}
+	}));
+
+
+void FShooterCharacterMoveResponseDataContainer::ServerFillResponseData(
+	const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment)
+{
+	Super::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	if (!PendingAdjustment.bAckGoodMove)
+	{
+		NumCorrectionsSent++;
+	}
+
+	// Acks are far more frequent and carry nothing to attribute
+	bHasWallRunSnapshot = !PendingAdjustment.bAckGoodMove && FWallRunCorrectionStats::IsEnabled();
+	if (bHasWallRunSnapshot)
+	{
+		WallRunSnapshot = FWallRunStateSnapshot::Capture(static_cast<const UShooterCharacterMovement&>(CharacterMovement));
+	}
+}
+
+bool FShooterCharacterMoveResponseDataContainer::Serialize(
+	UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap)
+{
+	if (!Super::Serialize(CharacterMovement, Ar, PackageMap))
+	{
+		return false;
+	}
+
+	if (!IsGoodMove())
+	{
+		Ar.SerializeBits(&bHasWallRunSnapshot, 1);
+		if (bHasWallRunSnapshot)
+		{
+			WallRunSnapshot.Serialize(Ar);
+		}
+	}
+	else
+	{
+		bHasWallRunSnapshot = false;
+	}
+
+	return !Ar.IsError();
+}
@@ -1,77 +1,213 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "ShooterMovementTypes.h"
-#include "GameFramework/CharacterMovementComponent.h"
-#include <GameFramework/CharacterMovementReplication.h>
-
-
-class FSavedMove_ShooterCharacter : public FSavedMove_Character
-{
-public:
-
-	typedef FSavedMove_Character Super;
-
-	// Settings
-	float WallNormalThresholdCombine = 0.01;
-
-	// Gameplay variables
-	uint8 bWallrunWantsToUnstick : 1;
-	float WantsToUnstickTimeRemaining = 0.0f;
-	EWallRunSide WallRunSide = EWallRunSide::Left;
-	// Done, possible need to decrease the WallNormalThresholdCombine
-	FVector WallRunWallNormal = FVector::ZeroVector;
-	float CurrentWallRunEndGravity = 1.0f;
-	EWallRunState WallRunState = EWallRunState::End;
-	float WallRunTimeRemaining = 0.0f;
-	float WallRunCooldownLeftTimeRemaining = 0.0f;
-	float WallRunCooldownRightTimeRemaining = 0.0f;
-
-	// Overrides
-	virtual void Clear() override;
-	virtual uint8 GetCompressedFlags() const override;
-	virtual bool CanCombineWith(const FSavedMovePtr& NewMovePtr, ACharacter* Character, float MaxDelta) const override;
-	virtual void CombineWith(const FSavedMove_Character* OldMove, ACharacter* InCharacter, APlayerController* PC, const FVector& OldStartLocation) override;
-	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
-	virtual void PrepMoveFor(class ACharacter* Character) override;
-	virtual bool IsImportantMove(const FSavedMovePtr& LastAckedMove) const;
-
-
-};
-
-class FNetworkPredictionData_Client_ShooterCharacter : public FNetworkPredictionData_Client_Character
-{
-public:
-	typedef FNetworkPredictionData_Client_Character Super;
-
-	FNetworkPredictionData_Client_ShooterCharacter(const UCharacterMovementComponent& ClientMovement);
-
-	virtual FSavedMovePtr AllocateNewMove() override;
-};
-
-
-struct SHOOTERGAME_API FShooterCharacterNetworkMoveData : FCharacterNetworkMoveData
-{
-public:
-	bool bWantsToUnstick = false;
-
-	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
-	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
-
-private:
-	typedef FCharacterNetworkMoveData Super;
-};
-
-
-struct SHOOTERGAME_API FShooterCharacterNetworkMoveDataContainer
-	: FCharacterNetworkMoveDataContainer
-{
-public:
-	FShooterCharacterNetworkMoveDataContainer();
-
-private:
-	typedef FCharacterNetworkMoveDataContainer Super;
-	FShooterCharacterNetworkMoveData BFDefaultMoveData[3];
-};
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterMovementTypes.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include <GameFramework/CharacterMovementReplication.h>
+
+
+/** Wallrun state fields compared by correction attribution, in the order a divergence propagates through them */
+enum class EWallRunSnapshotField : uint8
+{
+	State,
+	Side,
+	Surface,
+	WallNormal,
+	DurationTimerStarted,
+	WallRunTime,
+	EndGravity,
+	CooldownLeft,
+	CooldownRight,
+	UnstickTime,
+	TimerTickRemainder,
+	// Wallrun state matched, the correction came from somewhere else (collision, velocity, ...)
+	None,
+	Num
+};
+
+
+/**
+ * Wallrun state at the end of a move. Recorded by the client per saved move and sent back by the server
+ * along with corrections while WallRun.CorrectionAttribution is enabled, to find out which part diverged first.
+ */
+struct SHOOTERGAME_API FWallRunStateSnapshot
+{
+	bool bIsWallRunning = false;
+	EWallRunSide WallRunSide = EWallRunSide::Left;
+	EWallRunState WallRunState = EWallRunState::End;
+	FWallRunSurfaceParams WallRunSurface;
+	FVector WallRunWallNormal = FVector::ZeroVector;
+	bool bIsWallRunDurationTimerStarted = false;
+	float WallRunTimeRemaining = 0.0f;
+	float CurrentWallRunEndGravity = 1.0f;
+	float WallRunCooldownLeftTimeRemaining = 0.0f;
+	float WallRunCooldownRightTimeRemaining = 0.0f;
+	float WantsToUnstickTimeRemaining = 0.0f;
+	float WallRunTimerTickRemainder = 0.0f;
+
+	static FWallRunStateSnapshot Capture(const class UShooterCharacterMovement& MovementComp);
+
+	/** Writes the wallrun state back (movement mode is not touched) */
+	void Restore(class UShooterCharacterMovement& MovementComp) const;
+
+	uint32 GetHash() const;
+
+	/** First field (see EWallRunSnapshotField) differing from Other, OutDelta is by how much (1 for enums and flags) */
+	EWallRunSnapshotField FindFirstDivergence(const FWallRunStateSnapshot& Other, float& OutDelta) const;
+
+	FString DescribeField(EWallRunSnapshotField Field) const;
+
+	static const TCHAR* GetFieldName(EWallRunSnapshotField Field);
+
+	void Serialize(FArchive& Ar);
+};
+
+
+/** Correction attribution counters, shared by all locally controlled characters (WallRun.CorrectionReport) */
+struct SHOOTERGAME_API FWallRunCorrectionStats
+{
+	static bool IsEnabled();
+
+	static void RecordCorrection(EWallRunSnapshotField Field, float Delta);
+	static void RecordUnattributedCorrection();
+
+	static void Report();
+	static void Reset();
+
+private:
+	static uint32 NumCorrections;
+	// Server snapshot arrived after the client already dropped the corrected move
+	static uint32 NumUnattributed;
+	static uint32 FieldCounts[(int32)EWallRunSnapshotField::Num];
+	static float FieldMaxDelta[(int32)EWallRunSnapshotField::Num];
+};
+
+
+class FSavedMove_ShooterCharacter : public FSavedMove_Character
+{
+public:
+
+	typedef FSavedMove_Character Super;
+
+	// Settings, copied from UShooterCharacterMovement::WallNormalCombineThreshold
+	float WallNormalThresholdCombine = 0.01;
+	// Engine default for AccelDotThreshold, used whenever the move is not a steady wallrun
+	float DefaultAccelDotThreshold = 0.9f;
+	// Engine default for AccelDotThresholdCombine, used whenever the move doesn't start on a wall
+	float DefaultAccelDotThresholdCombine = 0.996f;
+
+	// Gameplay variables
+	uint8 bWallrunWantsToUnstick : 1;
+	float WantsToUnstickTimeRemaining = 0.0f;
+	EWallRunSide WallRunSide = EWallRunSide::Left;
+	// Done, possible need to decrease the WallNormalThresholdCombine
+	FVector WallRunWallNormal = FVector::ZeroVector;
+	float CurrentWallRunEndGravity = 1.0f;
+	EWallRunState WallRunState = EWallRunState::End;
+	// Resolved at wallrun start only, replays of later moves need it restored
+	FWallRunSurfaceParams WallRunSurface;
+	float WallRunTimeRemaining = 0.0f;
+	float WallRunCooldownLeftTimeRemaining = 0.0f;
+	float WallRunCooldownRightTimeRemaining = 0.0f;
+	float WallRunTimerTickRemainder = 0.0f;
+	uint8 bWallRunningAtStart : 1;
+	// When within the move jump and unstick were pressed, see UShooterCharacterMovement::bUseSubTickWallRunInput
+	uint8 WallRunJumpInputOffset = 0;
+	uint8 WallRunUnstickInputOffset = 0;
+
+	// Recorded after the move was performed (PostUpdate)
+	// Wallrun started, stopped, jumped off the wall, changed side or state during this move
+	uint8 bWallRunTransition : 1;
+	// Wallrunning for the whole move without any transition
+	uint8 bWallRunSteady : 1;
+	// Result of wall detection during this move, sent for the server to verify
+	EWallRunWallClaim WallClaim = EWallRunWallClaim::None;
+	FVector WallClaimImpactPoint = FVector::ZeroVector;
+	// Wallrun state after the move, only recorded while WallRun.CorrectionAttribution is enabled
+	FWallRunStateSnapshot EndWallRunSnapshot;
+	uint8 bHasEndWallRunSnapshot : 1;
+
+	// Overrides
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMovePtr, ACharacter* Character, float MaxDelta) const override;
+	virtual void CombineWith(const FSavedMove_Character* OldMove, ACharacter* InCharacter, APlayerController* PC, const FVector& OldStartLocation) override;
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(class ACharacter* Character) override;
+	virtual void PostUpdate(ACharacter* Character, EPostUpdateMode PostUpdateMode) override;
+	virtual bool IsImportantMove(const FSavedMovePtr& LastAckedMove) const override;
+
+
+};
+
+class FNetworkPredictionData_Client_ShooterCharacter : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_ShooterCharacter(const UCharacterMovementComponent& ClientMovement);
+	virtual ~FNetworkPredictionData_Client_ShooterCharacter();
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+
+private:
+	/** Called when the last reference to a move living in SavedMovePool goes away */
+	void ReleaseSavedMovePoolSlot(int32 SlotIndex);
+
+	// Preallocated saved moves, sized once and never reallocated (see UShooterCharacterMovement::bUseSavedMovePool)
+	TArray<FSavedMove_ShooterCharacter> SavedMovePool;
+	// Slots not handed out, the last released one is reused first (it's the one most likely still in cache)
+	TArray<int32> FreeSavedMovePoolSlots;
+};
+
+
+struct SHOOTERGAME_API FShooterCharacterNetworkMoveData : FCharacterNetworkMoveData
+{
+public:
+	bool bWantsToUnstick = false;
+	// Side of the wall the client detected and the quantized hit, verified by the server with a single probe
+	uint8 WallClaim = (uint8)EWallRunWallClaim::None;
+	FVector_NetQuantize WallClaimImpactPoint;
+	// Sub-move offsets of jump and unstick presses, in 1/256 of the move
+	uint8 WallRunJumpInputOffset = 0;
+	uint8 WallRunUnstickInputOffset = 0;
+
+	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+
+private:
+	typedef FCharacterNetworkMoveData Super;
+};
+
+
+struct SHOOTERGAME_API FShooterCharacterNetworkMoveDataContainer
+	: FCharacterNetworkMoveDataContainer
+{
+public:
+	FShooterCharacterNetworkMoveDataContainer();
+
+private:
+	typedef FCharacterNetworkMoveDataContainer Super;
+	FShooterCharacterNetworkMoveData BFDefaultMoveData[3];
+};
+
+
+/** Move response carrying the server wallrun state along with corrections while WallRun.CorrectionAttribution is enabled */
+struct SHOOTERGAME_API FShooterCharacterMoveResponseDataContainer
+	: FCharacterMoveResponseDataContainer
+{
+public:
+	bool bHasWallRunSnapshot = false;
+	FWallRunStateSnapshot WallRunSnapshot;
+
+	/** [server] Corrections sent to the owning client so far */
+	uint32 NumCorrectionsSent = 0;
+
+	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap) override;
+
+private:
+	typedef FCharacterMoveResponseDataContainer Super;
+};
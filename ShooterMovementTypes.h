@@ -1,63 +1,139 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "ShooterMovementTypes.generated.h"
-
-
-UENUM(BlueprintType)
-enum class EWallRunSide : uint8
-{
-	Left 	UMETA(DisplayName = "Left", ToolTip = "Running along the left side of a wall"),
-	Right	UMETA(DisplayName = "Right", ToolTip = "Running along the right side of a wall"),
-};
-
-
-/**
- * WallRun is divided into 3 states.
- *  - Start - Character is still ascending rapidly (going upwards on the wall)
- *  - Mid - Character has low gravity and duration timer has started
- *  - End - Duration timer finished, gravity is increased to force character to fall
- */
-UENUM(BlueprintType)
-enum class EWallRunState : uint8
-{
-	Start 		UMETA(DisplayName = "Left", ToolTip = "Before reaching apex"),
-	Mid		UMETA(DisplayName = "Right", ToolTip = "After apex, going forward without gravity"),
-	End		UMETA(DisplayName = "End", ToolTip = "Increasing gravity to force fall"),
-};
-
-USTRUCT(BlueprintType)
-struct FWallRunJumpSettings
-{
-	GENERATED_BODY()
-
-	// Jump Forward velocity
-	UPROPERTY(EditAnywhere, BlueprintReadOnly)
-	float ForwardVelocity;
-
-	// Jump Z Velocity
-	UPROPERTY(EditAnywhere, BlueprintReadOnly)
-	float UpVelocity;
-
-	FWallRunJumpSettings()
-	{
-		ForwardVelocity = 600.0f;
-		UpVelocity = 900.0f;
-	}
-
-	FWallRunJumpSettings(float InForwardVelocity, float InUpVelocity)
-	{
-		ForwardVelocity = InForwardVelocity;
-		UpVelocity = InUpVelocity;
-	}
-};
-
-/** Custom movement modes for Characters. */
-UENUM(BlueprintType)
-enum ECustomMovementMode
-{
-	CMOVE_WallRunning   UMETA(DisplayName = "WallRunning"),
-	CMOVE_MAX			UMETA(Hidden),
-};
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "ShooterMovementTypes.generated.h"
+
+
+/**
+ * Headless profile, strips cosmetic (camera tilt) and debug (drawing, debug console variables) wallrun code at compile time.
+ * Component API stays the same, cosmetic properties are just ignored. On by default for dedicated server builds.
+ */
+#ifndef WALLRUN_HEADLESS
+#define WALLRUN_HEADLESS UE_SERVER
+#endif
+
+/** Debug drawing and debug console variables of wallrun movement */
+#define WALLRUN_DEBUG (!(UE_BUILD_SHIPPING || UE_BUILD_TEST) && !WALLRUN_HEADLESS)
+
+
+UENUM(BlueprintType)
+enum class EWallRunSide : uint8
+{
+	Left 	UMETA(DisplayName = "Left", ToolTip = "Running along the left side of a wall"),
+	Right	UMETA(DisplayName = "Right", ToolTip = "Running along the right side of a wall"),
+};
+
+
+/**
+ * WallRun is divided into 3 states.
+ *  - Start - Character is still ascending rapidly (going upwards on the wall)
+ *  - Mid - Character has low gravity and duration timer has started
+ *  - End - Duration timer finished, gravity is increased to force character to fall
+ */
+UENUM(BlueprintType)
+enum class EWallRunState : uint8
+{
+	Start 		UMETA(DisplayName = "Left", ToolTip = "Before reaching apex"),
+	Mid		UMETA(DisplayName = "Right", ToolTip = "After apex, going forward without gravity"),
+	End		UMETA(DisplayName = "End", ToolTip = "Increasing gravity to force fall"),
+};
+
+USTRUCT(BlueprintType)
+struct FWallRunJumpSettings
+{
+	GENERATED_BODY()
+
+	// Jump Forward velocity
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float ForwardVelocity;
+
+	// Jump Z Velocity
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float UpVelocity;
+
+	FWallRunJumpSettings()
+	{
+		ForwardVelocity = 600.0f;
+		UpVelocity = 900.0f;
+	}
+
+	FWallRunJumpSettings(float InForwardVelocity, float InUpVelocity)
+	{
+		ForwardVelocity = InForwardVelocity;
+		UpVelocity = InUpVelocity;
+	}
+};
+
+/**
+ * Wallrun tuning of one kind of surface, multiplies the values set on UShooterCharacterMovement
+ * (see UShooterCharacterMovement::WallRunSurfaceOverrides)
+ */
+USTRUCT(BlueprintType)
+struct FWallRunSurfaceParams
+{
+	GENERATED_BODY()
+
+	// Scales wallrun gravity in every wallrun state, e.g. > 1 for slippery glass
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "0"))
+	float GravityScale = 1.0f;
+
+	// Scales WallRunDuration, e.g. > 1 for grippy concrete
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "0"))
+	float DurationScale = 1.0f;
+
+	// Scales WallRunSpeed
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "0"))
+	float SpeedScale = 1.0f;
+};
+
+/**
+ * Wallrun state replicated to simulated proxies, just enough for them to predict the wallrun
+ * (see UShooterCharacterMovement::PredictWallRunTrajectory)
+ */
+USTRUCT()
+struct FWallRunProxyState
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	EWallRunState State = EWallRunState::End;
+
+	UPROPERTY()
+	EWallRunSide Side = EWallRunSide::Left;
+
+	// Duration timer when the state was sent, proxies count it down themselves
+	UPROPERTY()
+	bool bDurationTimerStarted = false;
+
+	UPROPERTY()
+	float TimeRemaining = 0.0f;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal WallNormal;
+
+	UPROPERTY()
+	FWallRunSurfaceParams Surface;
+};
+
+/**
+ * Wall contact reported by the client for a move (see UShooterCharacterMovement::bVerifyClientWallClaims)
+ */
+UENUM()
+enum class EWallRunWallClaim : uint8
+{
+	None,		// Nothing reported, server runs full wall detection
+	NoWall,		// Client is not running on any wall after detection. Not trusted, server runs full wall detection (no longer sent)
+	Left,		// Client is running on a wall on the left, impact point is sent along
+	Right,		// Client is running on a wall on the right, impact point is sent along
+};
+
+/** Custom movement modes for Characters. */
+UENUM(BlueprintType)
+enum ECustomMovementMode
+{
+	CMOVE_WallRunning   UMETA(DisplayName = "WallRunning"),
+	CMOVE_MAX			UMETA(Hidden),
+};
@@ -0,0 +1,292 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WallGeometryHistory.h"
+#include "ShooterCharacterMovement.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Character.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+
+AWallGeometryHistory::AWallGeometryHistory(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Server side bookkeeping, record after everything moved this frame
+	SetReplicates(false);
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+}
+
+AWallGeometryHistory* AWallGeometryHistory::GetOrCreate(UWorld* World)
+{
+	if (World == nullptr || World->GetNetMode() == NM_Client)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AWallGeometryHistory> It(World); It; ++It)
+	{
+		return *It;
+	}
+	return World->SpawnActor<AWallGeometryHistory>();
+}
+
+void AWallGeometryHistory::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Config values are not clamped like edited ones
+	MaxTrackedComponents = FMath::Max(1, MaxTrackedComponents);
+	MaxFrames = FMath::Max(2, MaxFrames);
+
+	// One frame is recorded per tick, enough of them to reach MaxRewindTime back at the tick rate the server is capped to.
+	// Uncapped (0) can't be sized up front, GetMovedComponents warns if the history turns out too short.
+	const float MaxTickRate = GEngine->GetMaxTickRate(0.0f, false);
+	if (MaxTickRate > 0.0f)
+	{
+		MaxFrames = FMath::Max(MaxFrames, FMath::CeilToInt(MaxRewindTime * MaxTickRate) + 2);
+	}
+
+	FrameTimes.SetNumZeroed(MaxFrames);
+	Poses.SetNumZeroed(MaxFrames * MaxTrackedComponents);
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		RegisterTagged(*It);
+	}
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AWallGeometryHistory::OnActorSpawned));
+
+	UE_LOG(LogTemp, Log, TEXT("WallGeometryHistory - %d components tracked, %d frames (max tick rate %.0f), %.1f KB"), Slots.Num(), MaxFrames, MaxTickRate, GetHistorySize() / 1024.0);
+}
+
+void AWallGeometryHistory::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	Super::EndPlay(EndPlayReason);
+}
+
+void AWallGeometryHistory::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	RecordFrame();
+}
+
+void AWallGeometryHistory::OnActorSpawned(AActor* Actor)
+{
+	RegisterTagged(Actor);
+}
+
+void AWallGeometryHistory::RegisterTagged(AActor* Actor)
+{
+	const bool bActorTagged = Actor->ActorHasTag(TrackedTag);
+	TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+	for (UPrimitiveComponent* Component : Components)
+	{
+		if ((bActorTagged || Component->ComponentHasTag(TrackedTag)) && Component->Mobility == EComponentMobility::Movable && Component->IsQueryCollisionEnabled())
+		{
+			Register(Component);
+		}
+	}
+}
+
+void AWallGeometryHistory::Register(UPrimitiveComponent* Component)
+{
+	if (Component == nullptr || Slots.Contains(Component))
+	{
+		return;
+	}
+
+	// Reuse slots of destroyed components, their frames are ignored by SlotStartTimes
+	int32 Slot = Slots.IndexOfByPredicate([](const TWeakObjectPtr<UPrimitiveComponent>& Existing) { return !Existing.IsValid(); });
+	if (Slot == INDEX_NONE)
+	{
+		if (Slots.Num() >= MaxTrackedComponents)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("WallGeometryHistory - MaxTrackedComponents (%d) reached, %s is not lag compensated"), MaxTrackedComponents, *Component->GetPathName());
+			return;
+		}
+		Slot = Slots.Add(nullptr);
+		SlotStartTimes.Add(0.0f);
+	}
+
+	Slots[Slot] = Component;
+	SlotStartTimes[Slot] = GetWorld()->GetTimeSeconds();
+}
+
+void AWallGeometryHistory::RecordFrame()
+{
+	NewestFrame = (NewestFrame + 1) % MaxFrames;
+	NumFrames = FMath::Min(NumFrames + 1, MaxFrames);
+	FrameTimes[NewestFrame] = GetWorld()->GetTimeSeconds();
+
+	FPose* FramePoses = &Poses[NewestFrame * MaxTrackedComponents];
+	for (int32 Slot = 0; Slot < Slots.Num(); Slot++)
+	{
+		if (const UPrimitiveComponent* Component = Slots[Slot].Get())
+		{
+			FramePoses[Slot].Location = Component->GetComponentLocation();
+			FramePoses[Slot].Rotation = Component->GetComponentQuat();
+		}
+	}
+}
+
+void AWallGeometryHistory::GetMovedComponents(float Time, TArray<FRewoundComponent, TInlineAllocator<8>>& OutComponents) const
+{
+	OutComponents.Reset();
+	if (NumFrames == 0)
+	{
+		return;
+	}
+
+	Time = FMath::Max(Time, GetWorld()->GetTimeSeconds() - MaxRewindTime);
+	if (Time >= FrameTimes[NewestFrame])
+	{
+		return;
+	}
+
+	// Full ring not reaching back far enough, frames are recorded faster than MaxFrames was sized for and the oldest one is used instead
+	const float OldestFrameTime = FrameTimes[GetFrameIndex(0)];
+	if (Time < OldestFrameTime && NumFrames == MaxFrames && !bWarnedHistoryTooShort)
+	{
+		bWarnedHistoryTooShort = true;
+		UE_LOG(LogTemp, Warning, TEXT("WallGeometryHistory - %d frames only reach %.3f s back, rewinds up to MaxRewindTime (%.3f s) are clamped, raise MaxFrames"),
+			MaxFrames, GetWorld()->GetTimeSeconds() - OldestFrameTime, MaxRewindTime);
+	}
+
+	for (int32 Slot = 0; Slot < Slots.Num(); Slot++)
+	{
+		UPrimitiveComponent* Component = Slots[Slot].Get();
+		if (Component == nullptr)
+		{
+			continue;
+		}
+
+		// Last frame at or before the time, within what was recorded for this component
+		const float SlotTime = FMath::Max(Time, SlotStartTimes[Slot]);
+		int32 Low = 0;
+		int32 High = NumFrames - 1;
+		while (Low < High)
+		{
+			const int32 Mid = (Low + High + 1) / 2;
+			if (FrameTimes[GetFrameIndex(Mid)] <= SlotTime)
+			{
+				Low = Mid;
+			}
+			else
+			{
+				High = Mid - 1;
+			}
+		}
+
+		int32 FrameA = GetFrameIndex(Low);
+		const int32 FrameB = GetFrameIndex(FMath::Min(Low + 1, NumFrames - 1));
+		if (FrameTimes[FrameA] < SlotStartTimes[Slot])
+		{
+			// Frame from before the component was recorded, the slot may have held another one then
+			if (FrameTimes[FrameB] < SlotStartTimes[Slot])
+			{
+				continue;
+			}
+			FrameA = FrameB;
+		}
+		const FPose& PoseA = Poses[FrameA * MaxTrackedComponents + Slot];
+		const FPose& PoseB = Poses[FrameB * MaxTrackedComponents + Slot];
+		const float FrameSpan = FrameTimes[FrameB] - FrameTimes[FrameA];
+		const float Alpha = FrameSpan > 0.0f ? FMath::Clamp((SlotTime - FrameTimes[FrameA]) / FrameSpan, 0.0f, 1.0f) : 0.0f;
+
+		const FTransform& CurrentTransform = Component->GetComponentTransform();
+		const FVector PastLocation = FMath::Lerp(PoseA.Location, PoseB.Location, Alpha);
+		const FQuat PastRotation = FQuat::Slerp(PoseA.Rotation, PoseB.Rotation, Alpha);
+		if (PastLocation.Equals(CurrentTransform.GetLocation(), 0.1f) && PastRotation.Equals(CurrentTransform.GetRotation(), 1.e-4f))
+		{
+			continue;
+		}
+
+		FRewoundComponent& Rewound = OutComponents.AddDefaulted_GetRef();
+		Rewound.Component = Component;
+		Rewound.CurrentTransform = CurrentTransform;
+		Rewound.PastTransform = FTransform(PastRotation, PastLocation, CurrentTransform.GetScale3D());
+	}
+}
+
+SIZE_T AWallGeometryHistory::GetHistorySize() const
+{
+	return FrameTimes.GetAllocatedSize() + Poses.GetAllocatedSize() + Slots.GetAllocatedSize() + SlotStartTimes.GetAllocatedSize();
+}
+
+
+FWallQueryBackend_Rewound::FWallQueryBackend_Rewound(const FWallQueryBackend_Physics& InPhysicsBackend, const AWallGeometryHistory& History, float Time, const ACharacter* InCharacter)
+	: PhysicsBackend(InPhysicsBackend)
+	, Character(InCharacter)
+{
+	History.GetMovedComponents(Time, Components);
+
+	// LineTraceComponent doesn't filter, keep only walls the physics trace would have hit
+	const FCollisionObjectQueryParams& ObjectQueryParams = PhysicsBackend.ObjectQueryParams;
+	const ECollisionChannel TraceChannel = PhysicsBackend.TraceChannel;
+	Components.RemoveAll([&ObjectQueryParams, TraceChannel](const AWallGeometryHistory::FRewoundComponent& Rewound)
+	{
+		if (ObjectQueryParams.IsValid())
+		{
+			return (ObjectQueryParams.GetQueryBitfield() & ECC_TO_BITFIELD(Rewound.Component->GetCollisionObjectType())) == 0;
+		}
+		return Rewound.Component->GetCollisionResponseToChannel(TraceChannel) != ECR_Block;
+	});
+
+	for (const AWallGeometryHistory::FRewoundComponent& Rewound : Components)
+	{
+		PhysicsBackend.QueryParams.AddIgnoredComponent(Rewound.Component);
+	}
+}
+
+bool FWallQueryBackend_Rewound::Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const
+{
+	PhysicsBackend.Raycast(Start, End, OutHit);
+	if (Components.Num() == 0)
+	{
+		return OutHit.bBlockingHit;
+	}
+
+	WALLRUN_INC_COUNTER(RewoundTraces, 1);
+	FCollisionQueryParams ComponentParams(SCENE_QUERY_STAT(WallRunRewoundTrace), false);
+	ComponentParams.bReturnPhysicalMaterial = PhysicsBackend.QueryParams.bReturnPhysicalMaterial;
+
+	// Anything attached together with the base moved along with the character, it's not rewound
+	const UPrimitiveComponent* MovementBase = Character ? Character->GetMovementBase() : nullptr;
+	const USceneComponent* MovementBaseRoot = MovementBase ? MovementBase->GetAttachmentRoot() : nullptr;
+
+	for (const AWallGeometryHistory::FRewoundComponent& Rewound : Components)
+	{
+		const bool bIsMovementBase = MovementBaseRoot && Rewound.Component->GetAttachmentRoot() == MovementBaseRoot;
+		const FTransform& PastTransform = bIsMovementBase ? Rewound.CurrentTransform : Rewound.PastTransform;
+
+		// Ray in the wall's space at the past time, traced against where the wall is now
+		const FVector LocalStart = PastTransform.InverseTransformPosition(Start);
+		const FVector LocalEnd = PastTransform.InverseTransformPosition(End);
+		const FVector CurrentStart = Rewound.CurrentTransform.TransformPosition(LocalStart);
+		const FVector CurrentEnd = Rewound.CurrentTransform.TransformPosition(LocalEnd);
+
+		// Cheap reject against the current bounds before the narrow phase
+		const FBoxSphereBounds& Bounds = Rewound.Component->Bounds;
+		if (FMath::PointDistToSegmentSquared(Bounds.Origin, CurrentStart, CurrentEnd) > FMath::Square(Bounds.SphereRadius))
+		{
+			continue;
+		}
+
+		FHitResult HitResult;
+		if (Rewound.Component->LineTraceComponent(HitResult, CurrentStart, CurrentEnd, ComponentParams)
+			&& (!OutHit.bBlockingHit || HitResult.Distance < OutHit.Distance))
+		{
+			OutHit.bBlockingHit = true;
+			OutHit.Location = PastTransform.TransformPosition(Rewound.CurrentTransform.InverseTransformPosition(HitResult.Location));
+			OutHit.Normal = PastTransform.TransformVectorNoScale(Rewound.CurrentTransform.InverseTransformVectorNoScale(HitResult.Normal));
+			OutHit.Distance = HitResult.Distance;
+			OutHit.Component = Rewound.Component;
+			OutHit.PhysMaterial = HitResult.PhysMaterial.Get();
+		}
+	}
+	return OutHit.bBlockingHit;
+}
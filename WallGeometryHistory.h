@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "WallQueryBackend.h"
+#include "WallGeometryHistory.generated.h"
+
+class ACharacter;
+
+
+/**
+ * [server] Recent transforms of wallrunnable dynamic geometry (trains, elevators, doors), so wall detection of a received move can
+ * run against the walls as the client saw them instead of where they are now (see UShooterCharacterMovement::bLagCompensateWallDetection).
+ *
+ * Components opt in with TrackedTag on the component or its actor and are picked up when they spawn. One pose per component is
+ * recorded at the end of every frame into a fixed ring buffer, memory is MaxFrames * MaxTrackedComponents poses and a lookup is
+ * a binary search over frame times. Only transforms are recorded, a destroyed component is gone from the history too.
+ *
+ * Spawned at runtime, so settings come from the [/Script/ShooterGame.WallGeometryHistory] section of DefaultGame.ini.
+ */
+UCLASS(NotBlueprintable, NotPlaceable, Transient, Config = Game)
+class SHOOTERGAME_API AWallGeometryHistory : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AWallGeometryHistory(const FObjectInitializer& ObjectInitializer);
+
+	/** History of the world, spawned on first use. Server only, returns null elsewhere. */
+	static AWallGeometryHistory* GetOrCreate(UWorld* World);
+
+	/** Components (or actors) with this tag are recorded */
+	UPROPERTY(Config, Category = "History")
+	FName TrackedTag = TEXT("WallRunnable");
+
+	/** Components recorded at most, further ones are not lag compensated */
+	UPROPERTY(Config, Category = "History", meta = (ClampMin = "1"))
+	int32 MaxTrackedComponents = 64;
+
+	/** Frames kept at least, raised in BeginPlay to cover MaxRewindTime at the server's max tick rate */
+	UPROPERTY(Config, Category = "History", meta = (ClampMin = "2"))
+	int32 MaxFrames = 32;
+
+	/** Queries never go further back than this (in seconds), no matter the client's ping */
+	UPROPERTY(Config, Category = "History", meta = (ClampMin = "0"))
+	float MaxRewindTime = 0.4f;
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Starts recording the component, does nothing if it's already recorded or there is no free slot */
+	void Register(UPrimitiveComponent* Component);
+
+	/** Transform of every recorded component at World time Time (interpolated between frames) if any moved since, for FWallQueryBackend_Rewound */
+	struct FRewoundComponent
+	{
+		UPrimitiveComponent* Component = nullptr;
+		FTransform PastTransform;
+		FTransform CurrentTransform;
+	};
+	void GetMovedComponents(float Time, TArray<FRewoundComponent, TInlineAllocator<8>>& OutComponents) const;
+
+	/** Memory used by the ring buffer in bytes */
+	SIZE_T GetHistorySize() const;
+
+private:
+	struct FPose
+	{
+		FVector Location;
+		FQuat Rotation;
+	};
+
+	void OnActorSpawned(AActor* Actor);
+	void RegisterTagged(AActor* Actor);
+	void RecordFrame();
+
+	/** Recorded frame index of the given age, 0 is the oldest frame */
+	int32 GetFrameIndex(int32 Age) const { return (NewestFrame - NumFrames + 1 + Age + MaxFrames) % MaxFrames; }
+
+	/** Slot i of frame f is Poses[f * MaxTrackedComponents + i] */
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> Slots;
+	TArray<float> SlotStartTimes;
+	TArray<float> FrameTimes;
+	TArray<FPose> Poses;
+
+	int32 NewestFrame = -1;
+	int32 NumFrames = 0;
+
+	/** Rewinds past the oldest recorded frame are reported once */
+	mutable bool bWarnedHistoryTooShort = false;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
+
+
+/**
+ * Traces against the physics scene with recorded dynamic walls moved back to where they were at a past time (see AWallGeometryHistory).
+ * Static geometry and walls that didn't move are traced as usual, moved walls are traced one by one with the ray taken into their
+ * past space. Set up once per received move, cost per ray grows with the number of walls that moved within the rewound time.
+ * Walls the character is based on are traced where they are now, the client moved along with them.
+ */
+class SHOOTERGAME_API FWallQueryBackend_Rewound : public IWallQueryBackend
+{
+public:
+	FWallQueryBackend_Rewound() {}
+	FWallQueryBackend_Rewound(const FWallQueryBackend_Physics& InPhysicsBackend, const AWallGeometryHistory& History, float Time, const ACharacter* InCharacter = nullptr);
+
+	virtual bool Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const override;
+
+	bool HasRewoundComponents() const { return Components.Num() > 0; }
+
+private:
+	/** Recorded walls are left out of this one */
+	FWallQueryBackend_Physics PhysicsBackend;
+
+	TArray<AWallGeometryHistory::FRewoundComponent, TInlineAllocator<8>> Components;
+
+	/** Movement base is looked up per ray, it may change between the moves of a packet */
+	const ACharacter* Character = nullptr;
+};
@@ -0,0 +1,207 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WallGeometryHistory.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/CollisionProfile.h"
+#include "Components/BoxComponent.h"
+#include "GameFramework/Character.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace WallGeometryHistoryTests
+{
+	constexpr float FrameTime = 0.05f;
+
+	/** Game world with physics, ticked by hand */
+	struct FTestWorld
+	{
+		UWorld* World = nullptr;
+
+		FTestWorld()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false);
+			FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+			WorldContext.SetCurrentWorld(World);
+			World->InitializeActorsForPlay(FURL());
+			World->BeginPlay();
+		}
+
+		~FTestWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+
+		void Tick(int32 NumFrames)
+		{
+			for (int32 i = 0; i < NumFrames; i++)
+			{
+				World->Tick(LEVELTICK_All, FrameTime);
+			}
+		}
+	};
+
+	/** Movable box blocking everything, its face towards the origin is at Location.X - 10 */
+	UBoxComponent* SpawnWall(UWorld* World, const FVector& Location)
+	{
+		AActor* WallActor = World->SpawnActor<AActor>();
+		UBoxComponent* Box = NewObject<UBoxComponent>(WallActor);
+		Box->SetMobility(EComponentMobility::Movable);
+		Box->SetBoxExtent(FVector(10.0f, 200.0f, 200.0f));
+		Box->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		WallActor->SetRootComponent(Box);
+		Box->RegisterComponent();
+		WallActor->SetActorLocation(Location);
+		return Box;
+	}
+
+	/**
+	 * Recorded wall standing at X = 100 for a few frames, then moved away to X = 300 a few frames ago.
+	 * OutRewindTime is a time it still stood at X = 100, the wall ignores IgnoredChannel unless it's ECC_MAX.
+	 */
+	UBoxComponent* SpawnMovedWall(FTestWorld& TestWorld, AWallGeometryHistory& History, float& OutRewindTime, ECollisionChannel IgnoredChannel = ECC_MAX)
+	{
+		UBoxComponent* Wall = SpawnWall(TestWorld.World, FVector(100.0f, 0.0f, 0.0f));
+		if (IgnoredChannel != ECC_MAX)
+		{
+			Wall->SetCollisionResponseToChannel(IgnoredChannel, ECR_Ignore);
+		}
+		History.Register(Wall);
+		TestWorld.Tick(3);
+		OutRewindTime = TestWorld.World->GetTimeSeconds();
+		Wall->SetWorldLocation(FVector(300.0f, 0.0f, 0.0f));
+		TestWorld.Tick(2);
+		return Wall;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWallGeometryHistoryRewindTest, "ShooterGame.WallRun.GeometryHistory.Rewind",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWallGeometryHistoryRewindTest::RunTest(const FString& Parameters)
+{
+	using namespace WallGeometryHistoryTests;
+
+	FTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+
+	AWallGeometryHistory* History = AWallGeometryHistory::GetOrCreate(World);
+	if (!TestNotNull(TEXT("History is spawned outside of clients"), History))
+	{
+		return false;
+	}
+
+	float RewindTime = 0.0f;
+	UBoxComponent* Wall = SpawnMovedWall(TestWorld, *History, RewindTime);
+
+	const FWallQueryBackend_Physics PhysicsBackend(World, FCollisionQueryParams(SCENE_QUERY_STAT(WallRunTrace), false), ECC_Visibility);
+	const FVector Start = FVector::ZeroVector;
+	const FVector End(200.0f, 0.0f, 0.0f);
+
+	FWallQueryHit Hit;
+	TestFalse(TEXT("Current wall is out of reach"), PhysicsBackend.Raycast(Start, End, Hit));
+
+	const FWallQueryBackend_Rewound Rewound(PhysicsBackend, *History, RewindTime);
+	TestTrue(TEXT("Moved wall is rewound"), Rewound.HasRewoundComponents());
+	TestTrue(TEXT("Rewound wall is hit"), Rewound.Raycast(Start, End, Hit));
+	TestEqual(TEXT("Rewound wall is hit where it was"), Hit.Location.X, 90.0f, 0.1f);
+	TestTrue(TEXT("Rewound hit reports the wall"), Hit.Component == Wall);
+
+	// Nothing to rewind at the current time
+	const FWallQueryBackend_Rewound NotRewound(PhysicsBackend, *History, World->GetTimeSeconds());
+	TestFalse(TEXT("Nothing moved since now"), NotRewound.HasRewoundComponents());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWallGeometryHistoryMovementBaseTest, "ShooterGame.WallRun.GeometryHistory.MovementBase",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWallGeometryHistoryMovementBaseTest::RunTest(const FString& Parameters)
+{
+	using namespace WallGeometryHistoryTests;
+
+	FTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+
+	AWallGeometryHistory* History = AWallGeometryHistory::GetOrCreate(World);
+	if (!TestNotNull(TEXT("History is spawned outside of clients"), History))
+	{
+		return false;
+	}
+
+	float RewindTime = 0.0f;
+	UBoxComponent* Wall = SpawnMovedWall(TestWorld, *History, RewindTime);
+
+	// Character riding the moving wall (e.g. standing on a train it wallruns along) moved with it, the client saw it where it is now
+	ACharacter* Character = World->SpawnActor<ACharacter>(FVector(0.0f, 0.0f, 300.0f), FRotator::ZeroRotator);
+	if (!TestNotNull(TEXT("Character is spawned"), Character))
+	{
+		return false;
+	}
+	Character->SetBase(Wall);
+	TestTrue(TEXT("Character is based on the wall"), Character->GetMovementBase() == Wall);
+
+	const FWallQueryBackend_Physics PhysicsBackend(World, FCollisionQueryParams(SCENE_QUERY_STAT(WallRunTrace), false, Character), ECC_Visibility);
+	const FWallQueryBackend_Rewound Rewound(PhysicsBackend, *History, RewindTime, Character);
+
+	FWallQueryHit Hit;
+	TestFalse(TEXT("Movement base is not rewound"), Rewound.Raycast(FVector::ZeroVector, FVector(200.0f, 0.0f, 0.0f), Hit));
+	TestTrue(TEXT("Movement base is hit where it is now"), Rewound.Raycast(FVector::ZeroVector, FVector(400.0f, 0.0f, 0.0f), Hit));
+	TestEqual(TEXT("Movement base hit location"), Hit.Location.X, 290.0f, 0.1f);
+
+	// Base is looked up per ray, once the character leaves it the wall is rewound again
+	Character->SetBase(nullptr);
+	TestTrue(TEXT("Wall is rewound after leaving it"), Rewound.Raycast(FVector::ZeroVector, FVector(200.0f, 0.0f, 0.0f), Hit));
+	TestEqual(TEXT("Rewound hit location"), Hit.Location.X, 90.0f, 0.1f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWallGeometryHistoryChannelTest, "ShooterGame.WallRun.GeometryHistory.Channel",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWallGeometryHistoryChannelTest::RunTest(const FString& Parameters)
+{
+	using namespace WallGeometryHistoryTests;
+
+	FTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+
+	AWallGeometryHistory* History = AWallGeometryHistory::GetOrCreate(World);
+	if (!TestNotNull(TEXT("History is spawned outside of clients"), History))
+	{
+		return false;
+	}
+
+	// Wall ignores the camera channel, wall detection tracing it must not hit the rewound wall either
+	float RewindTime = 0.0f;
+	UBoxComponent* Wall = SpawnMovedWall(TestWorld, *History, RewindTime, ECC_Camera);
+
+	const FVector Start = FVector::ZeroVector;
+	const FVector End(200.0f, 0.0f, 0.0f);
+	FWallQueryHit Hit;
+
+	const FWallQueryBackend_Physics CameraBackend(World, FCollisionQueryParams(SCENE_QUERY_STAT(WallRunTrace), false), ECC_Camera);
+	const FWallQueryBackend_Rewound CameraRewound(CameraBackend, *History, RewindTime);
+	TestFalse(TEXT("Wall ignoring the channel is not rewound"), CameraRewound.HasRewoundComponents());
+	TestFalse(TEXT("Wall ignoring the channel is not hit"), CameraRewound.Raycast(Start, End, Hit));
+
+	// Object type queries go by the object type of the wall instead
+	FWallQueryBackend_Physics StaticObjectsBackend(World, FCollisionQueryParams(SCENE_QUERY_STAT(WallRunTrace), false), ECC_Visibility);
+	StaticObjectsBackend.ObjectQueryParams = FCollisionObjectQueryParams(ECC_WorldStatic);
+	const FWallQueryBackend_Rewound StaticObjectsRewound(StaticObjectsBackend, *History, RewindTime);
+	TestFalse(TEXT("Wall of another object type is not rewound"), StaticObjectsRewound.HasRewoundComponents());
+
+	FWallQueryBackend_Physics DynamicObjectsBackend(World, FCollisionQueryParams(SCENE_QUERY_STAT(WallRunTrace), false), ECC_Visibility);
+	DynamicObjectsBackend.ObjectQueryParams = FCollisionObjectQueryParams(Wall->GetCollisionObjectType());
+	const FWallQueryBackend_Rewound DynamicObjectsRewound(DynamicObjectsBackend, *History, RewindTime);
+	TestTrue(TEXT("Wall of a queried object type is rewound"), DynamicObjectsRewound.Raycast(Start, End, Hit));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,478 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WallQueryBackend.h"
+#include "Engine/World.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Math/VectorRegister.h"
+#include "HAL/IConsoleManager.h"
+
+
+void IWallQueryBackend::RaycastBatch(TArrayView<const FVector> Starts, TArrayView<const FVector> Ends, TArrayView<FWallQueryHit> OutHits) const
+{
+	check(Starts.Num() == Ends.Num() && Starts.Num() == OutHits.Num());
+	for (int32 i = 0; i < Starts.Num(); i++)
+	{
+		Raycast(Starts[i], Ends[i], OutHits[i]);
+	}
+}
+
+
+FWallQueryBackend_Physics::FWallQueryBackend_Physics(const UWorld* InWorld, const FCollisionQueryParams& InQueryParams, ECollisionChannel InTraceChannel)
+	: World(InWorld)
+	, QueryParams(InQueryParams)
+	, TraceChannel(InTraceChannel)
+{
+
+}
+
+bool FWallQueryBackend_Physics::Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const
+{
+	FHitResult HitResult;
+	const bool bHit = World != nullptr && (ObjectQueryParams.IsValid()
+		? World->LineTraceSingleByObjectType(HitResult, Start, End, ObjectQueryParams, QueryParams)
+		: World->LineTraceSingleByChannel(HitResult, Start, End, TraceChannel, QueryParams));
+	if (!bHit)
+	{
+		OutHit = FWallQueryHit();
+		return false;
+	}
+
+	OutHit.bBlockingHit = HitResult.bBlockingHit;
+	OutHit.Location = HitResult.Location;
+	OutHit.Normal = HitResult.Normal;
+	OutHit.Distance = HitResult.Distance;
+	OutHit.Component = HitResult.GetComponent();
+	OutHit.PhysMaterial = HitResult.PhysMaterial.Get();
+	return OutHit.bBlockingHit;
+}
+
+
+void FWallQueryBackend_Analytic::AddPlane(const FPlane& Plane)
+{
+	Planes.Add(Plane);
+}
+
+void FWallQueryBackend_Analytic::AddBox(const FBox& Box)
+{
+	Boxes.Add(Box);
+}
+
+void FWallQueryBackend_Analytic::AddTriangle(const FVector& A, const FVector& B, const FVector& C)
+{
+	const FVector Edge1 = B - A;
+	const FVector Edge2 = C - A;
+	Triangles.Add({ A, Edge1, Edge2, FVector::CrossProduct(Edge1, Edge2).GetSafeNormal() });
+}
+
+void FWallQueryBackend_Analytic::AddCylinder(const FVector& Base, float Radius, float Height)
+{
+	Cylinders.Add({ Base, Radius, Height });
+}
+
+void FWallQueryBackend_Analytic::Reset()
+{
+	Planes.Reset();
+	Boxes.Reset();
+	Triangles.Reset();
+	Cylinders.Reset();
+}
+
+bool FWallQueryBackend_Analytic::Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const
+{
+	const FVector Delta = End - Start;
+
+	// Closest hit as fraction of Delta
+	float BestTime = 1.0f;
+	FVector BestNormal = FVector::ZeroVector;
+	bool bHit = false;
+
+	for (const FPlane& Plane : Planes)
+	{
+		const FVector PlaneNormal = FVector(Plane);
+		const float Denom = FVector::DotProduct(PlaneNormal, Delta);
+		if (Denom < 0.0f)
+		{
+			const float Time = (Plane.W - FVector::DotProduct(PlaneNormal, Start)) / Denom;
+			if (Time >= 0.0f && Time <= BestTime)
+			{
+				BestTime = Time;
+				BestNormal = PlaneNormal;
+				bHit = true;
+			}
+		}
+	}
+
+	for (const FBox& Box : Boxes)
+	{
+		// Slab test, remember the axis we entered through for the normal
+		float TimeEnter = 0.0f;
+		float TimeExit = 1.0f;
+		int32 EnterAxis = INDEX_NONE;
+		bool bMisses = false;
+		for (int32 Axis = 0; Axis < 3 && !bMisses; Axis++)
+		{
+			if (FMath::IsNearlyZero(Delta[Axis]))
+			{
+				bMisses = Start[Axis] < Box.Min[Axis] || Start[Axis] > Box.Max[Axis];
+				continue;
+			}
+
+			const float InvDelta = 1.0f / Delta[Axis];
+			float TimeNear = (Box.Min[Axis] - Start[Axis]) * InvDelta;
+			float TimeFar = (Box.Max[Axis] - Start[Axis]) * InvDelta;
+			if (TimeNear > TimeFar)
+			{
+				Swap(TimeNear, TimeFar);
+			}
+			if (TimeNear > TimeEnter)
+			{
+				TimeEnter = TimeNear;
+				EnterAxis = Axis;
+			}
+			TimeExit = FMath::Min(TimeExit, TimeFar);
+			bMisses = TimeEnter > TimeExit;
+		}
+
+		// EnterAxis stays unset when the ray starts inside the box
+		if (!bMisses && EnterAxis != INDEX_NONE && TimeEnter <= BestTime)
+		{
+			BestTime = TimeEnter;
+			BestNormal = FVector::ZeroVector;
+			BestNormal[EnterAxis] = Delta[EnterAxis] > 0.0f ? -1.0f : 1.0f;
+			bHit = true;
+		}
+	}
+
+	for (const FTriangle& Triangle : Triangles)
+	{
+		// Moller-Trumbore
+		const FVector P = FVector::CrossProduct(Delta, Triangle.Edge2);
+		const float Det = FVector::DotProduct(Triangle.Edge1, P);
+		if (FMath::Abs(Det) <= SMALL_NUMBER)
+		{
+			continue;
+		}
+
+		const float InvDet = 1.0f / Det;
+		const FVector T = Start - Triangle.A;
+		const float U = FVector::DotProduct(T, P) * InvDet;
+		const FVector Q = FVector::CrossProduct(T, Triangle.Edge1);
+		const float V = FVector::DotProduct(Delta, Q) * InvDet;
+		const float Time = FVector::DotProduct(Triangle.Edge2, Q) * InvDet;
+		if (U >= 0.0f && U <= 1.0f && V >= 0.0f && U + V <= 1.0f && Time >= 0.0f && Time <= BestTime)
+		{
+			// Positive determinant means the ray hits the front face
+			BestTime = Time;
+			BestNormal = Det > 0.0f ? Triangle.Normal : -Triangle.Normal;
+			bHit = true;
+		}
+	}
+
+	bHit |= RaycastCylinders(Start, Delta, BestTime, BestNormal);
+
+	OutHit = FWallQueryHit();
+	if (bHit)
+	{
+		OutHit.bBlockingHit = true;
+		OutHit.Location = Start + Delta * BestTime;
+		OutHit.Normal = BestNormal;
+		OutHit.Distance = Delta.Size() * BestTime;
+	}
+	return bHit;
+}
+
+bool FWallQueryBackend_Analytic::RaycastCylinders(const FVector& Start, const FVector& Delta, float& BestTime, FVector& BestNormal) const
+{
+	bool bHit = false;
+	for (const FCylinder& Cylinder : Cylinders)
+	{
+		// Circle intersection in XY, then check height of the hit
+		const FVector2D RelStart = FVector2D(Start - Cylinder.Base);
+		const FVector2D Delta2D = FVector2D(Delta);
+		const float A = Delta2D.SizeSquared();
+		const float B = 2.0f * FVector2D::DotProduct(RelStart, Delta2D);
+		const float C = RelStart.SizeSquared() - FMath::Square(Cylinder.Radius);
+		const float Discriminant = B * B - 4.0f * A * C;
+		if (C <= 0.0f || A <= SMALL_NUMBER || Discriminant < 0.0f)
+		{
+			continue;
+		}
+
+		const float Time = (-B - FMath::Sqrt(Discriminant)) / (2.0f * A);
+		const float HitZ = Start.Z + Delta.Z * Time;
+		if (Time >= 0.0f && Time <= BestTime && HitZ >= Cylinder.Base.Z && HitZ <= Cylinder.Base.Z + Cylinder.Height)
+		{
+			const FVector2D HitNormal2D = (RelStart + Delta2D * Time).GetSafeNormal();
+			BestTime = Time;
+			BestNormal = FVector(HitNormal2D, 0.0f);
+			bHit = true;
+		}
+	}
+
+	return bHit;
+}
+
+void FWallQueryBackend_Analytic::RaycastBatch(TArrayView<const FVector> Starts, TArrayView<const FVector> Ends, TArrayView<FWallQueryHit> OutHits) const
+{
+	check(Starts.Num() == Ends.Num() && Starts.Num() == OutHits.Num());
+	for (int32 First = 0; First < Starts.Num(); First += 4)
+	{
+		RaycastPacket(&Starts[First], &Ends[First], FMath::Min(4, Starts.Num() - First), &OutHits[First]);
+	}
+}
+
+void FWallQueryBackend_Analytic::RaycastPacket(const FVector* Starts, const FVector* Ends, int32 NumRays, FWallQueryHit* OutHits) const
+{
+	// Rays in structure of arrays layout, one lane per ray. Unused lanes repeat the first ray.
+	MS_ALIGN(16) float RayLanes[6][4] GCC_ALIGN(16);
+	for (int32 Lane = 0; Lane < 4; Lane++)
+	{
+		const int32 Ray = Lane < NumRays ? Lane : 0;
+		const FVector Delta = Ends[Ray] - Starts[Ray];
+		RayLanes[0][Lane] = Starts[Ray].X;
+		RayLanes[1][Lane] = Starts[Ray].Y;
+		RayLanes[2][Lane] = Starts[Ray].Z;
+		RayLanes[3][Lane] = Delta.X;
+		RayLanes[4][Lane] = Delta.Y;
+		RayLanes[5][Lane] = Delta.Z;
+	}
+
+	const VectorRegister StartX = VectorLoadAligned(RayLanes[0]);
+	const VectorRegister StartY = VectorLoadAligned(RayLanes[1]);
+	const VectorRegister StartZ = VectorLoadAligned(RayLanes[2]);
+	const VectorRegister DeltaX = VectorLoadAligned(RayLanes[3]);
+	const VectorRegister DeltaY = VectorLoadAligned(RayLanes[4]);
+	const VectorRegister DeltaZ = VectorLoadAligned(RayLanes[5]);
+
+	const VectorRegister Zero = VectorZero();
+	const VectorRegister One = VectorOne();
+	const VectorRegister MinusOne = VectorNegate(One);
+
+	VectorRegister BestTime = One;
+	VectorRegister BestNormalX = Zero;
+	VectorRegister BestNormalY = Zero;
+	VectorRegister BestNormalZ = Zero;
+	VectorRegister HitMask = Zero;
+
+	auto AcceptHits = [&](const VectorRegister& Mask, const VectorRegister& Time, const VectorRegister& NormalX, const VectorRegister& NormalY, const VectorRegister& NormalZ)
+	{
+		BestTime = VectorSelect(Mask, Time, BestTime);
+		BestNormalX = VectorSelect(Mask, NormalX, BestNormalX);
+		BestNormalY = VectorSelect(Mask, NormalY, BestNormalY);
+		BestNormalZ = VectorSelect(Mask, NormalZ, BestNormalZ);
+		HitMask = VectorBitwiseOr(HitMask, Mask);
+	};
+
+	for (const FPlane& Plane : Planes)
+	{
+		const VectorRegister NormalX = VectorSetFloat1(Plane.X);
+		const VectorRegister NormalY = VectorSetFloat1(Plane.Y);
+		const VectorRegister NormalZ = VectorSetFloat1(Plane.Z);
+
+		const VectorRegister Denom = VectorMultiplyAdd(NormalX, DeltaX, VectorMultiplyAdd(NormalY, DeltaY, VectorMultiply(NormalZ, DeltaZ)));
+		const VectorRegister StartDist = VectorMultiplyAdd(NormalX, StartX, VectorMultiplyAdd(NormalY, StartY, VectorMultiply(NormalZ, StartZ)));
+		const VectorRegister Time = VectorDivide(VectorSubtract(VectorSetFloat1(Plane.W), StartDist), Denom);
+
+		VectorRegister Mask = VectorCompareGT(Zero, Denom);
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(Time, Zero));
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(BestTime, Time));
+		AcceptHits(Mask, Time, NormalX, NormalY, NormalZ);
+	}
+
+	// Axis aligned rays would divide by zero in the slab test, nudge them a tiny bit
+	const VectorRegister MinDelta = VectorSetFloat1(SMALL_NUMBER);
+	auto SafeDelta = [&](const VectorRegister& Delta) { return VectorSelect(VectorCompareGT(VectorAbs(Delta), MinDelta), Delta, MinDelta); };
+	const VectorRegister SafeDeltas[3] = { SafeDelta(DeltaX), SafeDelta(DeltaY), SafeDelta(DeltaZ) };
+	const VectorRegister Starts3[3] = { StartX, StartY, StartZ };
+
+	for (const FBox& Box : Boxes)
+	{
+		VectorRegister TimeEnter = Zero;
+		VectorRegister TimeExit = One;
+		VectorRegister Entered = Zero;
+		VectorRegister EnterNormal[3] = { Zero, Zero, Zero };
+
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			const VectorRegister TimeMin = VectorDivide(VectorSubtract(VectorSetFloat1(Box.Min[Axis]), Starts3[Axis]), SafeDeltas[Axis]);
+			const VectorRegister TimeMax = VectorDivide(VectorSubtract(VectorSetFloat1(Box.Max[Axis]), Starts3[Axis]), SafeDeltas[Axis]);
+			const VectorRegister TimeNear = VectorMin(TimeMin, TimeMax);
+			const VectorRegister TimeFar = VectorMax(TimeMin, TimeMax);
+
+			// Entering through this axis, normal faces against the ray
+			const VectorRegister EnterThisAxis = VectorCompareGT(TimeNear, TimeEnter);
+			const VectorRegister AxisNormal = VectorSelect(VectorCompareGT(SafeDeltas[Axis], Zero), MinusOne, One);
+			for (int32 NormalAxis = 0; NormalAxis < 3; NormalAxis++)
+			{
+				EnterNormal[NormalAxis] = VectorSelect(EnterThisAxis, NormalAxis == Axis ? AxisNormal : Zero, EnterNormal[NormalAxis]);
+			}
+			TimeEnter = VectorSelect(EnterThisAxis, TimeNear, TimeEnter);
+			Entered = VectorBitwiseOr(Entered, EnterThisAxis);
+			TimeExit = VectorMin(TimeExit, TimeFar);
+		}
+
+		// Not entered means the ray starts inside the box
+		VectorRegister Mask = VectorBitwiseAnd(Entered, VectorCompareGE(TimeExit, TimeEnter));
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(BestTime, TimeEnter));
+		AcceptHits(Mask, TimeEnter, EnterNormal[0], EnterNormal[1], EnterNormal[2]);
+	}
+
+	const VectorRegister MinDet = VectorSetFloat1(SMALL_NUMBER);
+	for (const FTriangle& Triangle : Triangles)
+	{
+		// Moller-Trumbore, same as the scalar version
+		const VectorRegister Edge1X = VectorSetFloat1(Triangle.Edge1.X);
+		const VectorRegister Edge1Y = VectorSetFloat1(Triangle.Edge1.Y);
+		const VectorRegister Edge1Z = VectorSetFloat1(Triangle.Edge1.Z);
+		const VectorRegister Edge2X = VectorSetFloat1(Triangle.Edge2.X);
+		const VectorRegister Edge2Y = VectorSetFloat1(Triangle.Edge2.Y);
+		const VectorRegister Edge2Z = VectorSetFloat1(Triangle.Edge2.Z);
+
+		// P = Delta x Edge2
+		const VectorRegister PX = VectorSubtract(VectorMultiply(DeltaY, Edge2Z), VectorMultiply(DeltaZ, Edge2Y));
+		const VectorRegister PY = VectorSubtract(VectorMultiply(DeltaZ, Edge2X), VectorMultiply(DeltaX, Edge2Z));
+		const VectorRegister PZ = VectorSubtract(VectorMultiply(DeltaX, Edge2Y), VectorMultiply(DeltaY, Edge2X));
+		const VectorRegister Det = VectorMultiplyAdd(Edge1X, PX, VectorMultiplyAdd(Edge1Y, PY, VectorMultiply(Edge1Z, PZ)));
+		const VectorRegister InvDet = VectorDivide(One, Det);
+
+		// T = Start - A
+		const VectorRegister TX = VectorSubtract(StartX, VectorSetFloat1(Triangle.A.X));
+		const VectorRegister TY = VectorSubtract(StartY, VectorSetFloat1(Triangle.A.Y));
+		const VectorRegister TZ = VectorSubtract(StartZ, VectorSetFloat1(Triangle.A.Z));
+		const VectorRegister U = VectorMultiply(VectorMultiplyAdd(TX, PX, VectorMultiplyAdd(TY, PY, VectorMultiply(TZ, PZ))), InvDet);
+
+		// Q = T x Edge1
+		const VectorRegister QX = VectorSubtract(VectorMultiply(TY, Edge1Z), VectorMultiply(TZ, Edge1Y));
+		const VectorRegister QY = VectorSubtract(VectorMultiply(TZ, Edge1X), VectorMultiply(TX, Edge1Z));
+		const VectorRegister QZ = VectorSubtract(VectorMultiply(TX, Edge1Y), VectorMultiply(TY, Edge1X));
+		const VectorRegister V = VectorMultiply(VectorMultiplyAdd(DeltaX, QX, VectorMultiplyAdd(DeltaY, QY, VectorMultiply(DeltaZ, QZ))), InvDet);
+		const VectorRegister Time = VectorMultiply(VectorMultiplyAdd(Edge2X, QX, VectorMultiplyAdd(Edge2Y, QY, VectorMultiply(Edge2Z, QZ))), InvDet);
+
+		VectorRegister Mask = VectorCompareGT(VectorAbs(Det), MinDet);
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(U, Zero));
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(One, U));
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(V, Zero));
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(One, VectorAdd(U, V)));
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(Time, Zero));
+		Mask = VectorBitwiseAnd(Mask, VectorCompareGE(BestTime, Time));
+
+		const VectorRegister FrontFace = VectorCompareGT(Det, Zero);
+		const VectorRegister NormalX = VectorSetFloat1(Triangle.Normal.X);
+		const VectorRegister NormalY = VectorSetFloat1(Triangle.Normal.Y);
+		const VectorRegister NormalZ = VectorSetFloat1(Triangle.Normal.Z);
+		AcceptHits(Mask, Time, VectorSelect(FrontFace, NormalX, VectorNegate(NormalX)), VectorSelect(FrontFace, NormalY, VectorNegate(NormalY)), VectorSelect(FrontFace, NormalZ, VectorNegate(NormalZ)));
+	}
+
+	MS_ALIGN(16) float ResultLanes[4][4] GCC_ALIGN(16);
+	VectorStoreAligned(BestTime, ResultLanes[0]);
+	VectorStoreAligned(BestNormalX, ResultLanes[1]);
+	VectorStoreAligned(BestNormalY, ResultLanes[2]);
+	VectorStoreAligned(BestNormalZ, ResultLanes[3]);
+	const int32 HitBits = VectorMaskBits(HitMask);
+
+	for (int32 Lane = 0; Lane < NumRays; Lane++)
+	{
+		const FVector Delta = Ends[Lane] - Starts[Lane];
+		float Time = ResultLanes[0][Lane];
+		FVector Normal = FVector(ResultLanes[1][Lane], ResultLanes[2][Lane], ResultLanes[3][Lane]);
+		bool bHit = (HitBits & (1 << Lane)) != 0;
+
+		// Few cylinders and no cheap SIMD form worth having, finish those per ray
+		bHit |= RaycastCylinders(Starts[Lane], Delta, Time, Normal);
+
+		FWallQueryHit& OutHit = OutHits[Lane];
+		OutHit = FWallQueryHit();
+		if (bHit)
+		{
+			OutHit.bBlockingHit = true;
+			OutHit.Location = Starts[Lane] + Delta * Time;
+			OutHit.Normal = Normal;
+			OutHit.Distance = Delta.Size() * Time;
+		}
+	}
+}
+
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+static void BenchmarkWallQueries(const TArray<FString>& Args)
+{
+	const int32 NumFans = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+	const int32 RaysPerFan = 12;
+	const float RayLength = 200.0f;
+
+	// Random level-like geometry around the origin
+	FRandomStream Random(1234);
+	FWallQueryBackend_Analytic Backend;
+	for (int32 i = 0; i < 64; i++)
+	{
+		const FVector Center = Random.GetUnitVector() * FVector(3000.0f, 3000.0f, 200.0f);
+		Backend.AddBox(FBox::BuildAABB(Center, FVector(Random.FRandRange(20.0f, 400.0f), Random.FRandRange(20.0f, 400.0f), Random.FRandRange(100.0f, 600.0f))));
+	}
+	for (int32 i = 0; i < 256; i++)
+	{
+		const FVector A = Random.GetUnitVector() * FVector(3000.0f, 3000.0f, 200.0f);
+		Backend.AddTriangle(A, A + Random.GetUnitVector() * 300.0f, A + Random.GetUnitVector() * 300.0f);
+	}
+	for (int32 i = 0; i < 8; i++)
+	{
+		Backend.AddCylinder(Random.GetUnitVector() * FVector(3000.0f, 3000.0f, 0.0f), Random.FRandRange(50.0f, 300.0f), 1000.0f);
+	}
+	Backend.AddPlane(FPlane(FVector(0.0f, 0.0f, 1.0f), -500.0f));
+
+	TArray<FVector> Starts;
+	TArray<FVector> Ends;
+	Starts.SetNum(NumFans * RaysPerFan);
+	Ends.SetNum(NumFans * RaysPerFan);
+	for (int32 Fan = 0; Fan < NumFans; Fan++)
+	{
+		const FVector Origin = Random.GetUnitVector() * FVector(3000.0f, 3000.0f, 200.0f);
+		const float Yaw = Random.FRandRange(0.0f, 360.0f);
+		for (int32 Ray = 0; Ray < RaysPerFan; Ray++)
+		{
+			Starts[Fan * RaysPerFan + Ray] = Origin;
+			Ends[Fan * RaysPerFan + Ray] = Origin + FRotator(0.0f, Yaw + Ray * (360.0f / RaysPerFan), 0.0f).Vector() * RayLength;
+		}
+	}
+
+	TArray<FWallQueryHit> ScalarHits;
+	TArray<FWallQueryHit> BatchedHits;
+	ScalarHits.SetNum(Starts.Num());
+	BatchedHits.SetNum(Starts.Num());
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Starts.Num(); i++)
+	{
+		Backend.Raycast(Starts[i], Ends[i], ScalarHits[i]);
+	}
+	const double ScalarTime = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Fan = 0; Fan < NumFans; Fan++)
+	{
+		const int32 First = Fan * RaysPerFan;
+		Backend.RaycastBatch(MakeArrayView(&Starts[First], RaysPerFan), MakeArrayView(&Ends[First], RaysPerFan), MakeArrayView(&BatchedHits[First], RaysPerFan));
+	}
+	const double BatchedTime = FPlatformTime::Seconds() - StartTime;
+
+	// Batched results have to match the scalar reference
+	int32 NumHits = 0;
+	int32 NumMismatches = 0;
+	for (int32 i = 0; i < Starts.Num(); i++)
+	{
+		NumHits += ScalarHits[i].bBlockingHit ? 1 : 0;
+		if (ScalarHits[i].bBlockingHit != BatchedHits[i].bBlockingHit
+			|| (ScalarHits[i].bBlockingHit && (!FMath::IsNearlyEqual(ScalarHits[i].Distance, BatchedHits[i].Distance, 0.01f) || !ScalarHits[i].Normal.Equals(BatchedHits[i].Normal, 0.001f))))
+		{
+			NumMismatches++;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("WallRun.BenchmarkWallQueries - %d fans, %d rays, %d hits. Scalar: %.2f ms (%.0f fans/s), Batched: %.2f ms (%.0f fans/s), %d mismatches"),
+		NumFans, Starts.Num(), NumHits, ScalarTime * 1000.0, NumFans / ScalarTime, BatchedTime * 1000.0, NumFans / BatchedTime, NumMismatches);
+}
+
+static FAutoConsoleCommand CmdWallRunBenchmarkWallQueries(TEXT("WallRun.BenchmarkWallQueries"),
+	TEXT("Compares scalar and batched (SIMD) analytic wall queries on random geometry. Usage: WallRun.BenchmarkWallQueries [NumFans]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkWallQueries));
+#endif
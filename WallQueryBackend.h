@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Engine/EngineTypes.h"
+
+class UPhysicalMaterial;
+
+
+/** Result of a single wall query ray */
+struct FWallQueryHit
+{
+	bool bBlockingHit = false;
+	FVector Location = FVector::ZeroVector;
+	FVector Normal = FVector::ZeroVector;
+	float Distance = 0.0f;
+
+	/** Component that was hit, only known to backends tracing the physics scene (baked and analytic geometry is static) */
+	UPrimitiveComponent* Component = nullptr;
+
+	/** Physical material at the hit, only known to backends tracing the physics scene with QueryParams.bReturnPhysicalMaterial */
+	UPhysicalMaterial* PhysMaterial = nullptr;
+};
+
+
+/**
+ * Answers ray queries for wall detection (UShooterCharacterMovement::TraceNearbyForWalls).
+ * Detection normally runs against the physics scene, but can be pointed at any other geometry source,
+ * so the detection logic can be benchmarked and tested without a level loaded.
+ */
+class SHOOTERGAME_API IWallQueryBackend
+{
+public:
+	virtual ~IWallQueryBackend() {}
+
+	/** Finds the closest blocking hit along Start -> End. Returns true if anything was hit. */
+	virtual bool Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const = 0;
+
+	/** Casts Starts[i] -> Ends[i] for all rays at once. Default implementation calls Raycast for each of them. */
+	virtual void RaycastBatch(TArrayView<const FVector> Starts, TArrayView<const FVector> Ends, TArrayView<FWallQueryHit> OutHits) const;
+
+	/** True if RaycastBatch is cheaper than casting the rays one by one, even when the caller could have stopped after the first hit */
+	virtual bool PrefersBatchedRaycasts() const { return false; }
+};
+
+
+/** Traces against the physics scene of a world */
+class SHOOTERGAME_API FWallQueryBackend_Physics : public IWallQueryBackend
+{
+public:
+	FWallQueryBackend_Physics() {}
+	FWallQueryBackend_Physics(const UWorld* InWorld, const FCollisionQueryParams& InQueryParams, ECollisionChannel InTraceChannel = ECC_Visibility);
+
+	virtual bool Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const override;
+
+	const UWorld* World = nullptr;
+	FCollisionQueryParams QueryParams;
+	ECollisionChannel TraceChannel = ECC_Visibility;
+
+	/** If any object type is set, traces by object type and TraceChannel is ignored */
+	FCollisionObjectQueryParams ObjectQueryParams;
+};
+
+
+/** Forwards queries to another backend and counts the rays (e.g. for replay benchmarks) */
+class SHOOTERGAME_API FWallQueryBackend_Counting : public IWallQueryBackend
+{
+public:
+	explicit FWallQueryBackend_Counting(const IWallQueryBackend& InInner) : Inner(InInner) {}
+
+	virtual bool Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const override
+	{
+		NumRaysCast++;
+		return Inner.Raycast(Start, End, OutHit);
+	}
+
+	virtual void RaycastBatch(TArrayView<const FVector> Starts, TArrayView<const FVector> Ends, TArrayView<FWallQueryHit> OutHits) const override
+	{
+		NumRaysCast += Starts.Num();
+		Inner.RaycastBatch(Starts, Ends, OutHits);
+	}
+
+	virtual bool PrefersBatchedRaycasts() const override { return Inner.PrefersBatchedRaycasts(); }
+
+	mutable int32 NumRaysCast = 0;
+
+private:
+	const IWallQueryBackend& Inner;
+};
+
+
+/**
+ * In-memory analytic geometry (planes, axis aligned boxes, triangles and vertical cylinders), no world or physics needed.
+ * Only the faces rays can hit from outside are considered (back faces and rays starting inside a shape don't hit). Triangles are two sided.
+ *
+ * Raycast is the scalar reference. RaycastBatch intersects packets of 4 rays at once with SIMD, it is meant for offline tooling
+ * (bot training, level validation) which runs huge numbers of detection queries. Both return the same hits.
+ */
+class SHOOTERGAME_API FWallQueryBackend_Analytic : public IWallQueryBackend
+{
+public:
+	/** Infinite one sided plane, hit from the side its normal points to */
+	void AddPlane(const FPlane& Plane);
+
+	void AddBox(const FBox& Box);
+
+	void AddTriangle(const FVector& A, const FVector& B, const FVector& C);
+
+	/** Vertical cylinder standing on Base. Only the side is wallrunnable, caps are ignored. */
+	void AddCylinder(const FVector& Base, float Radius, float Height);
+
+	void Reset();
+
+	virtual bool Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const override;
+	virtual void RaycastBatch(TArrayView<const FVector> Starts, TArrayView<const FVector> Ends, TArrayView<FWallQueryHit> OutHits) const override;
+	virtual bool PrefersBatchedRaycasts() const override { return true; }
+
+private:
+	/** Intersects up to 4 rays with planes, boxes and triangles using SIMD */
+	void RaycastPacket(const FVector* Starts, const FVector* Ends, int32 NumRays, FWallQueryHit* OutHits) const;
+
+	/** Closest hit of a single ray against cylinders, updates BestTime and BestNormal if closer */
+	bool RaycastCylinders(const FVector& Start, const FVector& Delta, float& BestTime, FVector& BestNormal) const;
+
+	struct FTriangle
+	{
+		FVector A;
+		FVector Edge1;
+		FVector Edge2;
+		FVector Normal;
+	};
+
+	struct FCylinder
+	{
+		FVector Base;
+		float Radius;
+		float Height;
+	};
+
+	TArray<FPlane> Planes;
+	TArray<FBox> Boxes;
+	TArray<FTriangle> Triangles;
+	TArray<FCylinder> Cylinders;
+};
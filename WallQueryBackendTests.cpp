@@ -0,0 +1,224 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterCharacterMovement.h"
+#include "WallQueryBackend.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace WallQueryBackendTests
+{
+	/** Detection settings of the UShooterCharacterMovement defaults, no component or world needed */
+	struct FDetectionSettings
+	{
+		int32 NumberOfRaysPerSide = 0;
+		float WallDetectDistance = 0.0f;
+		float TopOffset = 0.0f;
+		float FeetOffset = 0.0f;
+		// Rays reach past WallDetectDistance, so hits beyond it are covered too
+		float RayLength = 0.0f;
+
+		FDetectionSettings()
+		{
+			const UShooterCharacterMovement* Defaults = GetDefault<UShooterCharacterMovement>();
+			NumberOfRaysPerSide = Defaults->NumberOfRaysPerSide;
+			WallDetectDistance = Defaults->WallDetectDistance;
+			TopOffset = Defaults->FirstTraceTopOffset;
+			FeetOffset = Defaults->FallbackTraceTopOffset;
+			RayLength = WallDetectDistance * 2.0f;
+		}
+	};
+
+	/** Same angles as UShooterCharacterMovement::InitWallRunTraceContext */
+	TArray<FVector2D> MakeRayRotations(const FDetectionSettings& Settings)
+	{
+		TArray<FVector2D> RayRotations;
+		const float TargetAngle = 180.0f / Settings.NumberOfRaysPerSide + 1;
+		for (int32 i = 1; i < Settings.NumberOfRaysPerSide; i++)
+		{
+			float Sin, Cos;
+			FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(TargetAngle * i));
+			RayRotations.Add(FVector2D(Cos, Sin));
+		}
+		return RayRotations;
+	}
+
+	FWallFanQuery MakeQuery(const FDetectionSettings& Settings, TArrayView<const FVector2D> RayRotations, EWallRunSide Side, bool bFallbackToFeetLevel)
+	{
+		FWallFanQuery Query;
+		Query.Origin = FVector::ZeroVector;
+		Query.Forward = FVector::ForwardVector;
+		Query.Direction = Side == EWallRunSide::Left ? -1.0f : 1.0f;
+		Query.RayLength = Settings.RayLength;
+		Query.WallDetectDistance = Settings.WallDetectDistance;
+		Query.FirstTraceTopOffset = Settings.TopOffset;
+		Query.FallbackTraceTopOffset = Settings.FeetOffset;
+		Query.bFallbackToFeetLevel = bFallbackToFeetLevel;
+		Query.RayRotations = RayRotations;
+		return Query;
+	}
+
+	/** Hides batching of the inner backend, so TraceWallFan takes the ray by ray path */
+	class FScalarOnlyBackend : public IWallQueryBackend
+	{
+	public:
+		explicit FScalarOnlyBackend(const IWallQueryBackend& InInner) : Inner(InInner) {}
+
+		virtual bool Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const override
+		{
+			return Inner.Raycast(Start, End, OutHit);
+		}
+
+	private:
+		const IWallQueryBackend& Inner;
+	};
+
+	/** Wall parallel to the forward axis, half of WallDetectDistance to the right of the character */
+	void AddRightWall(const FDetectionSettings& Settings, FWallQueryBackend_Analytic& Backend)
+	{
+		Backend.AddPlane(FPlane(FVector(0.0f, -1.0f, 0.0f), -0.5f * Settings.WallDetectDistance));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWallRunFanTraceAnalyticTest, "ShooterGame.WallRun.FanTrace.Analytic",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWallRunFanTraceAnalyticTest::RunTest(const FString& Parameters)
+{
+	using namespace WallQueryBackendTests;
+
+	const FDetectionSettings Settings;
+	const TArray<FVector2D> RayRotations = MakeRayRotations(Settings);
+	auto IgnoreRay = [](const FWallQueryHit&) {};
+
+	FWallQueryBackend_Analytic Backend;
+	AddRightWall(Settings, Backend);
+	const float WallY = 0.5f * Settings.WallDetectDistance;
+
+	// With the default fan the first ray reaches the wall past WallDetectDistance, the second one is the first to count
+	FWallQueryHit Hit;
+	const bool bFoundRight = UShooterCharacterMovement::TraceWallFan(Backend, MakeQuery(Settings, RayRotations, EWallRunSide::Right, false), Hit, IgnoreRay);
+	TestTrue(TEXT("Wall on the right is found"), bFoundRight);
+	TestTrue(TEXT("Hit normal faces the character"), Hit.Normal.Equals(FVector(0.0f, -1.0f, 0.0f), KINDA_SMALL_NUMBER));
+	TestEqual(TEXT("Hit is on the wall"), Hit.Location.Y, WallY, KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("Highest priority ray within WallDetectDistance wins"), Hit.Distance, WallY / RayRotations[1].Y, 0.01f);
+
+	FWallQueryHit LeftHit;
+	TestFalse(TEXT("Nothing is found on the left"), UShooterCharacterMovement::TraceWallFan(Backend, MakeQuery(Settings, RayRotations, EWallRunSide::Left, true), LeftHit, IgnoreRay));
+
+	// Ray by ray and batched fans pick the same wall for every kind of shape, with and without the feet level fallback.
+	// Shapes span both trace levels with a margin, except for the low box which ends between them.
+	const float Bottom = Settings.FeetOffset - 100.0f;
+	const float Top = Settings.TopOffset + 100.0f;
+	const float BetweenLevels = 0.5f * (Settings.FeetOffset + Settings.TopOffset);
+	struct FShapeCase
+	{
+		const TCHAR* Name;
+		TFunction<void(FWallQueryBackend_Analytic&)> Add;
+	};
+	const FShapeCase Shapes[] =
+	{
+		{ TEXT("Plane"), [&Settings](FWallQueryBackend_Analytic& B) { AddRightWall(Settings, B); } },
+		{ TEXT("Box"), [=](FWallQueryBackend_Analytic& B) { B.AddBox(FBox(FVector(-500.0f, 60.0f, Bottom), FVector(500.0f, 100.0f, Top))); } },
+		{ TEXT("Low box"), [=](FWallQueryBackend_Analytic& B) { B.AddBox(FBox(FVector(-500.0f, 60.0f, Bottom), FVector(500.0f, 100.0f, BetweenLevels))); } },
+		{ TEXT("Triangle"), [=](FWallQueryBackend_Analytic& B) { B.AddTriangle(FVector(-1000.0f, 70.0f, Bottom), FVector(1000.0f, 70.0f, Bottom), FVector(0.0f, 70.0f, Top + 1000.0f)); } },
+		{ TEXT("Cylinder"), [=](FWallQueryBackend_Analytic& B) { B.AddCylinder(FVector(40.0f, 120.0f, Bottom), 60.0f, Top - Bottom); } },
+	};
+
+	for (const FShapeCase& Shape : Shapes)
+	{
+		FWallQueryBackend_Analytic ShapeBackend;
+		Shape.Add(ShapeBackend);
+		const FScalarOnlyBackend ScalarBackend(ShapeBackend);
+
+		for (int32 Fallback = 0; Fallback < 2; Fallback++)
+		{
+			const FWallFanQuery Query = MakeQuery(Settings, RayRotations, EWallRunSide::Right, Fallback != 0);
+
+			FWallQueryHit ScalarHit;
+			FWallQueryHit BatchedHit;
+			const bool bScalarFound = UShooterCharacterMovement::TraceWallFan(ScalarBackend, Query, ScalarHit, IgnoreRay);
+			const bool bBatchedFound = UShooterCharacterMovement::TraceWallFanBatched(ShapeBackend, Query, BatchedHit, IgnoreRay);
+
+			const FString Context = FString::Printf(TEXT("%s, fallback %d"), Shape.Name, Fallback);
+			TestTrue(*FString::Printf(TEXT("%s: same wall found"), *Context), bBatchedFound == bScalarFound);
+			if (bScalarFound && bBatchedFound)
+			{
+				TestTrue(*FString::Printf(TEXT("%s: same hit location"), *Context), BatchedHit.Location.Equals(ScalarHit.Location, 0.01f));
+				TestTrue(*FString::Printf(TEXT("%s: same hit normal"), *Context), BatchedHit.Normal.Equals(ScalarHit.Normal, 0.001f));
+			}
+		}
+	}
+
+	// The low box is below the first trace level and only found by the feet level fallback
+	{
+		FWallQueryBackend_Analytic LowBackend;
+		Shapes[2].Add(LowBackend);
+		FWallQueryHit LowHit;
+		TestFalse(TEXT("Low wall is not found without fallback"), UShooterCharacterMovement::TraceWallFan(LowBackend, MakeQuery(Settings, RayRotations, EWallRunSide::Right, false), LowHit, IgnoreRay));
+		TestTrue(TEXT("Low wall is found with fallback"), UShooterCharacterMovement::TraceWallFan(LowBackend, MakeQuery(Settings, RayRotations, EWallRunSide::Right, true), LowHit, IgnoreRay));
+		TestEqual(TEXT("Low wall is hit at feet level"), LowHit.Location.Z, Settings.FeetOffset, KINDA_SMALL_NUMBER);
+	}
+
+	// Start direction filters
+	const FVector RunDirection = FVector::ForwardVector;
+	TestTrue(TEXT("Looking along the wall starts"), UShooterCharacterMovement::IsValidWallRunStartDirection(FVector::ForwardVector, FVector(300.0f, 0.0f, 0.0f), RunDirection, 60.0f, true));
+	TestFalse(TEXT("Looking away from run direction does not start"), UShooterCharacterMovement::IsValidWallRunStartDirection(FVector::RightVector, FVector(300.0f, 0.0f, 0.0f), RunDirection, 60.0f, false));
+	TestFalse(TEXT("Moving backwards does not start"), UShooterCharacterMovement::IsValidWallRunStartDirection(FVector::ForwardVector, FVector(-300.0f, 0.0f, 0.0f), RunDirection, 60.0f, true));
+	TestTrue(TEXT("Moving backwards starts when allowed"), UShooterCharacterMovement::IsValidWallRunStartDirection(FVector::ForwardVector, FVector(-300.0f, 0.0f, 0.0f), RunDirection, 60.0f, false));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWallRunFanTraceCountingTest, "ShooterGame.WallRun.FanTrace.Counting",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWallRunFanTraceCountingTest::RunTest(const FString& Parameters)
+{
+	using namespace WallQueryBackendTests;
+
+	const FDetectionSettings Settings;
+	const TArray<FVector2D> RayRotations = MakeRayRotations(Settings);
+	const int32 NumRays = RayRotations.Num();
+
+	FWallQueryBackend_Analytic WallBackend;
+	AddRightWall(Settings, WallBackend);
+	FWallQueryBackend_Analytic EmptyBackend;
+
+	auto CountRays = [&Settings, &RayRotations](const IWallQueryBackend& Inner, EWallRunSide Side, bool bFallbackToFeetLevel, bool bStopAtFirstWall, int32& OutNumRaysTraced)
+	{
+		FWallQueryBackend_Counting Counting(Inner);
+		FWallFanQuery Query = MakeQuery(Settings, RayRotations, Side, bFallbackToFeetLevel);
+		Query.bStopAtFirstWall = bStopAtFirstWall;
+
+		int32 NumRaysTraced = 0;
+		FWallQueryHit Hit;
+		UShooterCharacterMovement::TraceWallFan(Counting, Query, Hit, [&NumRaysTraced](const FWallQueryHit&) { NumRaysTraced++; });
+		OutNumRaysTraced = NumRaysTraced;
+		return Counting.NumRaysCast;
+	};
+
+	int32 NumRaysTraced = 0;
+
+	// Ray by ray stops at the second ray, which is the first one within WallDetectDistance
+	const FScalarOnlyBackend ScalarWall(WallBackend);
+	TestEqual(TEXT("Ray by ray stops at the first wall"), CountRays(ScalarWall, EWallRunSide::Right, true, true, NumRaysTraced), 2);
+	TestEqual(TEXT("Ray by ray reports every traced ray"), NumRaysTraced, 2);
+	TestEqual(TEXT("Ray by ray traces the whole fan when asked to"), CountRays(ScalarWall, EWallRunSide::Right, false, false, NumRaysTraced), NumRays);
+
+	// Missing on both levels costs two rays per angle
+	const FScalarOnlyBackend ScalarEmpty(EmptyBackend);
+	TestEqual(TEXT("Ray by ray miss without fallback"), CountRays(ScalarEmpty, EWallRunSide::Left, false, true, NumRaysTraced), NumRays);
+	TestEqual(TEXT("Ray by ray miss with fallback"), CountRays(ScalarEmpty, EWallRunSide::Left, true, true, NumRaysTraced), NumRays * 2);
+
+	// Analytic backend prefers batches, the whole fan is cast even though the first wall is found early
+	TestEqual(TEXT("Batched casts the whole fan"), CountRays(WallBackend, EWallRunSide::Right, false, true, NumRaysTraced), NumRays);
+	TestEqual(TEXT("Batched stops reporting at the first wall"), NumRaysTraced, 2);
+	TestEqual(TEXT("Batched fallback casts the fan twice"), CountRays(EmptyBackend, EWallRunSide::Left, true, true, NumRaysTraced), NumRays * 2);
+	TestEqual(TEXT("Batched miss reports every ray"), NumRaysTraced, NumRays);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,447 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WallRunNavLinks.h"
+#include "WallRunSurfaceIndex.h"
+#include "ShooterCharacterMovement.h"
+#include "ShooterCharacter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Components/CapsuleComponent.h"
+#include "AI/NavigationSystemBase.h"
+#include "AI/NavigationSystemHelpers.h"
+#include "AI/Navigation/NavigationRelevantData.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/IConsoleManager.h"
+
+
+AWallRunNavLinks::AWallRunNavLinks(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Baked data is loaded with the level on every machine, nothing to replicate
+	SetReplicates(false);
+}
+
+void AWallRunNavLinks::PostLoad()
+{
+	Super::PostLoad();
+	BuildPointLinks();
+}
+
+void AWallRunNavLinks::BuildPointLinks()
+{
+	PointLinks.Reset(Links.Num());
+	for (const FWallRunNavLink& Link : Links)
+	{
+		FNavigationLink& PointLink = PointLinks.Add_GetRef(FNavigationLink(Link.Start, Link.End));
+		PointLink.Direction = ENavLinkDirection::LeftToRight;
+		if (LinkArea)
+		{
+			PointLink.SetAreaClass(LinkArea);
+		}
+	}
+}
+
+void AWallRunNavLinks::GetNavigationData(FNavigationRelevantData& Data) const
+{
+	NavigationHelper::ProcessNavLinkAndAppend(&Data.Modifiers, this, PointLinks);
+}
+
+FBox AWallRunNavLinks::GetNavigationBounds() const
+{
+	FBox Bounds(ForceInit);
+	for (const FWallRunNavLink& Link : Links)
+	{
+		Bounds += Link.Start;
+		Bounds += Link.End;
+	}
+	return Bounds;
+}
+
+bool AWallRunNavLinks::IsNavigationRelevant() const
+{
+	return PointLinks.Num() > 0;
+}
+
+bool AWallRunNavLinks::GetNavigationLinksClasses(TArray<TSubclassOf<UNavLinkDefinition>>& OutClasses) const
+{
+	return false;
+}
+
+bool AWallRunNavLinks::GetNavigationLinksArray(TArray<FNavigationLink>& OutLink, TArray<FNavigationSegmentLink>& OutSegments) const
+{
+	OutLink.Append(PointLinks);
+	return PointLinks.Num() > 0;
+}
+
+
+#if WITH_EDITOR
+namespace WallRunNavLinks
+{
+	/** Sampled wallrun entry, a point on a baked wall and the ground a bot jumps at it from */
+	struct FCandidate
+	{
+		FVector WallPoint;
+		FVector WallNormal;
+		FVector GroundPoint;
+		EWallRunSide Side;
+	};
+
+	/** Read only state shared by all simulations of a bake */
+	struct FSimContext
+	{
+		const AWallRunNavLinks* Settings = nullptr;
+		const UShooterCharacterMovement* Movement = nullptr;
+		const IWallQueryBackend* Walls = nullptr;
+		// Baked walls have no materials, surfaces are probed in the physics scene the way wall detection traces it
+		FWallQueryBackend_Physics SurfaceProbe;
+		const UWorld* World = nullptr;
+		FCollisionQueryParams QueryParams;
+		ECollisionChannel GroundChannel = ECC_Pawn;
+
+		float CapsuleRadius = 0.0f;
+		float CapsuleHalfHeight = 0.0f;
+		float GravityZ = 0.0f;
+	};
+
+	const float SimTimeStep = 1.0f / 60.0f;
+	const float MaxWallRunTime = 5.0f;
+
+	/** Falls with full gravity from Location (capsule center), returns true if it lands on walkable ground above MinZ */
+	bool SimulateFall(const FSimContext& Context, FVector Location, FVector Velocity, float MinZ, FVector& OutLanding, float& OutTime)
+	{
+		const FVector FeetOffset(0.0f, 0.0f, -Context.CapsuleHalfHeight);
+		float Time = 0.0f;
+		while (Location.Z > MinZ && Time < MaxWallRunTime)
+		{
+			const FVector PrevLocation = Location;
+			Location += Velocity * SimTimeStep + FVector(0.0f, 0.0f, 0.5f * Context.GravityZ * SimTimeStep * SimTimeStep);
+			Velocity.Z += Context.GravityZ * SimTimeStep;
+			Time += SimTimeStep;
+
+			FHitResult Hit;
+			if (Context.World->LineTraceSingleByChannel(Hit, PrevLocation + FeetOffset, Location + FeetOffset, Context.GroundChannel, Context.QueryParams))
+			{
+				OutLanding = Hit.ImpactPoint;
+				OutTime = Time;
+				return Hit.ImpactNormal.Z >= Context.Movement->GetWalkableFloorZ();
+			}
+		}
+		return false;
+	}
+
+	/** Surface tuning of the candidate's wall, resolved once per wallrun like UShooterCharacterMovement::ResolveWallRunSurface */
+	FWallRunSurfaceParams ResolveSurface(const FSimContext& Context, const FCandidate& Candidate)
+	{
+		const UShooterCharacterMovement& Movement = *Context.Movement;
+		FWallQueryHit Hit;
+		if (Movement.WallRunSurfaceOverrides.Num() > 0
+			&& Context.SurfaceProbe.Raycast(Candidate.WallPoint + Candidate.WallNormal * Context.CapsuleRadius, Candidate.WallPoint - Candidate.WallNormal * Context.CapsuleRadius, Hit))
+		{
+			if (const FWallRunSurfaceParams* Params = Movement.WallRunSurfaceOverrides.Find(Hit.PhysMaterial))
+			{
+				return *Params;
+			}
+		}
+		return FWallRunSurfaceParams();
+	}
+
+	/**
+	 * Runs the candidate's wallrun along the baked walls with the wallrun physics (see UShooterCharacterMovement::StepWallRunSimulation),
+	 * trying a wall jump every JumpSampleInterval and riding it out at the end. Adds a link for every exit that lands.
+	 */
+	void SimulateCandidate(const FSimContext& Context, const FCandidate& Candidate, TArray<FWallRunNavLink>& OutLinks, int32& OutNumSimulated)
+	{
+		const UShooterCharacterMovement& Movement = *Context.Movement;
+		const AWallRunNavLinks& Settings = *Context.Settings;
+		const float MinZ = Candidate.GroundPoint.Z - Settings.MaxFallHeight;
+
+		// Jump from the ground reaches the wall point at this speed
+		const float EntryHeight = Candidate.WallPoint.Z - (Candidate.GroundPoint.Z + Context.CapsuleHalfHeight);
+		const float EntryZSquared = FMath::Square(Movement.JumpZVelocity) + 2.0f * Context.GravityZ * EntryHeight;
+		const float JumpTime = (Movement.JumpZVelocity - FMath::Sqrt(FMath::Max(EntryZSquared, 0.0f))) / -Context.GravityZ;
+
+		FWallRunSimState Sim;
+		Sim.Surface = ResolveSurface(Context, Candidate);
+		Sim.TimeRemaining = Movement.WallRunDuration * Sim.Surface.DurationScale;
+		const float MaxSpeed = Movement.WallRunSpeed * Sim.Surface.SpeedScale;
+
+		FVector WallNormal = Candidate.WallNormal;
+		FVector RunDirection = Movement.GetWallRunForwardDirection(Candidate.Side, WallNormal).GetSafeNormal2D();
+		Sim.Location = Candidate.WallPoint + WallNormal * Context.CapsuleRadius;
+		Sim.Velocity = RunDirection * MaxSpeed;
+		Sim.Velocity.Z = FMath::Max(FMath::Sqrt(FMath::Max(EntryZSquared, 0.0f)), Movement.WallRunStartZVelocity);
+
+		float WallRunTime = 0.0f;
+		float NextJumpTime = Settings.JumpSampleInterval;
+
+		auto AddLink = [&](const FVector& End, float AirTime, bool bWallJump)
+		{
+			if (FVector::DistSquared2D(Candidate.GroundPoint, End) >= FMath::Square(Settings.MinLinkLength))
+			{
+				FWallRunNavLink& Link = OutLinks.AddDefaulted_GetRef();
+				Link.Start = Candidate.GroundPoint;
+				Link.End = End;
+				Link.Side = Candidate.Side;
+				Link.WallRunTime = WallRunTime;
+				Link.Cost = JumpTime + WallRunTime + AirTime;
+				Link.bWallJump = bWallJump;
+			}
+		};
+
+		while (WallRunTime < MaxWallRunTime)
+		{
+			// Wall jump from here
+			if (WallRunTime >= NextJumpTime)
+			{
+				NextJumpTime += Settings.JumpSampleInterval;
+				const float AwayFromWall = Candidate.Side == EWallRunSide::Left ? Settings.JumpAimAngle : -Settings.JumpAimAngle;
+				const FVector Aim = RunDirection.RotateAngleAxis(AwayFromWall, FVector::UpVector);
+
+				FVector Landing;
+				float AirTime = 0.0f;
+				OutNumSimulated++;
+				if (SimulateFall(Context, Sim.Location, Movement.CalcWallRunJumpVelocity(Sim.Velocity, Aim, Candidate.Side), MinZ, Landing, AirTime))
+				{
+					AddLink(Landing, AirTime, true);
+				}
+			}
+
+			// Collision is left out, the wall probe below stands in for it
+			const FVector PrevLocation = Sim.Location;
+			Movement.StepWallRunSimulation(Sim, Context.GravityZ, SimTimeStep);
+			WallRunTime += SimTimeStep;
+
+			// Slid down to the ground along the wall
+			FHitResult GroundHit;
+			const FVector FeetOffset(0.0f, 0.0f, -Context.CapsuleHalfHeight);
+			if (Sim.Velocity.Z < 0.0f && Context.World->LineTraceSingleByChannel(GroundHit, PrevLocation + FeetOffset, Sim.Location + FeetOffset, Context.GroundChannel, Context.QueryParams))
+			{
+				OutNumSimulated++;
+				if (GroundHit.ImpactNormal.Z >= Movement.GetWalkableFloorZ())
+				{
+					AddLink(GroundHit.ImpactPoint, 0.0f, false);
+				}
+				return;
+			}
+
+			// Wall ran out, falls off
+			FWallQueryHit WallHit;
+			if (!Context.Walls->Raycast(Sim.Location, Sim.Location - WallNormal * Movement.WallDetectDistance, WallHit))
+			{
+				FVector Landing;
+				float AirTime = 0.0f;
+				OutNumSimulated++;
+				if (SimulateFall(Context, Sim.Location, Sim.Velocity, MinZ, Landing, AirTime))
+				{
+					AddLink(Landing, AirTime, false);
+				}
+				return;
+			}
+
+			// Follow the wall
+			WallNormal = WallHit.Normal;
+			RunDirection = Movement.GetWallRunForwardDirection(Candidate.Side, WallNormal).GetSafeNormal2D();
+			Sim.Location = WallHit.Location + WallNormal * Context.CapsuleRadius;
+			const float Speed = FMath::Min(Sim.Velocity.Size2D(), MaxSpeed);
+			Sim.Velocity = FVector(RunDirection.X * Speed, RunDirection.Y * Speed, Sim.Velocity.Z);
+		}
+	}
+}
+
+int32 AWallRunNavLinks::Bake(const AWallRunSurfaceIndex& SurfaceIndex, int32& OutNumCandidates, int32& OutNumSimulated)
+{
+	using namespace WallRunNavLinks;
+
+	Links.Reset();
+	OutNumCandidates = 0;
+	OutNumSimulated = 0;
+
+	UWorld* World = GetWorld();
+	const ACharacter* CharacterDefaults = CharacterClass ? CharacterClass->GetDefaultObject<ACharacter>() : GetDefault<AShooterCharacter>();
+	const UShooterCharacterMovement* Movement = CharacterDefaults ? Cast<UShooterCharacterMovement>(CharacterDefaults->GetCharacterMovement()) : nullptr;
+	if (World == nullptr || Movement == nullptr || !SurfaceIndex.HasData())
+	{
+		BuildPointLinks();
+		return 0;
+	}
+
+	FSimContext Context;
+	Context.Settings = this;
+	Context.Movement = Movement;
+	Context.Walls = &SurfaceIndex;
+	Context.World = World;
+	Context.QueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(WallRunNavLinks), false);
+	FCollisionQueryParams SurfaceQueryParams = Context.QueryParams;
+	SurfaceQueryParams.bReturnPhysicalMaterial = true;
+	Context.SurfaceProbe = FWallQueryBackend_Physics(World, SurfaceQueryParams, Movement->WallRunTraceChannel);
+	if (Movement->WallRunObjectTypes.Num() > 0)
+	{
+		Context.SurfaceProbe.ObjectQueryParams = FCollisionObjectQueryParams(Movement->WallRunObjectTypes);
+	}
+	Context.GroundChannel = CharacterDefaults->GetCapsuleComponent()->GetCollisionObjectType();
+	Context.CapsuleRadius = CharacterDefaults->GetCapsuleComponent()->GetScaledCapsuleRadius();
+	Context.CapsuleHalfHeight = CharacterDefaults->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	Context.GravityZ = World->GetGravityZ() * Movement->GravityScale;
+
+	// Highest a jump from the ground gets the character up a wall
+	const float MaxEntryHeight = FMath::Square(Movement->JumpZVelocity) / (-2.0f * Context.GravityZ);
+
+	// Entries on random points of every wall triangle, both wallrun directions. Seeded per triangle, so bakes are repeatable.
+	TArray<FCandidate> Candidates;
+	const TArray<FWallRunSurfaceTriangle>& Triangles = SurfaceIndex.GetTriangles();
+	for (int32 TriangleIndex = 0; TriangleIndex < Triangles.Num(); TriangleIndex++)
+	{
+		const FWallRunSurfaceTriangle& Triangle = Triangles[TriangleIndex];
+		const float Area = FVector::CrossProduct(Triangle.Edge1, Triangle.Edge2).Size() * 0.5f;
+		const int32 NumSamples = FMath::Max(1, FMath::RoundToInt(Area / FMath::Square(SampleSpacing)));
+
+		FRandomStream Random(TriangleIndex);
+		for (int32 Sample = 0; Sample < NumSamples; Sample++)
+		{
+			float U = Random.FRand();
+			float V = Random.FRand();
+			if (U + V > 1.0f)
+			{
+				U = 1.0f - U;
+				V = 1.0f - V;
+			}
+			const FVector WallPoint = Triangle.A + Triangle.Edge1 * U + Triangle.Edge2 * V;
+
+			// Ground in front of the wall, close enough below the point to jump up to it
+			const FVector Start = WallPoint + Triangle.Normal * (Context.CapsuleRadius + 10.0f);
+			const float MaxDrop = MaxEntryHeight + Context.CapsuleHalfHeight;
+			FHitResult GroundHit;
+			if (!World->LineTraceSingleByChannel(GroundHit, Start, Start - FVector(0.0f, 0.0f, MaxDrop), Context.GroundChannel, Context.QueryParams)
+				|| GroundHit.ImpactNormal.Z < Movement->GetWalkableFloorZ()
+				|| WallPoint.Z - GroundHit.ImpactPoint.Z < Context.CapsuleHalfHeight)
+			{
+				continue;
+			}
+
+			for (EWallRunSide Side : { EWallRunSide::Left, EWallRunSide::Right })
+			{
+				FCandidate& Candidate = Candidates.AddDefaulted_GetRef();
+				Candidate.WallPoint = WallPoint;
+				Candidate.WallNormal = Triangle.Normal;
+				Candidate.GroundPoint = GroundHit.ImpactPoint;
+				Candidate.Side = Side;
+			}
+		}
+	}
+	OutNumCandidates = Candidates.Num();
+
+	// Simulations only read the world, tuning and the index, each writes its own slot
+	TArray<TArray<FWallRunNavLink>> CandidateLinks;
+	TArray<int32> CandidateNumSimulated;
+	CandidateLinks.SetNum(Candidates.Num());
+	CandidateNumSimulated.SetNumZeroed(Candidates.Num());
+	ParallelFor(Candidates.Num(), [&](int32 i)
+	{
+		SimulateCandidate(Context, Candidates[i], CandidateLinks[i], CandidateNumSimulated[i]);
+	});
+
+	// Cheapest first, then drop anything a kept link already covers. Ends are hashed on a MergeDistance grid.
+	TArray<FWallRunNavLink> AllLinks;
+	for (int32 i = 0; i < Candidates.Num(); i++)
+	{
+		AllLinks.Append(CandidateLinks[i]);
+		OutNumSimulated += CandidateNumSimulated[i];
+	}
+	AllLinks.Sort([](const FWallRunNavLink& A, const FWallRunNavLink& B) { return A.Cost < B.Cost; });
+
+	auto GetCell = [this](const FVector& Location)
+	{
+		return FIntVector(FMath::FloorToInt(Location.X / MergeDistance), FMath::FloorToInt(Location.Y / MergeDistance), FMath::FloorToInt(Location.Z / MergeDistance));
+	};
+	TMultiMap<FIntVector, int32> KeptByStartCell;
+	for (const FWallRunNavLink& Link : AllLinks)
+	{
+		const FIntVector StartCell = GetCell(Link.Start);
+		bool bCovered = false;
+		for (int32 X = -1; X <= 1 && !bCovered; X++)
+		{
+			for (int32 Y = -1; Y <= 1 && !bCovered; Y++)
+			{
+				for (int32 Z = -1; Z <= 1 && !bCovered; Z++)
+				{
+					for (auto It = KeptByStartCell.CreateConstKeyIterator(StartCell + FIntVector(X, Y, Z)); It; ++It)
+					{
+						const FWallRunNavLink& Kept = Links[It.Value()];
+						if (FVector::DistSquared(Kept.Start, Link.Start) <= FMath::Square(MergeDistance)
+							&& FVector::DistSquared(Kept.End, Link.End) <= FMath::Square(MergeDistance))
+						{
+							bCovered = true;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (!bCovered)
+		{
+			KeptByStartCell.Add(StartCell, Links.Add(Link));
+		}
+	}
+
+	BuildPointLinks();
+	return Links.Num();
+}
+
+
+/** Generates wallrun nav links of the current level from its baked wall index */
+static void BakeWallRunNavLinks(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	AWallRunSurfaceIndex* Index = nullptr;
+	for (TActorIterator<AWallRunSurfaceIndex> It(World); It; ++It)
+	{
+		if (It->HasData())
+		{
+			Index = *It;
+			break;
+		}
+	}
+	if (Index == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.BakeNavLinks - %s has no baked wall index, run WallRun.BakeSurfaceIndex first"), *World->GetMapName());
+		return;
+	}
+
+	AWallRunNavLinks* NavLinks = nullptr;
+	for (TActorIterator<AWallRunNavLinks> It(World); It; ++It)
+	{
+		NavLinks = *It;
+		break;
+	}
+	if (NavLinks == nullptr)
+	{
+		NavLinks = World->SpawnActor<AWallRunNavLinks>();
+	}
+	if (Args.Num() > 0)
+	{
+		NavLinks->SampleSpacing = FMath::Max(25.0f, FCString::Atof(*Args[0]));
+	}
+
+	int32 NumCandidates = 0;
+	int32 NumSimulated = 0;
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumLinks = NavLinks->Bake(*Index, NumCandidates, NumSimulated);
+	const double BakeTime = FPlatformTime::Seconds() - StartTime;
+	NavLinks->MarkPackageDirty();
+	FNavigationSystem::UpdateActorData(*NavLinks);
+
+	UE_LOG(LogTemp, Log, TEXT("WallRun.BakeNavLinks - %s: %d candidates, %d simulated exits, %d links, baked in %.2f s on %d worker threads"),
+		*World->GetMapName(), NumCandidates, NumSimulated, NumLinks, BakeTime, FTaskGraphInterface::Get().GetNumWorkerThreads());
+}
+
+static FAutoConsoleCommand CmdWallRunBakeNavLinks(TEXT("WallRun.BakeNavLinks"),
+	TEXT("Generates navigation links over wallrunnable walls of the current level into a WallRunNavLinks actor (save the level afterwards). Needs a baked wall index. Usage: WallRun.BakeNavLinks [SampleSpacing]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BakeWallRunNavLinks));
+#endif
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "AI/Navigation/NavRelevantInterface.h"
+#include "AI/Navigation/NavLinkHostInterface.h"
+#include "AI/Navigation/NavLinkDefinition.h"
+#include "ShooterMovementTypes.h"
+#include "WallRunNavLinks.generated.h"
+
+class ACharacter;
+class AWallRunSurfaceIndex;
+class UNavArea;
+
+
+/** Single generated wallrun traversal, from where a bot has to jump at the wall to where it lands */
+USTRUCT()
+struct FWallRunNavLink
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector Start = FVector::ZeroVector;
+
+	UPROPERTY()
+	FVector End = FVector::ZeroVector;
+
+	UPROPERTY()
+	EWallRunSide Side = EWallRunSide::Left;
+
+	/** Time on the wall before leaving it */
+	UPROPERTY()
+	float WallRunTime = 0.0f;
+
+	/** Traversal cost, total time (in seconds) from Start to End */
+	UPROPERTY()
+	float Cost = 0.0f;
+
+	/** Left the wall with a wall jump, otherwise by riding the wallrun out */
+	UPROPERTY()
+	bool bWallJump = false;
+};
+
+
+/**
+ * Navigation links over wallrunnable walls, generated offline for server bots (WallRun.BakeNavLinks spawns it).
+ * Placed once per level and saved with it, the links are added to the navmesh like the ones of a NavLinkProxy.
+ *
+ * Candidate entries are sampled on the walls of the baked AWallRunSurfaceIndex. Each one is simulated with the wallrun
+ * physics and current tuning of CharacterClass: gravity states and duration, wall jumps at a couple of points of the
+ * wallrun and riding it out. Every exit that lands on walkable ground becomes a link. Candidates are simulated in parallel.
+ */
+UCLASS(NotBlueprintable)
+class SHOOTERGAME_API AWallRunNavLinks : public AInfo, public INavRelevantInterface, public INavLinkHostInterface
+{
+	GENERATED_BODY()
+
+public:
+	AWallRunNavLinks(const FObjectInitializer& ObjectInitializer);
+
+	/** Character whose movement tuning is simulated, AShooterCharacter if not set */
+	UPROPERTY(EditAnywhere, Category = "Bake")
+	TSubclassOf<ACharacter> CharacterClass;
+
+	/** Average distance (in cm) between sampled wallrun entries on a wall */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "25"))
+	float SampleSpacing = 200.0f;
+
+	/** Wall jumps are tried every this many seconds of a wallrun */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0.05"))
+	float JumpSampleInterval = 0.25f;
+
+	/** Aim of tried wall jumps, degrees away from the wall relative to the wallrun direction */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0", ClampMax = "90"))
+	float JumpAimAngle = 45.0f;
+
+	/** Links shorter than this (in cm, horizontally) are dropped, walking is good enough there */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0"))
+	float MinLinkLength = 300.0f;
+
+	/** Falls from a wall deeper than this (in cm) below the entry are not considered */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0"))
+	float MaxFallHeight = 1000.0f;
+
+	/** Links with both ends within this distance (in cm) of a cheaper one are dropped */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "1"))
+	float MergeDistance = 150.0f;
+
+	/** Area of the generated links on the navmesh */
+	UPROPERTY(EditAnywhere, Category = "Navigation")
+	TSubclassOf<UNavArea> LinkArea;
+
+#if WITH_EDITOR
+	/** Regenerates the links from the given wall index and current tuning. Returns number of links, OutNumSimulated is number of simulated exits. */
+	int32 Bake(const AWallRunSurfaceIndex& SurfaceIndex, int32& OutNumCandidates, int32& OutNumSimulated);
+#endif
+
+	const TArray<FWallRunNavLink>& GetLinks() const { return Links; }
+
+	virtual void PostLoad() override;
+
+	// INavRelevantInterface
+	virtual void GetNavigationData(FNavigationRelevantData& Data) const override;
+	virtual FBox GetNavigationBounds() const override;
+	virtual bool IsNavigationRelevant() const override;
+
+	// INavLinkHostInterface
+	virtual bool GetNavigationLinksClasses(TArray<TSubclassOf<UNavLinkDefinition>>& OutClasses) const override;
+	virtual bool GetNavigationLinksArray(TArray<FNavigationLink>& OutLink, TArray<FNavigationSegmentLink>& OutSegments) const override;
+
+private:
+	/** Navmesh representation of Links */
+	void BuildPointLinks();
+
+	UPROPERTY()
+	TArray<FWallRunNavLink> Links;
+
+	TArray<FNavigationLink> PointLinks;
+};
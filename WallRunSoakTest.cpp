@@ -0,0 +1,462 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WallRunSoakTest.h"
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+#include "ShooterCharacterMovement.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+// Bot course tuning, in cm and seconds
+static const float SoakWallSearchDistance = 1500.0f;
+static const float SoakWallJumpDistance = 200.0f;
+static const float SoakRunIntoWallAngle = 20.0f;
+static const float SoakMaxApproachTime = 3.0f;
+static const float SoakMinWallRunTime = 0.2f;
+static const float SoakMaxWallRunTime = 2.5f;
+
+FWallRunSoakBot::FWallRunSoakBot(APlayerController* InController, int32 Seed)
+	: Controller(InController)
+	, Random(Seed)
+{
+}
+
+void FWallRunSoakBot::SetPhase(EPhase NewPhase)
+{
+	Phase = NewPhase;
+	PhaseTime = 0.0f;
+}
+
+bool FWallRunSoakBot::Tick(float DeltaTime)
+{
+	APlayerController* PC = Controller.Get();
+	if (PC == nullptr)
+	{
+		return false;
+	}
+
+	// Dead or respawning, keep the bot around for the next pawn
+	ACharacter* Character = Cast<ACharacter>(PC->GetPawn());
+	UShooterCharacterMovement* MovementComp = Character ? Cast<UShooterCharacterMovement>(Character->GetCharacterMovement()) : nullptr;
+	if (MovementComp == nullptr)
+	{
+		SetPhase(EPhase::FindWall);
+		return true;
+	}
+
+	if (bReleaseJump)
+	{
+		Character->StopJumping();
+		bReleaseJump = false;
+	}
+
+	PhaseTime += DeltaTime;
+	switch (Phase)
+	{
+	case EPhase::FindWall:	TickFindWall(Character, MovementComp); break;
+	case EPhase::Approach:	TickApproach(Character, MovementComp); break;
+	case EPhase::Airborne:	TickAirborne(Character, MovementComp); break;
+	case EPhase::WallRun:	TickWallRun(Character, MovementComp); break;
+	}
+
+	PC->SetControlRotation(FRotator(0.0f, RunYaw, 0.0f));
+	Character->AddMovementInput(FRotator(0.0f, RunYaw, 0.0f).Vector());
+	return true;
+}
+
+void FWallRunSoakBot::TickFindWall(ACharacter* Character, UShooterCharacterMovement* MovementComp)
+{
+	if (!MovementComp->IsMovingOnGround())
+	{
+		return;
+	}
+
+	// Walls around us at chest height, one of them is picked at random
+	const int32 NumDirections = 16;
+	const FVector Start = Character->GetActorLocation();
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(WallRunSoakBot), false, Character);
+
+	TArray<FHitResult, TInlineAllocator<NumDirections>> Walls;
+	for (int32 i = 0; i < NumDirections; i++)
+	{
+		const FVector Direction = FRotator(0.0f, 360.0f * i / NumDirections, 0.0f).Vector();
+		FHitResult Hit;
+		if (Character->GetWorld()->LineTraceSingleByChannel(Hit, Start, Start + Direction * SoakWallSearchDistance, ECC_Visibility, QueryParams)
+			&& FMath::Abs(Hit.ImpactNormal.Z) < 0.2f && Hit.Distance > SoakWallJumpDistance)
+		{
+			Walls.Add(Hit);
+		}
+	}
+
+	if (Walls.Num() == 0)
+	{
+		// Open space, wander off in some direction and look again
+		if (PhaseTime > 1.0f)
+		{
+			RunYaw = Random.FRandRange(-180.0f, 180.0f);
+			PhaseTime = 0.0f;
+		}
+		return;
+	}
+
+	const FHitResult& Wall = Walls[Random.RandHelper(Walls.Num())];
+	WallPoint = Wall.ImpactPoint;
+
+	// Run along the wall on a random side of us, turned a bit into it
+	const FVector WallNormal = FVector(Wall.ImpactNormal.X, Wall.ImpactNormal.Y, 0.0f).GetSafeNormal();
+	const FVector AlongWall = FVector::CrossProduct(WallNormal, FVector::UpVector) * (Random.FRand() < 0.5f ? 1.0f : -1.0f);
+	const float IntoWall = FMath::DegreesToRadians(SoakRunIntoWallAngle);
+	WallRunYaw = (AlongWall * FMath::Cos(IntoWall) - WallNormal * FMath::Sin(IntoWall)).Rotation().Yaw;
+
+	// Get to the wall first, the run direction is only taken when jumping
+	RunYaw = (WallPoint - Start).GetSafeNormal2D().Rotation().Yaw;
+	SetPhase(EPhase::Approach);
+}
+
+void FWallRunSoakBot::TickApproach(ACharacter* Character, UShooterCharacterMovement* MovementComp)
+{
+	const float Distance = FVector::Dist2D(Character->GetActorLocation(), WallPoint);
+	if (Distance < SoakWallJumpDistance || PhaseTime > SoakMaxApproachTime)
+	{
+		RunYaw = WallRunYaw;
+		Character->Jump();
+		MovementComp->WallRunJumpPressed();
+		bReleaseJump = true;
+		SetPhase(EPhase::Airborne);
+	}
+}
+
+void FWallRunSoakBot::TickAirborne(ACharacter* Character, UShooterCharacterMovement* MovementComp)
+{
+	if (MovementComp->IsWallRunning())
+	{
+		NumWallRunStarts++;
+		if (MovementComp->IsWallRunningOnMovingWall())
+		{
+			NumMovingWallRuns++;
+		}
+		WallRunDuration = Random.FRandRange(SoakMinWallRunTime, SoakMaxWallRunTime);
+		Exit = (EExit)Random.RandHelper(3);
+		SetPhase(EPhase::WallRun);
+	}
+	else if (MovementComp->IsMovingOnGround() && PhaseTime > 0.2f)
+	{
+		SetPhase(EPhase::FindWall);
+	}
+}
+
+void FWallRunSoakBot::TickWallRun(ACharacter* Character, UShooterCharacterMovement* MovementComp)
+{
+	if (!MovementComp->IsWallRunning())
+	{
+		// Ran out of wall or time before the chosen exit
+		SetPhase(EPhase::Airborne);
+		return;
+	}
+
+	// Keep looking along the wall, moving backwards would stop the wallrun
+	RunYaw = Character->GetVelocity().Rotation().Yaw;
+
+	if (PhaseTime < WallRunDuration)
+	{
+		return;
+	}
+
+	switch (Exit)
+	{
+	case EExit::Jump:
+		// Bots jump without input, record the press like the jump binding does so sub-tick jump offsets are exercised too
+		Character->Jump();
+		MovementComp->WallRunJumpPressed();
+		bReleaseJump = true;
+		NumWallJumps++;
+		break;
+	case EExit::Unstick:
+		MovementComp->UnstickFromWallPressed();
+		NumUnsticks++;
+		break;
+	case EExit::RideOut:
+		// Hold on until end gravity pulls us off, cooldowns kick in after
+		NumRideOuts++;
+		break;
+	}
+	SetPhase(EPhase::Airborne);
+}
+
+
+/** State of the soak test running in this process */
+struct FWallRunSoakSession
+{
+	TWeakObjectPtr<UWorld> World;
+	bool bRunning = false;
+	double StartTime = 0.0;
+	float Duration = 0.0f;
+
+	/** Game thread time of each frame in ms, without the idle time waiting for the tick rate */
+	TArray<float> FrameTimes;
+
+	/** Counters at start of the session, reports are relative to these */
+	TMap<TWeakObjectPtr<UNetConnection>, TPair<uint32, uint32>> StartBytes;
+	TMap<TWeakObjectPtr<UShooterCharacterMovement>, uint32> StartCorrections;
+
+	TArray<TSharedPtr<FWallRunSoakBot>> Bots;
+
+	FDelegateHandle TickerHandle;
+};
+
+static FWallRunSoakSession SoakSession;
+
+static UShooterCharacterMovement* GetShooterMovement(APlayerController* PC)
+{
+	ACharacter* Character = PC ? Cast<ACharacter>(PC->GetPawn()) : nullptr;
+	return Character ? Cast<UShooterCharacterMovement>(Character->GetCharacterMovement()) : nullptr;
+}
+
+/** Connections of this process: client connections on the server, the server connection on a client */
+static TArray<UNetConnection*> GetSoakConnections(UWorld* World)
+{
+	TArray<UNetConnection*> Result;
+	if (UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr)
+	{
+		if (NetDriver->ServerConnection)
+		{
+			Result.Add(NetDriver->ServerConnection);
+		}
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			Result.Add(Connection);
+		}
+	}
+	return Result;
+}
+
+static uint32 GetCorrectionCount(UShooterCharacterMovement* MovementComp)
+{
+	return MovementComp->GetOwnerRole() == ROLE_Authority ? MovementComp->MoveResponseDataContainer.NumCorrectionsSent : MovementComp->NumCorrectionsReceived;
+}
+
+static void ResetSoakCounters(UWorld* World)
+{
+	SoakSession.StartTime = FPlatformTime::Seconds();
+	SoakSession.FrameTimes.Reset();
+	SoakSession.StartBytes.Reset();
+	SoakSession.StartCorrections.Reset();
+
+	for (UNetConnection* Connection : GetSoakConnections(World))
+	{
+		SoakSession.StartBytes.Add(Connection, TPair<uint32, uint32>(Connection->InTotalBytes, Connection->OutTotalBytes));
+		if (UShooterCharacterMovement* MovementComp = GetShooterMovement(Connection->PlayerController))
+		{
+			SoakSession.StartCorrections.Add(MovementComp, GetCorrectionCount(MovementComp));
+		}
+	}
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (UShooterCharacterMovement* MovementComp = GetShooterMovement(It->Get()))
+		{
+			SoakSession.StartCorrections.Add(MovementComp, GetCorrectionCount(MovementComp));
+			MovementComp->NumWallRunSavedMoves = 0;
+			MovementComp->NumWallRunCombinedMoves = 0;
+		}
+	}
+}
+
+static void WriteSoakReport(UWorld* World)
+{
+	const double Duration = FPlatformTime::Seconds() - SoakSession.StartTime;
+	const FString Filename = World->GetNetMode() == NM_Client
+		? FWallRunSoakReport::WriteClientReport(World, Duration)
+		: FWallRunSoakReport::WriteServerReport(World, Duration);
+	UE_LOG(LogTemp, Log, TEXT("WallRun.Soak - report for %.1f s written to %s"), Duration, *Filename);
+}
+
+static bool TickSoakSession(float DeltaTime)
+{
+	UWorld* World = SoakSession.World.Get();
+	if (World == nullptr)
+	{
+		SoakSession.bRunning = false;
+		SoakSession.Bots.Reset();
+		SoakSession.TickerHandle.Reset();
+		return false;
+	}
+
+	SoakSession.FrameTimes.Add((FApp::GetDeltaTime() - FApp::GetIdleTime()) * 1000.0f);
+
+	SoakSession.Bots.RemoveAll([DeltaTime](const TSharedPtr<FWallRunSoakBot>& Bot) { return !Bot->Tick(DeltaTime); });
+
+	if (SoakSession.Duration > 0.0f && FPlatformTime::Seconds() - SoakSession.StartTime >= SoakSession.Duration)
+	{
+		WriteSoakReport(World);
+		SoakSession.bRunning = false;
+		SoakSession.Bots.Reset();
+		SoakSession.TickerHandle.Reset();
+
+		if (FParse::Param(FCommandLine::Get(), TEXT("WallRunSoakExit")))
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+		return false;
+	}
+	return true;
+}
+
+static void StartSoak(const TArray<FString>& Args, UWorld* World)
+{
+	if (SoakSession.TickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(SoakSession.TickerHandle);
+	}
+
+	SoakSession.World = World;
+	SoakSession.bRunning = true;
+	SoakSession.Duration = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 0.0f;
+	SoakSession.Bots.Reset();
+
+	// Clients drive their local characters, the server only measures
+	if (World->GetNetMode() == NM_Client)
+	{
+		const int32 Seed = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : FMath::Rand();
+		for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+		{
+			if (It->Get() && It->Get()->IsLocalController())
+			{
+				SoakSession.Bots.Add(MakeShared<FWallRunSoakBot>(It->Get(), Seed + SoakSession.Bots.Num()));
+			}
+		}
+	}
+
+	ResetSoakCounters(World);
+	SoakSession.TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&TickSoakSession));
+
+	UE_LOG(LogTemp, Log, TEXT("WallRun.Soak.Start - %s, %d bots, %s"), World->GetNetMode() == NM_Client ? TEXT("client") : TEXT("server"),
+		SoakSession.Bots.Num(), SoakSession.Duration > 0.0f ? *FString::Printf(TEXT("report in %.0f s"), SoakSession.Duration) : TEXT("until WallRun.Soak.Report"));
+}
+
+static void ReportSoak(const TArray<FString>& Args, UWorld* World)
+{
+	if (!SoakSession.bRunning)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("WallRun.Soak.Report - No soak running, start one with WallRun.Soak.Start"));
+		return;
+	}
+	WriteSoakReport(World);
+}
+
+static FAutoConsoleCommand CmdWallRunSoakStart(TEXT("WallRun.Soak.Start"),
+	TEXT("Starts a wallrun soak session. On clients the local characters run scripted wallrun courses, the server measures frame time, bandwidth and corrections. ")
+	TEXT("Usage: WallRun.Soak.Start [Seconds] [Seed]. With Seconds the report is written automatically (and the process exits with -WallRunSoakExit)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartSoak));
+
+static FAutoConsoleCommand CmdWallRunSoakReport(TEXT("WallRun.Soak.Report"),
+	TEXT("Writes the report of the running soak session to Saved/Soak"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReportSoak));
+
+
+static FString SaveSoakReport(const FString& Prefix, const FString& Json)
+{
+	const FString Filename = FPaths::ProjectSavedDir() / TEXT("Soak") / FString::Printf(TEXT("%s_%s.json"), *Prefix, *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(Json, *Filename);
+	return Filename;
+}
+
+FString FWallRunSoakReport::WriteServerReport(UWorld* World, double Duration)
+{
+	TArray<float> FrameTimes = SoakSession.FrameTimes;
+	FrameTimes.Sort();
+	auto Percentile = [&FrameTimes](float P)
+	{
+		return FrameTimes.Num() > 0 ? FrameTimes[FMath::Min(FrameTimes.Num() - 1, FMath::FloorToInt(P * FrameTimes.Num()))] : 0.0f;
+	};
+	float FrameTimeSum = 0.0f;
+	for (float FrameTime : FrameTimes)
+	{
+		FrameTimeSum += FrameTime;
+	}
+
+	const double Minutes = FMath::Max(Duration / 60.0, SMALL_NUMBER);
+
+	FString Json = TEXT("{\n");
+	Json += FString::Printf(TEXT("\t\"role\": \"server\",\n\t\"map\": \"%s\",\n\t\"duration_s\": %.2f,\n"), *World->GetMapName(), Duration);
+	Json += FString::Printf(TEXT("\t\"frame_time_ms\": { \"frames\": %d, \"avg\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n"),
+		FrameTimes.Num(), FrameTimes.Num() > 0 ? FrameTimeSum / FrameTimes.Num() : 0.0f, Percentile(0.5f), Percentile(0.95f), Percentile(0.99f), FrameTimes.Num() > 0 ? FrameTimes.Last() : 0.0f);
+	Json += TEXT("\t\"clients\": [");
+
+	int32 NumClients = 0;
+	for (UNetConnection* Connection : GetSoakConnections(World))
+	{
+		const TPair<uint32, uint32>* StartBytes = SoakSession.StartBytes.Find(Connection);
+		UShooterCharacterMovement* MovementComp = GetShooterMovement(Connection->PlayerController);
+		const uint32* StartCorrections = MovementComp ? SoakSession.StartCorrections.Find(MovementComp) : nullptr;
+
+		// Upstream is what the client sends, so what the server receives
+		const uint32 UpBytes = Connection->InTotalBytes - (StartBytes ? StartBytes->Key : 0);
+		const uint32 DownBytes = Connection->OutTotalBytes - (StartBytes ? StartBytes->Value : 0);
+		const uint32 Corrections = MovementComp ? GetCorrectionCount(MovementComp) - (StartCorrections ? *StartCorrections : 0) : 0;
+
+		Json += FString::Printf(TEXT("%s\n\t\t{ \"name\": \"%s\", \"up_bytes_per_s\": %.1f, \"down_bytes_per_s\": %.1f, \"corrections\": %u, \"corrections_per_min\": %.2f }"),
+			NumClients > 0 ? TEXT(",") : TEXT(""), *Connection->LowLevelGetRemoteAddress(true),
+			UpBytes / FMath::Max(Duration, (double)SMALL_NUMBER), DownBytes / FMath::Max(Duration, (double)SMALL_NUMBER), Corrections, Corrections / Minutes);
+		NumClients++;
+	}
+	Json += TEXT("\n\t]\n}\n");
+
+	return SaveSoakReport(TEXT("Server"), Json);
+}
+
+FString FWallRunSoakReport::WriteClientReport(UWorld* World, double Duration)
+{
+	const double Minutes = FMath::Max(Duration / 60.0, SMALL_NUMBER);
+
+	FString Json = TEXT("{\n");
+	Json += FString::Printf(TEXT("\t\"role\": \"client\",\n\t\"map\": \"%s\",\n\t\"duration_s\": %.2f,\n"), *World->GetMapName(), Duration);
+
+	UNetConnection* Connection = World->GetNetDriver() ? World->GetNetDriver()->ServerConnection : nullptr;
+	if (Connection)
+	{
+		const TPair<uint32, uint32>* StartBytes = SoakSession.StartBytes.Find(Connection);
+		const uint32 UpBytes = Connection->OutTotalBytes - (StartBytes ? StartBytes->Value : 0);
+		const uint32 DownBytes = Connection->InTotalBytes - (StartBytes ? StartBytes->Key : 0);
+		Json += FString::Printf(TEXT("\t\"up_bytes_per_s\": %.1f,\n\t\"down_bytes_per_s\": %.1f,\n"),
+			UpBytes / FMath::Max(Duration, (double)SMALL_NUMBER), DownBytes / FMath::Max(Duration, (double)SMALL_NUMBER));
+	}
+
+	Json += TEXT("\t\"characters\": [");
+	int32 NumCharacters = 0;
+	for (const TSharedPtr<FWallRunSoakBot>& Bot : SoakSession.Bots)
+	{
+		UShooterCharacterMovement* MovementComp = GetShooterMovement(Bot->GetController());
+		if (MovementComp == nullptr)
+		{
+			continue;
+		}
+
+		const uint32* StartCorrections = SoakSession.StartCorrections.Find(MovementComp);
+		const uint32 Corrections = GetCorrectionCount(MovementComp) - (StartCorrections ? *StartCorrections : 0);
+		const float CombineRatio = MovementComp->NumWallRunSavedMoves > 0 ? (float)MovementComp->NumWallRunCombinedMoves / MovementComp->NumWallRunSavedMoves : 0.0f;
+
+		Json += FString::Printf(TEXT("%s\n\t\t{ \"name\": \"%s\", \"wallrun_moves\": %u, \"wallrun_combine_ratio\": %.4f, \"corrections\": %u, \"corrections_per_min\": %.2f, ")
+			TEXT("\"wallrun_starts\": %u, \"wall_jumps\": %u, \"unsticks\": %u, \"ride_outs\": %u, \"moving_wallruns\": %u }"),
+			NumCharacters > 0 ? TEXT(",") : TEXT(""), *MovementComp->GetPawnOwner()->GetName(), MovementComp->NumWallRunSavedMoves, CombineRatio,
+			Corrections, Corrections / Minutes, Bot->NumWallRunStarts, Bot->NumWallJumps, Bot->NumUnsticks, Bot->NumRideOuts, Bot->NumMovingWallRuns);
+		NumCharacters++;
+	}
+	Json += TEXT("\n\t]\n}\n");
+
+	return SaveSoakReport(TEXT("Client"), Json);
+}
+
+#endif
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ACharacter;
+class APlayerController;
+class UShooterCharacterMovement;
+
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+/**
+ * Scripted wallrun course for a locally controlled character, used by the soak test (see README).
+ * Looks for a wall nearby, runs at it, jumps on and leaves it with a wall jump, an unstick or by riding
+ * the wallrun out, so StartWallRunning, DoWallRunJump, UnstickFromWallPressed and the cooldowns are all hit.
+ * Choices come from a seeded stream, the same seed gives the same sequence of decisions.
+ */
+class FWallRunSoakBot
+{
+public:
+	FWallRunSoakBot(APlayerController* InController, int32 Seed);
+
+	/** Feeds input to the controlled character, returns false once the controller is gone */
+	bool Tick(float DeltaTime);
+
+	APlayerController* GetController() const { return Controller.Get(); }
+
+	uint32 NumWallRunStarts = 0;
+	uint32 NumWallJumps = 0;
+	uint32 NumUnsticks = 0;
+	uint32 NumRideOuts = 0;
+
+	/** Wallruns started on a moving wall (see UShooterCharacterMovement::bSupportMovingWalls) */
+	uint32 NumMovingWallRuns = 0;
+
+private:
+	enum class EPhase : uint8
+	{
+		FindWall,	// On the ground, picking a wall and a run direction
+		Approach,	// Running at the wall, jumps when close enough
+		Airborne,	// Waiting for a wallrun to start or to land
+		WallRun,	// Holding the wallrun until the chosen exit
+	};
+
+	enum class EExit : uint8
+	{
+		Jump,
+		Unstick,
+		RideOut,
+	};
+
+	void SetPhase(EPhase NewPhase);
+	void TickFindWall(ACharacter* Character, UShooterCharacterMovement* MovementComp);
+	void TickApproach(ACharacter* Character, UShooterCharacterMovement* MovementComp);
+	void TickAirborne(ACharacter* Character, UShooterCharacterMovement* MovementComp);
+	void TickWallRun(ACharacter* Character, UShooterCharacterMovement* MovementComp);
+
+	TWeakObjectPtr<APlayerController> Controller;
+	FRandomStream Random;
+
+	EPhase Phase = EPhase::FindWall;
+	float PhaseTime = 0.0f;
+
+	/** Yaw the character currently runs and looks with */
+	float RunYaw = 0.0f;
+
+	/** Chosen wall and the yaw to jump on it with, along the wall and slightly into it */
+	FVector WallPoint = FVector::ZeroVector;
+	float WallRunYaw = 0.0f;
+
+	float WallRunDuration = 0.0f;
+	EExit Exit = EExit::Jump;
+
+	/** Jump is pressed for a single frame */
+	bool bReleaseJump = false;
+};
+
+
+/** Machine readable soak report, written to Saved/Soak as JSON by WallRun.Soak.Report */
+struct FWallRunSoakReport
+{
+	static FString WriteServerReport(UWorld* World, double Duration);
+	static FString WriteClientReport(UWorld* World, double Duration);
+};
+
+#endif
@@ -0,0 +1,392 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WallRunSurfaceIndex.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "HAL/IConsoleManager.h"
+
+
+AWallRunSurfaceIndex::AWallRunSurfaceIndex(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Baked data is loaded with the level on every machine, nothing to replicate
+	SetReplicates(false);
+}
+
+#if WITH_EDITOR
+int32 AWallRunSurfaceIndex::Bake()
+{
+	Triangles.Reset();
+
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		BuildGrid();
+		return 0;
+	}
+
+	// World space bounds of a collision shape, used to filter clutter
+	auto IsLargeEnough = [this](const TArray<FVector>& Vertices)
+	{
+		const FBox Bounds(Vertices);
+		const FVector Size = Bounds.GetSize();
+		return Size.Z >= MinWallHeight && FMath::Max(Size.X, Size.Y) >= MinWallWidth;
+	};
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		TInlineComponentArray<UStaticMeshComponent*> Components(*It);
+		for (UStaticMeshComponent* Component : Components)
+		{
+			// Instanced meshes are foliage and clutter, complex collision would need the render mesh
+			UBodySetup* BodySetup = Component->GetBodySetup();
+			if (BodySetup == nullptr || Component->Mobility != EComponentMobility::Static || Component->IsA<UInstancedStaticMeshComponent>()
+				|| !Component->IsCollisionEnabled() || Component->GetCollisionResponseToChannel(TraceChannel) != ECR_Block
+				|| BodySetup->CollisionTraceFlag == CTF_UseComplexAsSimple)
+			{
+				continue;
+			}
+
+			const FTransform& ComponentTransform = Component->GetComponentTransform();
+
+			for (const FKBoxElem& Box : BodySetup->AggGeom.BoxElems)
+			{
+				const FTransform BoxTransform = Box.GetTransform() * ComponentTransform;
+				const FVector HalfExtent = FVector(Box.X, Box.Y, Box.Z) * 0.5f;
+
+				TArray<FVector> Corners;
+				for (int32 i = 0; i < 8; i++)
+				{
+					const FVector Sign = FVector((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+					Corners.Add(BoxTransform.TransformPosition(HalfExtent * Sign));
+				}
+
+				if (!IsLargeEnough(Corners))
+				{
+					continue;
+				}
+
+				// Two triangles per face, corners of a face share the sign on its axis
+				const FVector BoxCenter = BoxTransform.GetLocation();
+				for (int32 Axis = 0; Axis < 3; Axis++)
+				{
+					const int32 AxisBit = 1 << Axis;
+					const int32 OtherBitA = 1 << ((Axis + 1) % 3);
+					const int32 OtherBitB = 1 << ((Axis + 2) % 3);
+					for (int32 Side = 0; Side < 2; Side++)
+					{
+						const int32 Base = Side ? AxisBit : 0;
+						const FVector& C0 = Corners[Base];
+						const FVector& C1 = Corners[Base | OtherBitA];
+						const FVector& C2 = Corners[Base | OtherBitA | OtherBitB];
+						const FVector& C3 = Corners[Base | OtherBitB];
+						const FVector Outward = (C0 + C2) * 0.5f - BoxCenter;
+						AddTriangle(C0, C1, C2, Outward);
+						AddTriangle(C0, C2, C3, Outward);
+					}
+				}
+			}
+
+			for (const FKConvexElem& Convex : BodySetup->AggGeom.ConvexElems)
+			{
+				const FTransform ConvexTransform = Convex.GetTransform() * ComponentTransform;
+
+				TArray<FVector> Vertices;
+				Vertices.Reserve(Convex.VertexData.Num());
+				for (const FVector& Vertex : Convex.VertexData)
+				{
+					Vertices.Add(ConvexTransform.TransformPosition(Vertex));
+				}
+
+				if (Vertices.Num() < 3 || Convex.IndexData.Num() < 3 || !IsLargeEnough(Vertices))
+				{
+					continue;
+				}
+
+				// Hull is convex, so the centroid is inside and every face points away from it
+				FVector Centroid = FVector::ZeroVector;
+				for (const FVector& Vertex : Vertices)
+				{
+					Centroid += Vertex;
+				}
+				Centroid /= Vertices.Num();
+
+				for (int32 i = 0; i + 2 < Convex.IndexData.Num(); i += 3)
+				{
+					const FVector& A = Vertices[Convex.IndexData[i]];
+					const FVector& B = Vertices[Convex.IndexData[i + 1]];
+					const FVector& C = Vertices[Convex.IndexData[i + 2]];
+					AddTriangle(A, B, C, (A + B + C) / 3.0f - Centroid);
+				}
+			}
+		}
+	}
+
+	Triangles.Shrink();
+	BuildGrid();
+	return Triangles.Num();
+}
+#endif
+
+void AWallRunSurfaceIndex::AddTriangle(const FVector& A, const FVector& B, const FVector& C, const FVector& OutwardHint)
+{
+	FVector Normal = FVector::CrossProduct(B - A, C - A).GetSafeNormal();
+	if (Normal.IsZero() || FMath::Abs(Normal.Z) > FMath::Sin(FMath::DegreesToRadians(MaxWallSlope)))
+	{
+		return;
+	}
+
+	FWallRunSurfaceTriangle& Triangle = Triangles.AddDefaulted_GetRef();
+	Triangle.A = A;
+	if (FVector::DotProduct(Normal, OutwardHint) >= 0.0f)
+	{
+		Triangle.Edge1 = B - A;
+		Triangle.Edge2 = C - A;
+	}
+	else
+	{
+		Triangle.Edge1 = C - A;
+		Triangle.Edge2 = B - A;
+		Normal = -Normal;
+	}
+	Triangle.Normal = Normal;
+}
+
+void AWallRunSurfaceIndex::BuildGrid()
+{
+	CellStart.Reset();
+	CellTriangles.Reset();
+	GridSizeX = 0;
+	GridSizeY = 0;
+	GridCellSize = CellSize;
+
+	if (Triangles.Num() == 0)
+	{
+		return;
+	}
+
+	auto GetTriangleBounds = [](const FWallRunSurfaceTriangle& Triangle)
+	{
+		FBox2D Bounds(ForceInit);
+		Bounds += FVector2D(Triangle.A);
+		Bounds += FVector2D(Triangle.A + Triangle.Edge1);
+		Bounds += FVector2D(Triangle.A + Triangle.Edge2);
+		return Bounds;
+	};
+
+	FBox2D GridBounds(ForceInit);
+	for (const FWallRunSurfaceTriangle& Triangle : Triangles)
+	{
+		GridBounds += GetTriangleBounds(Triangle);
+	}
+
+	GridOrigin = GridBounds.Min;
+	GridSizeX = FMath::Max(1, FMath::CeilToInt(GridBounds.GetSize().X / GridCellSize));
+	GridSizeY = FMath::Max(1, FMath::CeilToInt(GridBounds.GetSize().Y / GridCellSize));
+
+	auto ForEachCell = [this](const FBox2D& Bounds, TFunctionRef<void(int32)> Func)
+	{
+		const int32 MinX = FMath::Clamp(FMath::FloorToInt((Bounds.Min.X - GridOrigin.X) / GridCellSize), 0, GridSizeX - 1);
+		const int32 MinY = FMath::Clamp(FMath::FloorToInt((Bounds.Min.Y - GridOrigin.Y) / GridCellSize), 0, GridSizeY - 1);
+		const int32 MaxX = FMath::Clamp(FMath::FloorToInt((Bounds.Max.X - GridOrigin.X) / GridCellSize), 0, GridSizeX - 1);
+		const int32 MaxY = FMath::Clamp(FMath::FloorToInt((Bounds.Max.Y - GridOrigin.Y) / GridCellSize), 0, GridSizeY - 1);
+		for (int32 Y = MinY; Y <= MaxY; Y++)
+		{
+			for (int32 X = MinX; X <= MaxX; X++)
+			{
+				Func(GetCellIndex(X, Y));
+			}
+		}
+	};
+
+	// Count triangles per cell first, then fill the flat list
+	CellStart.SetNumZeroed(GridSizeX * GridSizeY + 1);
+	for (const FWallRunSurfaceTriangle& Triangle : Triangles)
+	{
+		ForEachCell(GetTriangleBounds(Triangle), [this](int32 Cell) { CellStart[Cell + 1]++; });
+	}
+	for (int32 Cell = 0; Cell < GridSizeX * GridSizeY; Cell++)
+	{
+		CellStart[Cell + 1] += CellStart[Cell];
+	}
+
+	TArray<int32> CellFill;
+	CellFill.SetNumZeroed(GridSizeX * GridSizeY);
+	CellTriangles.SetNumUninitialized(CellStart.Last());
+	for (int32 TriangleIndex = 0; TriangleIndex < Triangles.Num(); TriangleIndex++)
+	{
+		ForEachCell(GetTriangleBounds(Triangles[TriangleIndex]), [this, &CellFill, TriangleIndex](int32 Cell)
+		{
+			CellTriangles[CellStart[Cell] + CellFill[Cell]++] = TriangleIndex;
+		});
+	}
+}
+
+SIZE_T AWallRunSurfaceIndex::GetIndexSize() const
+{
+	return Triangles.GetAllocatedSize() + CellStart.GetAllocatedSize() + CellTriangles.GetAllocatedSize();
+}
+
+bool AWallRunSurfaceIndex::Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const
+{
+	OutHit = FWallQueryHit();
+	if (Triangles.Num() == 0)
+	{
+		return false;
+	}
+
+	// Cells overlapped by the ray bounds, rays are short so it is only a couple of them
+	const int32 MinX = FMath::FloorToInt((FMath::Min(Start.X, End.X) - GridOrigin.X) / GridCellSize);
+	const int32 MinY = FMath::FloorToInt((FMath::Min(Start.Y, End.Y) - GridOrigin.Y) / GridCellSize);
+	const int32 MaxX = FMath::FloorToInt((FMath::Max(Start.X, End.X) - GridOrigin.X) / GridCellSize);
+	const int32 MaxY = FMath::FloorToInt((FMath::Max(Start.Y, End.Y) - GridOrigin.Y) / GridCellSize);
+	if (MaxX < 0 || MaxY < 0 || MinX >= GridSizeX || MinY >= GridSizeY)
+	{
+		return false;
+	}
+
+	const FVector Delta = End - Start;
+	float BestTime = 1.0f;
+	FVector BestNormal = FVector::ZeroVector;
+	bool bHit = false;
+
+	for (int32 Y = FMath::Max(MinY, 0); Y <= FMath::Min(MaxY, GridSizeY - 1); Y++)
+	{
+		for (int32 X = FMath::Max(MinX, 0); X <= FMath::Min(MaxX, GridSizeX - 1); X++)
+		{
+			const int32 Cell = GetCellIndex(X, Y);
+			for (int32 i = CellStart[Cell]; i < CellStart[Cell + 1]; i++)
+			{
+				// Moller-Trumbore, front faces only. Unlike the two sided triangles of FWallQueryBackend_Analytic, baked triangles come from
+				// closed collision shapes, and physics traces don't hit them from inside either.
+				const FWallRunSurfaceTriangle& Triangle = Triangles[CellTriangles[i]];
+				const FVector P = FVector::CrossProduct(Delta, Triangle.Edge2);
+				const float Det = FVector::DotProduct(Triangle.Edge1, P);
+				if (Det <= KINDA_SMALL_NUMBER)
+				{
+					continue;
+				}
+
+				const float InvDet = 1.0f / Det;
+				const FVector T = Start - Triangle.A;
+				const float U = FVector::DotProduct(T, P) * InvDet;
+				const FVector Q = FVector::CrossProduct(T, Triangle.Edge1);
+				const float V = FVector::DotProduct(Delta, Q) * InvDet;
+				const float Time = FVector::DotProduct(Triangle.Edge2, Q) * InvDet;
+				if (U >= 0.0f && U <= 1.0f && V >= 0.0f && U + V <= 1.0f && Time >= 0.0f && Time <= BestTime)
+				{
+					BestTime = Time;
+					BestNormal = Triangle.Normal;
+					bHit = true;
+				}
+			}
+		}
+	}
+
+	if (bHit)
+	{
+		OutHit.bBlockingHit = true;
+		OutHit.Location = Start + Delta * BestTime;
+		OutHit.Normal = BestNormal;
+		OutHit.Distance = Delta.Size() * BestTime;
+	}
+	return bHit;
+}
+
+
+#if WITH_EDITOR
+/** Bakes the index of the current level and compares its query cost with physics traces */
+static void BakeWallRunSurfaceIndex(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	const int32 NumFans = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+	const int32 RaysPerFan = 12;
+	const float RayLength = 100.0f;
+
+	AWallRunSurfaceIndex* Index = nullptr;
+	for (TActorIterator<AWallRunSurfaceIndex> It(World); It; ++It)
+	{
+		Index = *It;
+		break;
+	}
+	if (Index == nullptr)
+	{
+		Index = World->SpawnActor<AWallRunSurfaceIndex>();
+	}
+
+	double StartTime = FPlatformTime::Seconds();
+	const int32 NumTriangles = Index->Bake();
+	const double BakeTime = FPlatformTime::Seconds() - StartTime;
+	Index->MarkPackageDirty();
+
+	UE_LOG(LogTemp, Log, TEXT("WallRun.BakeSurfaceIndex - %s: %d triangles, %.1f KB, baked in %.2f ms"),
+		*World->GetMapName(), NumTriangles, Index->GetIndexSize() / 1024.0, BakeTime * 1000.0);
+
+	if (NumTriangles == 0)
+	{
+		return;
+	}
+
+	// Fans of rays placed in front of random baked walls, same rays against physics and the index
+	FRandomStream Random(1234);
+	const TArray<FWallRunSurfaceTriangle>& Triangles = Index->GetTriangles();
+	TArray<FVector> Starts;
+	TArray<FVector> Ends;
+	Starts.Reserve(NumFans * RaysPerFan);
+	Ends.Reserve(NumFans * RaysPerFan);
+	for (int32 Fan = 0; Fan < NumFans; Fan++)
+	{
+		const FWallRunSurfaceTriangle& Triangle = Triangles[Random.RandHelper(Triangles.Num())];
+		const FVector Origin = Triangle.A + (Triangle.Edge1 + Triangle.Edge2) / 3.0f + Triangle.Normal * RayLength * 0.5f;
+		const float Yaw = Random.FRandRange(0.0f, 360.0f);
+		for (int32 Ray = 0; Ray < RaysPerFan; Ray++)
+		{
+			Starts.Add(Origin);
+			Ends.Add(Origin + FRotator(0.0f, Yaw + Ray * (360.0f / RaysPerFan), 0.0f).Vector() * RayLength);
+		}
+	}
+
+	const FWallQueryBackend_Physics PhysicsBackend(World, FCollisionQueryParams(SCENE_QUERY_STAT(WallRunTrace), false), Index->TraceChannel);
+	auto RunQueries = [&Starts, &Ends](const IWallQueryBackend& Backend, TArray<FWallQueryHit>& OutHits)
+	{
+		OutHits.SetNum(Starts.Num());
+		const double QueryStartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Starts.Num(); i++)
+		{
+			Backend.Raycast(Starts[i], Ends[i], OutHits[i]);
+		}
+		return FPlatformTime::Seconds() - QueryStartTime;
+	};
+
+	TArray<FWallQueryHit> PhysicsHits;
+	TArray<FWallQueryHit> IndexHits;
+	const double PhysicsTime = RunQueries(PhysicsBackend, PhysicsHits);
+	const double IndexTime = RunQueries(*Index, IndexHits);
+
+	// Physics also hits clutter the index skips on purpose, so disagreement is expected to some degree
+	int32 NumPhysicsHits = 0;
+	int32 NumIndexHits = 0;
+	int32 NumAgreeing = 0;
+	for (int32 i = 0; i < Starts.Num(); i++)
+	{
+		NumPhysicsHits += PhysicsHits[i].bBlockingHit ? 1 : 0;
+		NumIndexHits += IndexHits[i].bBlockingHit ? 1 : 0;
+		NumAgreeing += PhysicsHits[i].bBlockingHit == IndexHits[i].bBlockingHit ? 1 : 0;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("WallRun.BakeSurfaceIndex - %d rays. Physics: %.3f us/ray (%d hits), Index: %.3f us/ray (%d hits), %.1f%% agree"),
+		Starts.Num(), PhysicsTime * 1000000.0 / Starts.Num(), NumPhysicsHits, IndexTime * 1000000.0 / Starts.Num(), NumIndexHits, 100.0 * NumAgreeing / Starts.Num());
+}
+
+static FAutoConsoleCommand CmdWallRunBakeSurfaceIndex(TEXT("WallRun.BakeSurfaceIndex"),
+	TEXT("Bakes wallrunnable surfaces of the current level into a WallRunSurfaceIndex actor (save the level afterwards) and compares its query cost with physics traces. Usage: WallRun.BakeSurfaceIndex [NumFans]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BakeWallRunSurfaceIndex));
+#endif
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "WallQueryBackend.h"
+#include "WallRunSurfaceIndex.generated.h"
+
+
+/** Single wallrunnable triangle of the baked index */
+USTRUCT()
+struct FWallRunSurfaceTriangle
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector A = FVector::ZeroVector;
+
+	UPROPERTY()
+	FVector Edge1 = FVector::ZeroVector;
+
+	UPROPERTY()
+	FVector Edge2 = FVector::ZeroVector;
+
+	/** Faces away from the collision shape, only the front face is hit (one sided, unlike FWallQueryBackend_Analytic::AddTriangle) */
+	UPROPERTY()
+	FVector Normal = FVector::ZeroVector;
+};
+
+
+/**
+ * Wallrunnable vertical surfaces of a level, baked offline from simple collision of static meshes.
+ * Placed once per level (WallRun.BakeSurfaceIndex spawns it) and saved with the level.
+ *
+ * Only static mobility meshes blocking the trace channel, within slope and height limits, end up here,
+ * so props, glass and small clutter which can never be wallrun on are not considered by wall detection.
+ * Triangles are stored in a uniform XY grid, wall detection rays are short and only touch a couple of cells.
+ */
+UCLASS(NotBlueprintable)
+class SHOOTERGAME_API AWallRunSurfaceIndex : public AInfo, public IWallQueryBackend
+{
+	GENERATED_BODY()
+
+public:
+	AWallRunSurfaceIndex(const FObjectInitializer& ObjectInitializer);
+
+	/** Maximum angle (in degrees) between a surface and the vertical axis to be considered a wall */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0", ClampMax = "89"))
+	float MaxWallSlope = 10.0f;
+
+	/** Collision shapes shorter than this (in cm) are ignored */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0"))
+	float MinWallHeight = 150.0f;
+
+	/** Collision shapes with a smaller horizontal extent (in cm) are ignored (clutter) */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0"))
+	float MinWallWidth = 100.0f;
+
+	/** Only components blocking this channel are baked, should match the channel used by wall detection */
+	UPROPERTY(EditAnywhere, Category = "Bake")
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** Size of a grid cell (in cm) */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "50"))
+	float CellSize = 500.0f;
+
+#if WITH_EDITOR
+	/** Rebuilds the index from current state of the level. Returns number of baked triangles. */
+	int32 Bake();
+#endif
+
+	bool HasData() const { return Triangles.Num() > 0; }
+
+	const TArray<FWallRunSurfaceTriangle>& GetTriangles() const { return Triangles; }
+
+	/** Memory used by the baked data in bytes */
+	SIZE_T GetIndexSize() const;
+
+	virtual bool Raycast(const FVector& Start, const FVector& End, FWallQueryHit& OutHit) const override;
+
+private:
+	/** Adds the triangle if it is steep enough, winding is fixed so the normal points along OutwardHint */
+	void AddTriangle(const FVector& A, const FVector& B, const FVector& C, const FVector& OutwardHint);
+	void BuildGrid();
+
+	int32 GetCellIndex(int32 X, int32 Y) const { return Y * GridSizeX + X; }
+
+	UPROPERTY()
+	TArray<FWallRunSurfaceTriangle> Triangles;
+
+	UPROPERTY()
+	FVector2D GridOrigin = FVector2D::ZeroVector;
+
+	/** CellSize the grid was baked with */
+	UPROPERTY()
+	float GridCellSize = 0.0f;
+
+	UPROPERTY()
+	int32 GridSizeX = 0;
+
+	UPROPERTY()
+	int32 GridSizeY = 0;
+
+	/** Triangles of cell i are CellTriangles[CellStart[i]] .. CellTriangles[CellStart[i + 1] - 1] */
+	UPROPERTY()
+	TArray<int32> CellStart;
+
+	UPROPERTY()
+	TArray<int32> CellTriangles;
+};